@@ -0,0 +1,35 @@
+// Copyright (c) v1ne
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+
+void CBenchmarkTimes::Add(Clock::duration duration) {
+  mNanoseconds.push_back(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+}
+
+
+uint64_t CBenchmarkTimes::MedianNanoseconds() const {
+  if(mNanoseconds.empty())
+    return 0;
+  std::sort(mNanoseconds.begin(), mNanoseconds.end());
+  return mNanoseconds[mNanoseconds.size() / 2];
+}
+
+
+std::string CBenchmarkTimes::Summary(const char* pLabel) const {
+  char buf[192];
+  if(mNanoseconds.empty()) {
+    snprintf(buf, sizeof(buf), "%s: no runs\n", pLabel);
+    return buf;
+  }
+
+  std::sort(mNanoseconds.begin(), mNanoseconds.end());
+  const auto percentile95 = mNanoseconds[(mNanoseconds.size() - 1) * 95 / 100];
+  snprintf(buf, sizeof(buf), "%s: median %.1f us, 95%% %.1f us, max %.1f us over %u runs\n", pLabel,
+    mNanoseconds[mNanoseconds.size() / 2] / 1000.0, percentile95 / 1000.0, mNanoseconds.back() / 1000.0,
+    unsigned(mNanoseconds.size()));
+  return buf;
+}
@@ -0,0 +1,29 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Collects how long each run of something took, e.g. a frame, and sums them
+// up for the report of a benchmark
+class CBenchmarkTimes {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void Add(Clock::duration duration);
+  void Clear() { mNanoseconds.clear(); }
+
+  size_t NumRuns() const { return mNanoseconds.size(); }
+  // 0 without runs
+  uint64_t MedianNanoseconds() const;
+
+  // "<label>: median 123.4 us, 95% 150.2 us, max 180.0 us over 200 runs\n"
+  std::string Summary(const char* pLabel) const;
+
+private:
+  // Sorted on demand
+  mutable std::vector<uint64_t> mNanoseconds;
+};
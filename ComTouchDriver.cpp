@@ -7,15 +7,42 @@
 
 #include "ComTouchDriver.h"
 
+#include "ControlRing.h"
+#include "D2DRenderer.h"
+#include "MidiRouter.h"
+#include "MidiScheduler.h"
+#include "OscOutput.h"
+#include "RenderThread.h"
 #include "Slider.h"
 #include "Square.h"
+#include "StartupTimeline.h"
 
 #include <manipulations.h>
+#include <psapi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
 
 #define NUM_CORE_OBJECTS 2
 
-#define NUM_SLIDERS 14
-#define NUM_KNOBS 15
+extern CMidiRouter gMidiRouter;
+extern CMidiScheduler gMidiScheduler;
+extern COscOutput gOscOutput;
+extern CControlRing gControlRing;
+
+// Views per recording task. Painting a single view is too cheap to be worth
+// a task of its own.
+static constexpr size_t sViewsPerRecordChunk = 8;
+
+// What CycleTargetFrameRate switches between
+static constexpr unsigned int sTargetFrameRates[] = {30, 60, 120, 240};
+
+// How far the canvas can be zoomed out and in
+static constexpr auto sMinCanvasScale = 0.05f;
+static constexpr auto sMaxCanvasScale = 4.f;
+
 
 CComTouchDriver::CComTouchDriver(HWND hWnd)
   : mhWnd(hWnd)
@@ -28,44 +55,66 @@ CComTouchDriver::CComTouchDriver(HWND hWnd)
 #endif
 }
 
-bool CComTouchDriver::Initialize() {
+bool CComTouchDriver::Initialize(const wchar_t* pLayoutPath, const wchar_t* pStatePath) {
   mPhysicalPointsPerLogicalPoint = ::GetDpiForWindow(mhWnd) / 96.f;
 
+  // D2D is initialized while the views are created and the window is shown.
+  // The render thread then creates the device resources right away, and the
+  // first frame waits for both.
   mD2dDriver = new CD2DDriver(mhWnd);
-  auto success = SUCCEEDED(mD2dDriver->Initialize());
-  if (!success) return false;
+  mD2dDriver->BeginInitialize();
 
-  for(int i = 0; i < NUM_CORE_OBJECTS; i++) {
-    mCoreObjects.push_front(new CSquare(mhWnd, mD2dDriver, CSquare::DrawingColor(i % 4)));
-  }
+  mpRenderer = new CD2DRenderer(mD2dDriver);
+  mpRecordPool = new CWorkStealingPool(std::thread::hardware_concurrency());
+  for(unsigned int i = 0; i < mpRecordPool->NumWorkers(); ++i)
+    mRecordArenas.emplace_back(new CFrameArena);
+  // Frames are paced to the refresh rate of the display, by default
+  auto hdc = ::GetDC(mhWnd);
+  const auto refreshRate = ::GetDeviceCaps(hdc, VREFRESH);
+  ::ReleaseDC(mhWnd, hdc);
+  mFrameGovernor.SetTargetFrameRate(refreshRate > 1 ? unsigned(refreshRate) : 60);
 
-  uint8_t numController = 0;
+  mpRenderThread = new CRenderThread(mhWnd, mD2dDriver, mpRenderer, &mFrameGovernor);
 
-  for (int i = 0; i < NUM_SLIDERS + 1; i++) {
-    mCoreObjects.push_front(new CSlider(mhWnd, mD2dDriver, CSlider::TYPE_SLIDER, numController++));
+  const auto beginViews = CStartupTimeline::Clock::now();
+  for(int i = 0; i < NUM_CORE_OBJECTS; i++) {
+    mSquares.push_back(new CSquare(mhWnd, mD2dDriver, CSquare::DrawingColor(i % 4)));
+    mCoreObjects.push_front(mSquares.back());
   }
 
-  for (int i = 0; i < NUM_KNOBS; i++) {
-    mCoreObjects.push_front(new CSlider(mhWnd, mD2dDriver, CSlider::TYPE_KNOB, numController++));
-  }
+  const auto beginLayout = CStartupTimeline::Clock::now();
+  LoadLayout(pLayoutPath, pStatePath);
+  gStartupTimeline.Record("Layout", beginLayout);
 
-  mCoreObjectsInInitialOrder.reserve(mCoreObjects.size());
-  mCoreObjectsInInitialOrder.insert(mCoreObjectsInInitialOrder.begin(), mCoreObjects.begin(), mCoreObjects.end());
+  // Only the controls of the first bank get views for now
+  ShowBank(0);
+  gStartupTimeline.Record("Views and their manipulation processors", beginViews);
+  LogResidentMemory();
 
-  return success;
+  return true;
 }
 
 CComTouchDriver::~CComTouchDriver() {
+  // Stop rendering before anything that the render thread uses goes away.
+  // The views release their cached layers when they're deleted.
+  delete mpRenderThread;
+
   for(const auto& pObject: mCoreObjects)
     delete pObject;
   mCoreObjects.clear();
+  for(const auto& pView: mSpareViews)
+    delete pView;
+  mSpareViews.clear();
 
+  delete mpRecordPool;
+  delete mpRenderer;
   delete mD2dDriver;
 
   CoUninitialize();
 }
 
 void CComTouchDriver::ProcessInputEvent(const TOUCHINPUT* pData) {
+  gMidiScheduler.SetSourceTime(pData->dwTime);
   auto cursorId = pData->dwID;
 
   // Skip spurious mouse events if there are touch valid points
@@ -77,22 +126,35 @@ void CComTouchDriver::ProcessInputEvent(const TOUCHINPUT* pData) {
     if (cursorId != MOUSE_CURSOR_ID)
       mNumTouchContacts++;
 
+    auto found = false;
     for(const auto& pObject: mCoreObjects) {
-      auto found = DownEvent(pObject, pData);
+      found = DownEvent(pObject, pData);
       if(found) break;
     }
+
+    if(!found)
+      mCanvasContacts[cursorId] = PhysicalToLogical({pData->x, pData->y});
   } else if(flags & TOUCHEVENTF_MOVE) {
-    MoveEvent(pData);
+    if(mCanvasContacts.count(cursorId))
+      MoveCanvasContact(cursorId, PhysicalToLogical({pData->x, pData->y}));
+    else
+      MoveEvent(pData);
   } else if(flags & TOUCHEVENTF_UP) {
     if (cursorId != MOUSE_CURSOR_ID)
       mNumTouchContacts--;
 
-    UpEvent(pData);
+    if(!mCanvasContacts.erase(cursorId))
+      UpEvent(pData);
   }
 }
 
+// Views are hit-tested and manipulated in canvas coordinates
+Point2F CComTouchDriver::CanvasPos(const TOUCHINPUT* pData) {
+  return mWindowToCanvas.Apply(PhysicalToLogical({pData->x, pData->y}));
+}
+
 bool CComTouchDriver::DownEvent(ViewBase* pView, const TOUCHINPUT* pData) {
-  auto p = PhysicalToLogical({pData->x, pData->y});
+  auto p = CanvasPos(pData);
 
   if(!pView->InRegion(p))
     return false;
@@ -105,13 +167,13 @@ bool CComTouchDriver::DownEvent(ViewBase* pView, const TOUCHINPUT* pData) {
   mCoreObjects.remove(pView);
   mCoreObjects.push_front(pView);
 
-  ::InvalidateRect(mhWnd, NULL, FALSE);
+  RequestFrame();
   return true;
 }
 
 void CComTouchDriver::MoveEvent(const TOUCHINPUT* pData) {
   DWORD cursorId = pData->dwID;
-  auto p = PhysicalToLogical({pData->x, pData->y});
+  auto p = CanvasPos(pData);
 
   auto iEntry = mCursorIdToObjectMap.find(cursorId);
   if(iEntry != mCursorIdToObjectMap.end())
@@ -120,85 +182,524 @@ void CComTouchDriver::MoveEvent(const TOUCHINPUT* pData) {
 
 void CComTouchDriver::UpEvent(const TOUCHINPUT* pData) {
   DWORD cursorId = pData->dwID;
-  auto p = PhysicalToLogical({pData->x, pData->y});
+  auto p = CanvasPos(pData);
 
   auto iEntry = mCursorIdToObjectMap.find(cursorId);
   if(iEntry != mCursorIdToObjectMap.end()) {
     iEntry->second->HandleTouchEvent(ViewBase::UP, p, pData);
     mCursorIdToObjectMap.erase(cursorId);
+
+    if(mCursorIdToObjectMap.empty())
+      mpRenderThread->RequestProfileReport();
   }
 }
 
+// One contact pans the canvas. Two pinch it, i.e. the points on the canvas
+// below them stay below them. Any further contacts are ignored.
+void CComTouchDriver::MoveCanvasContact(DWORD cursorId, Point2F pos) {
+  auto iContact = mCanvasContacts.find(cursorId);
+  auto iOther = mCanvasContacts.begin();
+  if(iOther == iContact)
+    ++iOther;
+
+  const auto previousPos = iContact->second;
+  iContact->second = pos;
+
+  if(iOther == mCanvasContacts.end()) {
+    SetCanvasTransform(mCanvasTransform * Transform2F::Translation(pos - previousPos));
+    return;
+  }
+
+  const auto isPinching = std::distance(mCanvasContacts.begin(), iContact) < 2
+    && std::distance(mCanvasContacts.begin(), iOther) < 2;
+  if(!isPinching)
+    return;
+
+  const auto otherPos = iOther->second;
+  const auto previousDistance = (previousPos - otherPos).mag();
+  if(previousDistance < 1.f)
+    return;
+
+  const auto previousCenter = (previousPos + otherPos) / 2.f;
+  const auto center = (pos + otherPos) / 2.f;
+  const auto factor = (pos - otherPos).mag() / previousDistance;
+  SetCanvasTransform(mCanvasTransform * Transform2F::Scale(Point2F{factor}, previousCenter)
+    * Transform2F::Translation(center - previousCenter));
+}
+
+void CComTouchDriver::ZoomCanvas(float factor, Point2I physicalCenter) {
+  SetCanvasTransform(mCanvasTransform * Transform2F::Scale(Point2F{factor}, PhysicalToLogical(physicalCenter)));
+  RequestFrame();
+}
+
+void CComTouchDriver::ResetCanvas() {
+  SetCanvasTransform(Transform2F::Identity());
+  RequestFrame();
+}
+
+// Keeps the zoom within limits, but lets the canvas be panned anywhere. The
+// frame is requested by the caller, e.g. after all contacts of a message moved.
+void CComTouchDriver::SetCanvasTransform(const Transform2F& canvasTransform) {
+  const auto scale = canvasTransform.ScaleFactor();
+  if(scale < sMinCanvasScale || scale > sMaxCanvasScale)
+    return;
+
+  Transform2F inverse;
+  if(!canvasTransform.Invert(&inverse))
+    return;
+
+  mCanvasTransform = canvasTransform;
+  mWindowToCanvas = inverse;
+}
+
 void CComTouchDriver::RunInertiaProcessorsAndRender() {
+  gMidiScheduler.SetSourceTimeNow();
   for(const auto& pObject: mCoreObjects)
     pObject->HandleTouchEvent(ViewBase::INERTIA, {}, nullptr);
 
-  ::InvalidateRect(mhWnd, NULL, FALSE);
+  RequestFrame();
+}
+
+bool CComTouchDriver::IsTouched(const ViewBase* pView) const {
+  for(const auto& entry: mCursorIdToObjectMap)
+    if(entry.second == pView)
+      return true;
+  return false;
+}
+
+void CComTouchDriver::RecordFrame() {
+  mRenderList.Reset();
+
+  mRenderList.BeginView(nullptr);
+  mRenderList.FillRect(Rect2F::FromPoints({}, mPhysicalClientArea), Brush(BrushId::GradientBackground,
+    {mPhysicalClientArea.x/2, 0.f}, {mPhysicalClientArea.x/2, mPhysicalClientArea.y}));
+  mRenderList.EndView();
+
+  const auto logicalClientArea = mPhysicalClientArea / mPhysicalPointsPerLogicalPoint;
+  mVisibleCanvasArea = mWindowToCanvas.Apply(Rect2F::FromPoints({}, logicalClientArea));
+
+  mViewsInPaintOrder.assign(mCoreObjects.rbegin(), mCoreObjects.rend());
+  const auto numChunks = (mViewsInPaintOrder.size() + sViewsPerRecordChunk - 1) / sViewsPerRecordChunk;
+  if(mChunkLists.size() < numChunks)
+    mChunkLists.resize(numChunks);
+  for(auto& list: mChunkLists)
+    list.SetDetailScale(mFrameGovernor.DetailScale());
+
+  mpRecordPool->Run(numChunks, [this](size_t chunk, unsigned int worker) { RecordChunk(chunk, worker); });
+
+  for(size_t chunk = 0; chunk < numChunks; ++chunk)
+    mRenderList.AppendViews(mChunkLists[chunk]);
+  // All but the background
+  mRenderStats.numViewsOffScreen += unsigned(mViewsInPaintOrder.size() - (mRenderList.Spans().size() - 1));
+
+  // The workers are idle now
+  for(auto& pArena: mRecordArenas)
+    pArena->Reset();
+
+  ++mRenderStats.numRecorded;
+}
+
+// Runs on any thread of the recording pool. Views only touch their own state
+// while painting.
+void CComTouchDriver::RecordChunk(size_t chunk, unsigned int worker) {
+  auto& list = mChunkLists[chunk];
+  auto& arena = *mRecordArenas[worker];
+  list.Reset();
+
+  const auto begin = chunk * sViewsPerRecordChunk;
+  const auto end = begin + sViewsPerRecordChunk < mViewsInPaintOrder.size()
+    ? begin + sViewsPerRecordChunk : mViewsInPaintOrder.size();
+  for(auto i = begin; i < end; ++i) {
+    // Touched views are always recorded, since they may paint outside of their bounds
+    auto* pView = mViewsInPaintOrder[i];
+    if(!pView->Bounds().Intersects(mVisibleCanvasArea) && !IsTouched(pView))
+      continue;
+
+    list.BeginView(pView, mCanvasTransform);
+    pView->Paint(list, arena);
+    list.EndView();
+  }
 }
 
-void CComTouchDriver::RenderObjects() {
-  if(mD2dDriver->GetRenderTarget()->CheckWindowState() & D2D1_WINDOW_STATE_OCCLUDED)
+void CComTouchDriver::RequestFrame() {
+  // Without D2D there's nothing to show, so give up before the first frame
+  if(!mIsD2dInitialized) {
+    const auto begin = CStartupTimeline::Clock::now();
+    if(FAILED(mD2dDriver->WaitForInitialization())) {
+      ::OutputDebugStringA("Failed to initialize Direct2D\n");
+      ::DestroyWindow(mhWnd);
+      return;
+    }
+    gStartupTimeline.Record("Waiting for D2D on the GUI thread", begin);
+    mIsD2dInitialized = true;
+  }
+
+  // Input keeps being handled, and MIDI sent, at the rate of the input messages
+  const auto now = CFrameGovernor::Clock::now();
+  CFrameGovernor::Clock::duration wait;
+  if(!mFrameGovernor.IsFrameDue(now, &wait)) {
+    if(!mIsFramePending) {
+      mIsFramePending = true;
+      const auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(wait).count() + 1;
+      ::SetTimer(mhWnd, sFrameTimerId, UINT(waitMs), NULL);
+    }
     return;
+  }
 
-  mD2dDriver->BeginDraw();
-  mD2dDriver->RenderBackground(mPhysicalClientArea);
+  if(mIsFramePending) {
+    ::KillTimer(mhWnd, sFrameTimerId);
+    mIsFramePending = false;
+  }
 
-  for(auto iObject = mCoreObjects.rbegin(); iObject != mCoreObjects.rend(); ++iObject)
-    (*iObject)->Paint();
+  RecordFrame();
+  mFrameGovernor.OnFrameRecorded(now, CFrameGovernor::Clock::now() - now);
+  LogRenderStats();
 
-  mD2dDriver->EndDraw();
+  Rect2F dirty;
+  if(!mPublishedList.IsEmpty() && !mRenderList.Diff(mPublishedList, &dirty)) {
+    ++mRenderStats.numSkipped;
+    return;
+  }
+
+  auto& snapshot = mpRenderThread->BackSnapshot();
+  snapshot.list = mRenderList;
+  snapshot.physicalClientArea = Point2I{int(mPhysicalClientArea.x), int(mPhysicalClientArea.y)};
+  snapshot.physicalPointsPerLogicalPoint = mPhysicalPointsPerLogicalPoint;
+  mpRenderThread->Publish();
+
+  std::swap(mRenderList, mPublishedList);
 }
 
-void CComTouchDriver::RenderInitialState(Point2I physicalClientArea) {
-  D2D1_SIZE_U size = {UINT32(physicalClientArea.x), UINT32(physicalClientArea.y)};
+void CComTouchDriver::OnFrameTimer() {
+  ::KillTimer(mhWnd, sFrameTimerId);
+  mIsFramePending = false;
+  RequestFrame();
+}
+
+void CComTouchDriver::CycleTargetFrameRate() {
+  auto frameRate = sTargetFrameRates[0];
+  for(const auto rate: sTargetFrameRates) {
+    if(rate > mFrameGovernor.TargetFrameRate()) {
+      frameRate = rate;
+      break;
+    }
+  }
+  mFrameGovernor.SetTargetFrameRate(frameRate);
+
+  char buf[64];
+  wsprintfA(buf, "Target frame rate: %u fps\n", frameRate);
+  ::OutputDebugStringA(buf);
+}
+
+void CComTouchDriver::RepaintWindow() {
+  RequestFrame();
+  mpRenderThread->RequestRedraw();
+}
 
-  if (FAILED(mD2dDriver->GetRenderTarget()->Resize(size)))
-  {
-    mD2dDriver->DiscardDeviceResources();
-    InvalidateRect(mhWnd, NULL, FALSE);
+void CComTouchDriver::LogArenaStats(const char* name, const CFrameArena::Stats& stats) {
+  char buf[160];
+  wsprintfA(buf, "%s arena: %u bytes at most, %u bytes capacity, %u heap allocations\n", name,
+    unsigned(stats.highWaterBytes), unsigned(stats.capacityBytes), stats.numHeapAllocations);
+  ::OutputDebugStringA(buf);
+}
+
+void CComTouchDriver::SimulateDeviceLoss() {
+  mpRenderThread->SimulateDeviceLoss();
+}
+
+void CComTouchDriver::LogRenderStats() {
+  if(mRenderStats.numRecorded < 1000)
     return;
+
+  char buf[256];
+  wsprintfA(buf, "Frames: %u recorded, %u unchanged, %u views off screen\n", mRenderStats.numRecorded,
+    mRenderStats.numSkipped, mRenderStats.numViewsOffScreen);
+  ::OutputDebugStringA(buf);
+
+  const auto pacing = mFrameGovernor.TakeStats();
+  wsprintfA(buf, "Frame pacing: %u of %u fps, %u%% detail, %u missed deadlines, %u deferred, %u us paint time\n",
+    pacing.framesPerSecond, pacing.targetFramesPerSecond, unsigned(pacing.detailScale * 100),
+    pacing.numMissedDeadlines, pacing.numDeferred, unsigned(pacing.averagePaintMicroseconds));
+  ::OutputDebugStringA(buf);
+
+  // The scheduler's thread may be sending
+  auto lock = gMidiScheduler.LockRouter();
+  const auto midi = gMidiRouter.TakeStats();
+  lock.unlock();
+  wsprintfA(buf, "MIDI: %u values, %u coalesced, %u messages in %u calls, %u bytes, %u bytes without running status, "
+    "%u buffers refused\n", midi.numValues, midi.numCoalesced, midi.numMessages, midi.numCalls, midi.numBytes,
+    midi.numBytesWithoutRunningStatus, midi.numRefusedBuffers);
+  ::OutputDebugStringA(buf);
+  const auto timing = gMidiScheduler.TakeStats();
+  wsprintfA(buf, "MIDI timing: %u values, %u late, %u to %u us from input, %u us on average\n", timing.numValues,
+    timing.numLate, timing.minDelayMicroseconds, timing.maxDelayMicroseconds, timing.averageDelayMicroseconds);
+  ::OutputDebugStringA(buf);
+  if(gMidiRouter.NumInputs()) {
+    const auto midiIn = gMidiRouter.TakeInputStats();
+    wsprintfA(buf, "MIDI in: %u messages, %u SysEx, %u values, %u coalesced\n", midiIn.numMessages,
+      midiIn.numSysEx, midiIn.numValues, midiIn.numCoalesced);
+    ::OutputDebugStringA(buf);
+  }
+
+  if(gOscOutput.IsOpen()) {
+    const auto osc = gOscOutput.TakeStats();
+    wsprintfA(buf, "OSC: %u values, %u coalesced, %u messages in %u bundles, %u bytes, %u%% full, %u dropped\n",
+      osc.numValues, osc.numCoalesced, osc.numMessages, osc.numBundles, osc.numBytes, osc.fillPercent,
+      osc.numDroppedBundles);
+    ::OutputDebugStringA(buf);
   }
+  if(gControlRing.IsOpen()) {
+    wsprintfA(buf, "Shared ring: %u values\n", gControlRing.TakeNumPublished());
+    ::OutputDebugStringA(buf);
+  }
+
+  LogArenaStats("Input", mInputArena.TakeStats());
+  for(auto& pArena: mRecordArenas)
+    LogArenaStats("Recording", pArena->TakeStats());
+
+  mRenderStats = {};
+}
 
+void CComTouchDriver::RenderInitialState(Point2I physicalClientArea) {
+  // The render thread resizes the render target once it sees the new size
+  mPublishedList.Reset();
   mPhysicalClientArea = Point2F(physicalClientArea);
 
   auto clientArea = PhysicalToLogical(physicalClientArea);
 
   const auto squareSize = Point2F(200.f);
   const auto numSquareColumns = int(sqrt(NUM_CORE_OBJECTS));
-  auto iObject = mCoreObjectsInInitialOrder.rbegin();
   for(int i = 0; i < NUM_CORE_OBJECTS; i++) {
     const auto pos = clientArea - squareSize.mulByComponent(
       Point2I{i % numSquareColumns + 1, i / numSquareColumns + 1});
-    ((CSquare*)*iObject)->ResetState(pos, clientArea, squareSize);
-    ++iObject;
+    mSquares[i]->ResetState(pos, clientArea, squareSize);
+  }
+
+  LayOutBank();
+
+  InvalidateRect(mhWnd, NULL, FALSE);
+}
+
+void CComTouchDriver::LoadLayout(const wchar_t* pLayoutPath, const wchar_t* pStatePath) {
+  std::string error;
+  const auto begin = std::chrono::steady_clock::now();
+  const auto isLoaded = pLayoutPath && mLayout.Load(pLayoutPath, &error);
+  const auto end = std::chrono::steady_clock::now();
+
+  if(pLayoutPath && !isLoaded) {
+    ::OutputDebugStringA("Layout: Can't use ");
+    ::OutputDebugStringW(pLayoutPath);
+    ::OutputDebugStringA((": " + error + ". Using the built-in layout.\n").c_str());
+  }
+  if(!isLoaded) {
+    const auto isBuiltInValid = mLayout.Assign(BuiltInLayout(), &error);
+#ifdef _DEBUG
+    assert(isBuiltInValid);
+#else
+    UNREFERENCED_PARAMETER(isBuiltInValid);
+#endif
+  }
+
+  // Controls without a valid value in the state file get a random one. All
+  // values go into the state file, so that the next start is the same.
+  const auto beginRestore = std::chrono::steady_clock::now();
+  const auto hasStateFile = pStatePath
+    && mStateFile.Open(pStatePath, mLayout.NumControls(), mLayout.MappingFingerprint());
+  size_t numRestored = 0;
+  for(size_t i = 0; i < mLayout.NumControls(); ++i) {
+    const auto& control = mLayout.Controls()[i];
+    float value;
+    if(mStateFile.Load(i, &value))
+      ++numRestored;
+    else {
+      value = ::rand() / float(RAND_MAX);
+      mStateFile.Store(i, value);
+    }
+    mControls.AddControl(control.bank, control.type, value);
+    gMidiRouter.AddTarget({control.device, control.channel, control.controller, control.resolution});
   }
+  mControls.SetStateFile(&mStateFile);
+  const auto endRestore = std::chrono::steady_clock::now();
+
+  char buf[128];
+  wsprintfA(buf, "Layout: %u controls in %u banks, %s\n",
+    unsigned(mLayout.NumControls()), unsigned(mLayout.NumBanks()), isLoaded ? "from the file" : "built in");
+  ::OutputDebugStringA(buf);
+  if(isLoaded) {
+    wsprintfA(buf, "Layout: Mapped and validated in %u us\n",
+      unsigned(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()));
+    ::OutputDebugStringA(buf);
+  }
+  if(hasStateFile) {
+    wsprintfA(buf, "State: Restored %u of %u values in %u us\n", unsigned(numRestored), unsigned(mLayout.NumControls()),
+      unsigned(std::chrono::duration_cast<std::chrono::microseconds>(endRestore - beginRestore).count()));
+    ::OutputDebugStringA(buf);
+  } else if(pStatePath)
+    ::OutputDebugStringA("State: Can't open the state file, values won't be kept\n");
+}
 
-  const auto sliderBorder = Point2F{5};
-  const auto sliderSize = Point2F{50, 200};
-  const auto sliderDistance = sliderSize + sliderBorder;
-  const auto numSliderColumns = int(sqrt(NUM_SLIDERS * sliderDistance.y / sliderDistance.x));
-  for(int i = 0; i < NUM_SLIDERS; i++) {
-    const auto pos = sliderBorder + sliderDistance.mulByComponent(
-      Point2I{i % numSliderColumns, i / numSliderColumns});
-    ((CSlider*)*iObject)->ResetState(pos, clientArea, sliderSize);
-    ++iObject;
+void CComTouchDriver::ReceiveMidi(CMidiInput& input) {
+  const auto bankBegin = mControls.BankBegin(mVisibleBank);
+  auto isVisibleChanged = false;
+  uint32_t index;
+  uint16_t midiValue;
+  while(input.Take(&index, &midiValue)) {
+    auto* pView = index - bankBegin < mBankViews.size() ? mBankViews[index - bankBegin] : nullptr;
+    if(pView && pView->IsMoving())
+      continue;
+
+    // What's still scheduled for the control is older than this value, and
+    // would overwrite it
+    gMidiScheduler.Discard(index);
+    auto& control = mControls.At(index);
+    control.lastMidiValue = midiValue;
+    const auto value = float(midiValue) / CMidiEncoder::MaxValue(gMidiRouter.TargetOf(index).resolution);
+    mControls.SetValue(control, value);
+    gOscOutput.Send(index, value);
+    gControlRing.Publish(index, value);
+    if(pView) {
+      pView->ShowValue(value);
+      isVisibleChanged = true;
+    }
   }
 
-  const auto bigSliderPos = Point2F{sliderBorder.x + sliderDistance.x*7, sliderBorder.y};
-  const auto bigSliderSize = Point2F{50, 2*sliderDistance.y - sliderBorder.y};
-  ((CSlider*)*iObject)->ResetState(bigSliderPos, clientArea, bigSliderSize);
+  if(isVisibleChanged)
+    RequestFrame();
+}
 
-  const auto knobBorder = Point2F{2.f};
-  const auto knobSize = Point2F{50.f};
-  const auto knobDistance = knobSize + knobBorder;
-  const auto numKnobColumns = int(sqrt(NUM_KNOBS * knobDistance.y / knobDistance.x));
-  for(int i = 0; i < NUM_KNOBS; i++) {
-    ++iObject;
-    const auto pos = Point2F{
-      knobBorder.x + knobDistance.x * (i % numKnobColumns),
-      clientArea.y - (knobBorder.y + knobDistance.y * (1 + i / numKnobColumns))};
-    ((CSlider*)*iObject)->ResetState(pos, clientArea, knobSize);
+void CComTouchDriver::ResyncMidi() {
+  const auto begin = std::chrono::steady_clock::now();
+  auto lock = gMidiScheduler.LockRouter();
+  // What's still buffered is older than the resync, and what's scheduled
+  // is sent along with it
+  gMidiRouter.Flush();
+  gMidiScheduler.Discard();
+
+  // A stream per device. Controls are mostly mapped channel by channel, so
+  // that running status leaves out almost all status bytes. The receivers
+  // get every value in full, as if they knew nothing.
+  mResyncEncoders.resize(gMidiRouter.NumOutputs());
+  for(auto& encoder: mResyncEncoders) {
+    encoder.Clear();
+    encoder.ForgetSelectedParameters();
+  }
+  for(size_t bank = 0; bank < mControls.NumBanks(); ++bank) {
+    auto* pControls = mControls.BankControls(bank);
+    for(size_t i = 0; i < mControls.NumControlsInBank(bank); ++i) {
+      auto& control = pControls[i];
+      const auto& target = gMidiRouter.TargetOf(mControls.BankBegin(bank) + i);
+      control.lastMidiValue = CControlModel::MidiValue(control.value, target.resolution);
+      if(target.device < mResyncEncoders.size()) {
+        mResyncEncoders[target.device].Controller(target.channel, target.controller, target.resolution,
+          control.lastMidiValue, CMidiEncoder::sNoValue);
+      }
+    }
   }
 
-  InvalidateRect(mhWnd, NULL, FALSE);
+  for(size_t device = 0; device < mResyncEncoders.size(); ++device)
+    gMidiRouter.Output(device).beginStream(mResyncEncoders[device]);
+  lock.unlock();
+
+  // Sending takes a while with many values, during which the scheduler
+  // mustn't wait for the lock. It has nothing to send meanwhile, since it
+  // only gets values from this thread.
+  auto isSent = true;
+  size_t size = 0;
+  size_t uncompressedSize = 0;
+  for(size_t device = 0; device < mResyncEncoders.size(); ++device) {
+    const auto& encoder = mResyncEncoders[device];
+    isSent &= gMidiRouter.Output(device).sendStream(encoder);
+    size += encoder.Size();
+    uncompressedSize += encoder.UncompressedSize();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  char buf[256];
+  wsprintfA(buf, "MIDI: Resync of %u values to %u devices %s in %u us. %u bytes take %u ms on the wire, "
+    "%u bytes and %u ms without running status\n",
+    unsigned(mControls.NumControls()), unsigned(mResyncEncoders.size()), isSent ? "sent" : "failed",
+    unsigned(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()),
+    unsigned(size), unsigned(size * CMidiEncoder::sWireMicrosecondsPerByte / 1000),
+    unsigned(uncompressedSize), unsigned(uncompressedSize * CMidiEncoder::sWireMicrosecondsPerByte / 1000));
+  ::OutputDebugStringA(buf);
+}
+
+void CComTouchDriver::LayOutBank() {
+  auto clientArea = mPhysicalClientArea / mPhysicalPointsPerLogicalPoint;
+
+  // Banks may have any number of controls
+  const auto* pLayoutControls = mLayout.Controls() + mControls.BankBegin(mVisibleBank);
+  for(size_t i = 0; i < mBankViews.size(); i++) {
+    const auto& rect = pLayoutControls[i].rect;
+    mBankViews[i]->ResetState(rect.TopLeft(), clientArea, rect.Size());
+  }
+}
+
+// Binds the views to the controls of the bank. Views of the bank shown before
+// are recycled, so that switching banks doesn't create views once there are
+// enough of them.
+void CComTouchDriver::ShowBank(size_t bank) {
+  for(auto* pView: mBankViews) {
+    pView->Unbind();
+    mCoreObjects.remove(pView);
+    mSpareViews.push_back(pView);
+  }
+
+  // Contacts on the old views end here
+  for(auto iEntry = mCursorIdToObjectMap.begin(); iEntry != mCursorIdToObjectMap.end();) {
+    if(std::find(mBankViews.begin(), mBankViews.end(), iEntry->second) != mBankViews.end())
+      iEntry = mCursorIdToObjectMap.erase(iEntry);
+    else
+      ++iEntry;
+  }
+  mBankViews.clear();
+
+  auto* pControls = mControls.BankControls(bank);
+  for(size_t i = 0; i < mControls.NumControlsInBank(bank); ++i) {
+    CSlider* pView;
+    if(mSpareViews.empty())
+      pView = new CSlider(mhWnd, mD2dDriver);
+    else {
+      pView = mSpareViews.back();
+      mSpareViews.pop_back();
+    }
+
+    pView->Bind(&mControls, &pControls[i]);
+    mBankViews.push_back(pView);
+    mCoreObjects.push_front(pView);
+  }
+
+  mVisibleBank = bank;
+}
+
+void CComTouchDriver::SwitchBank(int delta) {
+  const auto numBanks = int(mControls.NumBanks());
+  const auto bank = ((int(mVisibleBank) + delta) % numBanks + numBanks) % numBanks;
+
+  // The frame with the new bank follows within a frame interval
+  const auto begin = std::chrono::steady_clock::now();
+  ShowBank(size_t(bank));
+  LayOutBank();
+  const auto end = std::chrono::steady_clock::now();
+  RequestFrame();
+
+  char buf[128];
+  wsprintfA(buf, "Bank %u of %u: views bound and laid out in %u us, %u spare views\n",
+    unsigned(bank + 1), unsigned(numBanks),
+    unsigned(std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count()),
+    unsigned(mSpareViews.size()));
+  ::OutputDebugStringA(buf);
+  LogResidentMemory();
+}
+
+void CComTouchDriver::LogResidentMemory() {
+  PROCESS_MEMORY_COUNTERS_EX counters = {};
+  ::GetProcessMemoryInfo(::GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+
+  char buf[192];
+  wsprintfA(buf, "Memory: %u KB working set, %u KB private, %u controls in %u banks take %u KB, %u views\n",
+    unsigned(counters.WorkingSetSize / 1024), unsigned(counters.PrivateUsage / 1024),
+    unsigned(mControls.NumControls()), unsigned(mControls.NumBanks()), unsigned(mControls.ResidentBytes() / 1024),
+    unsigned(mSquares.size() + mBankViews.size() + mSpareViews.size()));
+  ::OutputDebugStringA(buf);
 }
@@ -7,21 +7,49 @@
 
 #pragma once
 
+#include "ControlModel.h"
+#include "ControlState.h"
+#include "FrameArena.h"
+#include "FrameGovernor.h"
+#include "MidiEncoder.h"
+#include "Layout.h"
+#include "RenderList.h"
+#include "Renderer.h"
+#include "RenderThread.h"
 #include "ViewBase.h"
+#include "WorkStealingPool.h"
 
 #include <map>
+#include <memory>
 #include <list>
 #include <vector>
 
 #define MOUSE_CURSOR_ID 0
 
+class CMidiInput;
+class CSlider;
+class CSquare;
+
 class CComTouchDriver {
 public:
     CComTouchDriver(HWND hWnd);
     ~CComTouchDriver();
     
-    // Initializes Core Objects, Manipulation Processors and Inertia Processors
-    bool Initialize();
+    // Initializes Core Objects, Manipulation Processors and Inertia Processors.
+    // The controls are laid out like the compiled layout at pLayoutPath, or
+    // like the built-in layout if there's none. Their values are restored
+    // from the state file at pStatePath and kept there.
+    bool Initialize(const wchar_t* pLayoutPath, const wchar_t* pStatePath);
+
+    // Sends the values of all controls, e.g. so that a device that was just
+    // connected or restarted matches them. Each device gets them as a single
+    // buffer, with running status.
+    void ResyncMidi();
+
+    // Takes the values that came in from a device. Controls that are being
+    // moved on the surface keep their values. The others take them on, and
+    // know that the device has them, so they aren't sent back.
+    void ReceiveMidi(CMidiInput& input);
 
     // Processes the input information and activates the appropriate processor
     void ProcessInputEvent(const TOUCHINPUT* inData);
@@ -30,31 +58,124 @@ public:
     void RenderInitialState(Point2I physicalClientArea);
 
     void RunInertiaProcessorsAndRender();
+
+    // Records a frame and hands it to the render thread, unless it's the same
+    // as the frame handed over last. If a frame was recorded less than a frame
+    // interval ago, the frame timer records it later on.
+    void RequestFrame();
+
+    // Inertia timers use the addresses of the views as IDs, so this can't clash
+    static constexpr UINT_PTR sFrameTimerId = 1;
+    void OnFrameTimer();
+
+    // Switches to the next of a few common frame rates
+    void CycleTargetFrameRate();
+    const CFrameGovernor& FrameGovernor() const { return mFrameGovernor; }
         
     inline Point2F PhysicalToLogical(Point2I p)
     {
         return Point2F(p) / mPhysicalPointsPerLogicalPoint;
     }
 
-    void RenderObjects();
+    // Has the whole window drawn again, e.g. after it was uncovered
+    void RepaintWindow();
+
+    // Shows the bank of controls `delta` banks away from the visible one
+    void SwitchBank(int delta);
+
+    // Zooms the canvas by factor, keeping the physical window point in place
+    void ZoomCanvas(float factor, Point2I physicalCenter);
+    // Shows the canvas like it was laid out
+    void ResetCanvas();
+
+    void SimulateDeviceLoss();
+
+    // For transient data while handling one input message. It's reset once
+    // the message is handled.
+    CFrameArena& InputArena() { return mInputArena; }
 
 private:
     bool DownEvent(ViewBase* pViewBase, const TOUCHINPUT* inData);
     void MoveEvent(const TOUCHINPUT* inData);
     void UpEvent(const TOUCHINPUT* inData);
+    Point2F CanvasPos(const TOUCHINPUT* inData);
+
+    void MoveCanvasContact(DWORD cursorId, Point2F pos);
+    void SetCanvasTransform(const Transform2F& canvasTransform);
+
+    void LoadLayout(const wchar_t* pLayoutPath, const wchar_t* pStatePath);
+    void ShowBank(size_t bank);
+    void LayOutBank();
+    void LogResidentMemory();
+
+    bool IsTouched(const ViewBase* pView) const;
+    void RecordFrame();
+    void RecordChunk(size_t chunk, unsigned int worker);
+    void LogRenderStats();
+    void LogArenaStats(const char* name, const CFrameArena::Stats& stats);
 
     unsigned int mNumTouchContacts = 0;
     std::map<DWORD, ViewBase*> mCursorIdToObjectMap;
   
-    // List of core objects to be manipulated
+    // List of core objects to be manipulated, topmost first
     std::list<ViewBase*> mCoreObjects;
-    std::vector<ViewBase*> mCoreObjectsInInitialOrder;
+    std::vector<CSquare*> mSquares;
+
+    // The controls of all banks. Only the visible bank has views, in the
+    // order of its controls. The other views wait for the next bank switch.
+    // The model and the layout have the same controls in the same order.
+    CLayout mLayout;
+    CControlModel mControls;
+    CControlStateFile mStateFile;
+    // One per device. Kept between resyncs, so that their buffers are reused.
+    std::vector<CMidiEncoder> mResyncEncoders;
+    size_t mVisibleBank = 0;
+    std::vector<CSlider*> mBankViews;
+    std::vector<CSlider*> mSpareViews;
 
     Point2F mPhysicalClientArea;
 
+    // The views are laid out on a canvas, which is zoomed and panned as a
+    // whole. This transforms from canvas to logical window coordinates.
+    Transform2F mCanvasTransform = Transform2F::Identity();
+    Transform2F mWindowToCanvas = Transform2F::Identity();
+    // Contacts that went down next to all views pan and zoom the canvas.
+    // In logical window coordinates.
+    std::map<DWORD, Point2F> mCanvasContacts;
+
     float mPhysicalPointsPerLogicalPoint = 1.0f;
 
     CD2DDriver* mD2dDriver;
+    bool mIsD2dInitialized = false;
+    CRenderer* mpRenderer;
+
+    // The frame recorded last and the one handed to the render thread last
+    CRenderList mRenderList;
+    CRenderList mPublishedList;
+
+    // The views are recorded in parallel, in chunks of consecutive views.
+    // The chunks are then appended to mRenderList in paint order, so the
+    // frame is the same as if it had been recorded serially.
+    CWorkStealingPool* mpRecordPool = nullptr;
+    std::vector<ViewBase*> mViewsInPaintOrder;
+    // The part of the canvas that's in the window. Views outside of it aren't recorded.
+    Rect2F mVisibleCanvasArea;
+    std::vector<CRenderList> mChunkLists;
+    // One per worker of the pool
+    std::vector<std::unique_ptr<CFrameArena>> mRecordArenas;
+
+    CFrameArena mInputArena;
+
+    CRenderThread* mpRenderThread = nullptr;
+
+    CFrameGovernor mFrameGovernor;
+    bool mIsFramePending = false;
+
+    struct RenderStats {
+      unsigned int numRecorded = 0;
+      unsigned int numSkipped = 0;
+      unsigned int numViewsOffScreen = 0;
+    } mRenderStats;
 
     // Handle to window
     HWND mhWnd;
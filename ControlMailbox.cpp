@@ -0,0 +1,51 @@
+// Copyright (c) v1ne
+
+#include "ControlMailbox.h"
+
+static size_t QueueSize(size_t numControls) {
+  size_t size = 1;
+  while(size < numControls)
+    size *= 2;
+  return size;
+}
+
+
+CControlMailbox::CControlMailbox(size_t numControls)
+  : mpSlots(new std::atomic<uint32_t>[numControls]())
+  , mNumControls(numControls)
+  , mpQueue(new uint32_t[QueueSize(numControls)])
+  , mQueueMask(QueueSize(numControls) - 1)
+{}
+
+
+bool CControlMailbox::Post(uint32_t control, uint16_t value) {
+  if(control >= mNumControls)
+    return false;
+
+  if(mpSlots[control].exchange(uint32_t(value) + 1, std::memory_order_acq_rel) != 0) {
+    // The reader takes the new value along with the queued control
+    mNumCoalesced.store(mNumCoalesced.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  const auto writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+  mpQueue[writeIndex & mQueueMask] = control;
+  // Sequentially consistent, like in Take, so that either the reader sees
+  // the control, or the writer sees that it took everything before
+  mWriteIndex.store(writeIndex + 1);
+  return writeIndex == mReadIndex.load();
+}
+
+
+bool CControlMailbox::Take(uint32_t* pControl, uint16_t* pValue) {
+  const auto readIndex = mReadIndex.load(std::memory_order_relaxed);
+  if(readIndex == mWriteIndex.load())
+    return false;
+
+  const auto control = mpQueue[readIndex & mQueueMask];
+  mReadIndex.store(readIndex + 1);
+  // Once it's empty, the writer queues the control again
+  *pControl = control;
+  *pValue = uint16_t(mpSlots[control].exchange(0, std::memory_order_acq_rel) - 1);
+  return true;
+}
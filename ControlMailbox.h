@@ -0,0 +1,43 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Passes values of controls from one writer thread to one reader thread
+// without locks. If a control changes again before the reader takes it, the
+// reader only gets the latest value, so the mailbox can't overflow, however
+// dense the stream is.
+//
+// Each control has a slot for its latest value. The writer queues the
+// control when its slot becomes full, and the reader empties the slot when
+// it takes the value, so a control is queued at most once at any time.
+class CControlMailbox {
+public:
+  explicit CControlMailbox(size_t numControls);
+
+  // Writer. Returns whether the mailbox was empty before, i.e. whether the
+  // reader may need a nudge.
+  bool Post(uint32_t control, uint16_t value);
+  // Reader. Returns false once the mailbox is empty.
+  bool Take(uint32_t* pControl, uint16_t* pValue);
+
+  // Writer. Values that replaced one that the reader didn't take yet.
+  unsigned int NumCoalesced() const { return mNumCoalesced.load(std::memory_order_relaxed); }
+
+private:
+  // The value plus one, 0 while the slot is empty
+  std::unique_ptr<std::atomic<uint32_t>[]> mpSlots;
+  size_t mNumControls;
+
+  // Controls with a full slot, in the order their slots were filled
+  std::unique_ptr<uint32_t[]> mpQueue;
+  size_t mQueueMask;
+  std::atomic<size_t> mWriteIndex{0};
+  std::atomic<size_t> mReadIndex{0};
+
+  std::atomic<unsigned int> mNumCoalesced{0};
+};
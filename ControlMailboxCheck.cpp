@@ -0,0 +1,95 @@
+// Copyright (c) v1ne
+
+#include "ControlMailboxCheck.h"
+
+#include "ControlMailbox.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const size_t sNumControls = 64;
+// Values count up to this in the dense stream
+const uint16_t sNumRounds = 20000;
+
+}
+
+
+bool CheckControlMailbox(std::string* pReport) {
+  auto success = true;
+  char buf[192];
+
+  // Coalescing, order and nudges on one thread
+  {
+    CControlMailbox mailbox(sNumControls);
+    const auto isFirstNudged = mailbox.Post(3, 100);
+    const auto isSecondNudged = mailbox.Post(1, 200);
+    mailbox.Post(3, 101);
+    mailbox.Post(3, 102);
+    const auto isOutOfRangeNudged = mailbox.Post(uint32_t(sNumControls), 0);
+
+    std::string taken;
+    uint32_t control;
+    uint16_t value;
+    while(mailbox.Take(&control, &value)) {
+      snprintf(buf, sizeof(buf), taken.empty() ? "%u=%u" : ", %u=%u", control, value);
+      taken += buf;
+    }
+    const auto isNudgedAgain = mailbox.Post(1, 201);
+
+    const auto isGood = taken == "3=102, 1=200" && mailbox.NumCoalesced() == 2 && isFirstNudged && !isSecondNudged
+      && isNudgedAgain && !isOutOfRangeNudged;
+    snprintf(buf, sizeof(buf), "Coalescing: took %s, %u coalesced, %s%s\n", taken.c_str(), mailbox.NumCoalesced(),
+      isFirstNudged && !isSecondNudged && isNudgedAgain ? "nudged when empty" : "NUDGED WRONGLY",
+      isGood ? "" : ", EXPECTED 3=102, 1=200, 2 coalesced");
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  // A thread posts rounds of increasing values to all controls while this one takes them
+  {
+    CControlMailbox mailbox(sNumControls);
+    std::atomic<bool> isWriterDone{false};
+    std::thread writer([&mailbox, &isWriterDone]() {
+      for(uint16_t round = 1; round <= sNumRounds; ++round)
+        for(uint32_t control = 0; control < sNumControls; ++control)
+          mailbox.Post(control, round);
+      isWriterDone = true;
+    });
+
+    std::vector<uint16_t> lastValues(sNumControls, 0);
+    size_t numTaken = 0, numOlder = 0;
+    for(;;) {
+      // Once the writer is done, what it posted is taken in this pass
+      const auto isLastPass = isWriterDone.load();
+      uint32_t control;
+      uint16_t value;
+      while(mailbox.Take(&control, &value)) {
+        ++numTaken;
+        if(value <= lastValues[control])
+          ++numOlder;
+        lastValues[control] = value;
+      }
+      if(isLastPass)
+        break;
+      std::this_thread::yield();
+    }
+    writer.join();
+
+    size_t numNotLatest = 0;
+    for(const auto value: lastValues)
+      numNotLatest += value != sNumRounds;
+    const auto numPosted = size_t(sNumRounds) * sNumControls;
+    const auto isGood = !numOlder && !numNotLatest && numTaken + mailbox.NumCoalesced() == numPosted;
+    snprintf(buf, sizeof(buf), "Dense stream: %u values posted, %u taken, %u coalesced, %u older than before, "
+      "%u controls not at their last value\n", unsigned(numPosted), unsigned(numTaken), mailbox.NumCoalesced(),
+      unsigned(numOlder), unsigned(numNotLatest));
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  return success;
+}
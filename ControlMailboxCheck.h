@@ -0,0 +1,15 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Posts values to a CControlMailbox and takes them back. A control that's
+// posted again before it's taken has to come out once, with the latest
+// value, and controls have to come out in the order they were first posted.
+// Only the first post to an empty mailbox may ask for a nudge. With a thread
+// that posts a dense stream while this one takes, every control has to end
+// at its last value, and no value may come out older than one before it.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckControlMailbox(std::string* pReport);
@@ -0,0 +1,22 @@
+// Copyright (c) v1ne
+
+#include "ControlModel.h"
+
+#include "ControlState.h"
+
+CControlModel::Control& CControlModel::AddControl(size_t bank, ControlType type, float value) {
+  // Banks without controls in between stay empty
+  while(NumBanks() <= bank)
+    mBankBegin.push_back(mControls.size());
+
+  mControls.push_back({value, CMidiEncoder::sNoValue, type});
+  mBankBegin.back() = mControls.size();
+  return mControls.back();
+}
+
+
+void CControlModel::SetValue(Control& control, float value) {
+  control.value = value;
+  if(mpStateFile)
+    mpStateFile->Store(IndexOf(control), value);
+}
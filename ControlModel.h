@@ -0,0 +1,60 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "MidiEncoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CControlStateFile;
+
+// The controls of all banks. Only the controls of the visible bank have views,
+// which are recycled when another bank is shown. The model keeps everything
+// that has to outlive a view, so it's compact enough for thousands of controls.
+class CControlModel {
+public:
+  enum class ControlType : uint8_t {Slider, Knob};
+
+  struct Control {
+    float value;
+    // What was sent last, so that only changes are sent. Where it's sent
+    // to is up to CMidiRouter.
+    uint16_t lastMidiValue;
+    ControlType type;
+  };
+
+  static uint16_t MidiValue(float value, MidiResolution resolution) {
+    return uint16_t(value * CMidiEncoder::MaxValue(resolution) + 0.5f);
+  }
+
+  // Appends a control to a bank. Controls must be added bank by bank, in the
+  // order of the banks.
+  Control& AddControl(size_t bank, ControlType type, float value);
+
+  size_t NumControls() const { return mControls.size(); }
+  size_t NumBanks() const { return mBankBegin.size() - 1; }
+  // The controls of a bank are contiguous. The first one is the
+  // BankBegin(bank)th of all controls.
+  size_t BankBegin(size_t bank) const { return mBankBegin[bank]; }
+  size_t NumControlsInBank(size_t bank) const { return mBankBegin[bank + 1] - mBankBegin[bank]; }
+  // The pointers stay valid until a control is added
+  Control* BankControls(size_t bank) { return mControls.data() + mBankBegin[bank]; }
+  size_t IndexOf(const Control& control) const { return size_t(&control - mControls.data()); }
+  Control& At(size_t index) { return mControls[index]; }
+
+  // Values that are set from now on are kept in the state file, too
+  void SetStateFile(CControlStateFile* pStateFile) { mpStateFile = pStateFile; }
+  void SetValue(Control& control, float value);
+
+  size_t ResidentBytes() const {
+    return mControls.capacity() * sizeof(Control) + mBankBegin.capacity() * sizeof(size_t);
+  }
+
+private:
+  std::vector<Control> mControls;
+  // Where each bank begins, and where the last one ends
+  std::vector<size_t> mBankBegin = {0};
+  CControlStateFile* mpStateFile = nullptr;
+};
@@ -0,0 +1,137 @@
+// Copyright (c) v1ne
+
+#include "ControlRing.h"
+
+#include <cstring>
+
+static constexpr uint32_t sMagic = 'R' | 'I' << 8 | 'N' << 16 | 'G' << 24;
+static constexpr uint32_t sVersion = 1;
+static constexpr uint64_t sRecordMask = CControlRing::sNumRecords - 1;
+static_assert((CControlRing::sNumRecords & sRecordMask) == 0, "The ring wraps with a mask");
+
+
+bool CControlRing::IsValid(const Ring& ring) {
+  return ring.magic.load(std::memory_order_acquire) == sMagic && ring.version == sVersion
+    && ring.numRecords == sNumRecords && ring.recordSize == sizeof(Record);
+}
+
+
+bool CControlRing::Open(const wchar_t* name) {
+  Close();
+  if(!mMapping.CreateShared(name, sizeof(Ring)))
+    return false;
+
+  mpRing = reinterpret_cast<Ring*>(mMapping.MutableData());
+  if(IsValid(*mpRing)) {
+    mWriteSequence = mpRing->writeSequence.load(std::memory_order_relaxed);
+    return true;
+  }
+
+  // New memory is all zeros, which makes for a ring of empty records
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  mpRing->version = sVersion;
+  mpRing->numRecords = sNumRecords;
+  mpRing->recordSize = sizeof(Record);
+  mpRing->ticksPerSecond = frequency.QuadPart;
+  mWriteSequence = mpRing->writeSequence.load(std::memory_order_relaxed);
+  mpRing->magic.store(sMagic, std::memory_order_release);
+  return true;
+}
+
+
+void CControlRing::Close() {
+  mMapping.Close();
+  mpRing = nullptr;
+}
+
+
+void CControlRing::Publish(size_t control, float value) {
+  if(!mpRing)
+    return;
+
+  LARGE_INTEGER ticks;
+  ::QueryPerformanceCounter(&ticks);
+  uint32_t valueBits;
+  memcpy(&valueBits, &value, sizeof(valueBits));
+
+  auto& record = mpRing->records[mWriteSequence & sRecordMask];
+  // Readers that are in the middle of the record see that it's changing
+  record.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  record.ticks.store(ticks.QuadPart, std::memory_order_relaxed);
+  record.controlAndValue.store(uint64_t(valueBits) << 32 | uint32_t(control), std::memory_order_relaxed);
+  record.sequence.store(mWriteSequence + 1, std::memory_order_release);
+
+  ++mWriteSequence;
+  mpRing->writeSequence.store(mWriteSequence, std::memory_order_release);
+  ++mNumPublished;
+}
+
+
+unsigned int CControlRing::TakeNumPublished() {
+  const auto numPublished = mNumPublished;
+  mNumPublished = 0;
+  return numPublished;
+}
+
+
+bool CControlRingReader::Open(const wchar_t* name) {
+  Close();
+  if(!mMapping.OpenShared(name, sizeof(CControlRing::Ring)))
+    return false;
+
+  mpRing = reinterpret_cast<const CControlRing::Ring*>(mMapping.Data());
+  if(!CControlRing::IsValid(*mpRing)) {
+    Close();
+    return false;
+  }
+
+  mCursor = mpRing->writeSequence.load(std::memory_order_acquire);
+  mNumLost = 0;
+  return true;
+}
+
+
+void CControlRingReader::Close() {
+  mMapping.Close();
+  mpRing = nullptr;
+}
+
+
+size_t CControlRingReader::Read(CControlRing::Value* pValues, size_t maxValues) {
+  if(!mpRing)
+    return 0;
+
+  size_t numRead = 0;
+  auto writeSequence = mpRing->writeSequence.load(std::memory_order_acquire);
+  while(numRead < maxValues && mCursor < writeSequence) {
+    if(writeSequence - mCursor > CControlRing::sNumRecords) {
+      mNumLost += writeSequence - CControlRing::sNumRecords - mCursor;
+      mCursor = writeSequence - CControlRing::sNumRecords;
+    }
+
+    const auto& record = mpRing->records[mCursor & sRecordMask];
+    const auto sequence = record.sequence.load(std::memory_order_acquire);
+    const auto ticks = record.ticks.load(std::memory_order_relaxed);
+    const auto controlAndValue = record.controlAndValue.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(sequence != mCursor + 1 || record.sequence.load(std::memory_order_relaxed) != sequence) {
+      // The writer lapped the cursor, so it's at least a ring ahead. Skip
+      // the record that it may be writing right now, too.
+      writeSequence = mpRing->writeSequence.load(std::memory_order_acquire);
+      const auto oldestSafe = writeSequence + 1 - CControlRing::sNumRecords;
+      mNumLost += oldestSafe - mCursor;
+      mCursor = oldestSafe;
+      continue;
+    }
+
+    auto& value = pValues[numRead++];
+    value.control = uint32_t(controlAndValue);
+    const auto valueBits = uint32_t(controlAndValue >> 32);
+    memcpy(&value.value, &valueBits, sizeof(valueBits));
+    value.ticks = ticks;
+    ++mCursor;
+  }
+  return numRead;
+}
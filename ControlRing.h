@@ -0,0 +1,101 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Publishes control values to other processes on the same machine, e.g. a
+// visualizer, through a ring of records in named shared memory. Values keep
+// their full resolution, and there's no driver in between.
+//
+// There's one writer, which never waits for readers: once the ring is full,
+// it overwrites the oldest record. Each reader keeps a cursor of its own,
+// the sequence number of the next record it reads, so that any number of
+// readers may follow the writer. A reader that falls behind by more than
+// the ring holds skips what was overwritten, and counts it as lost.
+//
+// Each record carries its sequence number plus one, which is stored after
+// the rest of the record, and 0 while the record is written. A reader takes
+// a record if the number is the one it expects, before and after it read
+// the record.
+class CControlRing {
+public:
+  static constexpr uint32_t sNumRecords = 4096;
+
+  struct Value {
+    uint32_t control;
+    float value;
+    // Of QueryPerformanceCounter, which is the same for all processes
+    int64_t ticks;
+  };
+
+  // Creates the ring, or takes over the one that a previous writer left, so
+  // that its readers can carry on
+  bool Open(const wchar_t* name);
+  void Close();
+  bool IsOpen() const { return mpRing != nullptr; }
+
+  void Publish(size_t control, float value);
+
+  // Values published since the last call
+  unsigned int TakeNumPublished();
+
+private:
+  friend class CControlRingReader;
+
+  struct Record {
+    std::atomic<uint64_t> sequence;
+    std::atomic<int64_t> ticks;
+    // The control in the lower half, the bits of the value in the upper one
+    std::atomic<uint64_t> controlAndValue;
+  };
+
+  struct alignas(64) Ring {
+    // Stored last, once the rest of the header is valid
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t numRecords;
+    uint32_t recordSize;
+    int64_t ticksPerSecond;
+    // The sequence number of the next record, on a cache line of its own,
+    // since all readers poll it
+    alignas(64) std::atomic<uint64_t> writeSequence;
+    alignas(64) Record records[sNumRecords];
+  };
+
+  static bool IsValid(const Ring& ring);
+
+  CMappedFile mMapping;
+  Ring* mpRing = nullptr;
+  uint64_t mWriteSequence = 0;
+  unsigned int mNumPublished = 0;
+};
+
+
+// Reads the values of a CControlRing in another process. Never blocks, so
+// readers poll at whatever rate suits them.
+class CControlRingReader {
+public:
+  // Fails if there's no writer yet. Reading starts with the next value
+  // that's published.
+  bool Open(const wchar_t* name);
+  void Close();
+  bool IsOpen() const { return mpRing != nullptr; }
+
+  // Reads up to maxValues values, oldest first. Returns how many were read.
+  size_t Read(CControlRing::Value* pValues, size_t maxValues);
+
+  // Values that were overwritten before they were read
+  uint64_t NumLost() const { return mNumLost; }
+  int64_t TicksPerSecond() const { return mpRing ? mpRing->ticksPerSecond : 0; }
+
+private:
+  CMappedFile mMapping;
+  const CControlRing::Ring* mpRing = nullptr;
+  uint64_t mCursor = 0;
+  uint64_t mNumLost = 0;
+};
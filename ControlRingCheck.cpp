@@ -0,0 +1,149 @@
+// Copyright (c) v1ne
+
+#include "ControlRingCheck.h"
+
+#include "ControlRing.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+const size_t sReadChunk = 300;
+const uint32_t sNumConcurrentValues = 200000;
+
+// The value that goes with the control, so that torn records show
+float ValueOf(uint32_t control) {
+  return float(control % 1000) / 999.f;
+}
+
+
+// Counts the values that are out of order or don't go with their control.
+// pNextControl is the control that's expected next, it's advanced past the
+// values read.
+size_t CountBadValues(const CControlRing::Value* pValues, size_t numValues, uint32_t* pNextControl) {
+  size_t numBad = 0;
+  for(size_t i = 0; i < numValues; ++i) {
+    if(pValues[i].control < *pNextControl || pValues[i].value != ValueOf(pValues[i].control))
+      ++numBad;
+    *pNextControl = pValues[i].control + 1;
+  }
+  return numBad;
+}
+
+
+struct Result {
+  uint64_t numRead = 0;
+  uint64_t numLost = 0;
+  size_t numBad = 0;
+  // The control of the first value read
+  uint32_t firstControl = 0;
+};
+
+
+// Reads until nothing is left
+void ReadAll(CControlRingReader& reader, uint32_t* pNextControl, Result* pResult) {
+  CControlRing::Value values[sReadChunk];
+  for(;;) {
+    const auto numRead = reader.Read(values, sReadChunk);
+    if(!numRead)
+      break;
+    if(!pResult->numRead)
+      pResult->firstControl = values[0].control;
+    pResult->numBad += CountBadValues(values, numRead, pNextControl);
+    pResult->numRead += numRead;
+  }
+  pResult->numLost = reader.NumLost();
+}
+
+
+void Report(const char* name, const Result& result, uint64_t numPublished, std::string* pReport) {
+  char buf[160];
+  wsprintfA(buf, "%s: %u published, %u read, %u lost, %u bad\n", name, unsigned(numPublished),
+    unsigned(result.numRead), unsigned(result.numLost), unsigned(result.numBad));
+  *pReport += buf;
+}
+
+}
+
+
+bool CheckControlRing(std::string* pReport) {
+  wchar_t name[64];
+  wsprintfW(name, L"Local\\Win32TouchSlidersRingCheck%u", ::GetCurrentProcessId());
+
+  CControlRing ring;
+  CControlRingReader reader;
+  if(!ring.Open(name) || !reader.Open(name)) {
+    *pReport += "Can't open the ring\n";
+    return false;
+  }
+
+  auto success = true;
+  uint32_t numPublished = 0;
+
+  // A reader that keeps up sees every value, across the wrap
+  {
+    const auto first = numPublished;
+    auto nextControl = first;
+    Result result;
+    for(int chunk = 0; chunk < 13; ++chunk) {
+      for(int i = 0; i < 1001; ++i, ++numPublished)
+        ring.Publish(numPublished, ValueOf(numPublished));
+      ReadAll(reader, &nextControl, &result);
+    }
+    Report("Across the wrap", result, numPublished - first, pReport);
+    success &= result.numRead == numPublished - first && !result.numLost && !result.numBad
+      && result.firstControl == first;
+  }
+
+  // A lapped reader gets the newest ring of values and loses the rest
+  {
+    reader.Open(name);
+    const auto first = numPublished;
+    auto nextControl = first;
+    for(uint32_t i = 0; i < 2 * CControlRing::sNumRecords + 100; ++i, ++numPublished)
+      ring.Publish(numPublished, ValueOf(numPublished));
+    Result result;
+    ReadAll(reader, &nextControl, &result);
+    Report("Lapped", result, numPublished - first, pReport);
+    success &= result.numRead == CControlRing::sNumRecords
+      && result.numLost == CControlRing::sNumRecords + 100 && !result.numBad
+      && result.firstControl == numPublished - CControlRing::sNumRecords;
+  }
+
+  // A reader that polls while the writer runs sees no torn values, and
+  // accounts for every value. It dozes off now and then, so that it's lapped.
+  {
+    reader.Open(name);
+    const auto first = numPublished;
+    auto nextControl = first;
+    std::atomic<bool> isDone{false};
+    std::thread writer([&] {
+      for(uint32_t control = first; control < first + sNumConcurrentValues; ++control) {
+        ring.Publish(control, ValueOf(control));
+        if(control % 64 == 0)
+          std::this_thread::yield();
+      }
+      isDone = true;
+    });
+
+    Result result;
+    for(int poll = 0; !isDone; ++poll) {
+      ReadAll(reader, &nextControl, &result);
+      ::Sleep(poll % 8 ? 0 : 1);
+    }
+    writer.join();
+    ReadAll(reader, &nextControl, &result);
+    numPublished += sNumConcurrentValues;
+
+    Report("Concurrent", result, sNumConcurrentValues, pReport);
+    success &= result.numRead + result.numLost == sNumConcurrentValues && !result.numBad
+      && nextControl == numPublished;
+  }
+
+  reader.Close();
+  ring.Close();
+  return success;
+}
@@ -0,0 +1,14 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Drives a CControlRing and CControlRingReader in this process: a reader that
+// keeps up across several wraps of the ring, one that the writer laps, and
+// one that polls while a thread publishes. Each has to read the values in
+// the order they were published, intact, and count every value it missed
+// as lost.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckControlRing(std::string* pReport);
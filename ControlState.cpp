@@ -0,0 +1,116 @@
+// Copyright (c) v1ne
+
+#include "ControlState.h"
+
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+struct StateFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t numRecords;
+  uint64_t layoutFingerprint;
+  uint64_t reserved;
+};
+
+}
+
+static_assert(sizeof(StateFileHeader) % sizeof(uint64_t) == 0, "Records must stay aligned");
+// is_always_lock_free would need C++17
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && ATOMIC_LLONG_LOCK_FREE == 2,
+  "Records are stored in place through std::atomic");
+
+static constexpr uint32_t sStateMagic = 0x54415453; // "STAT"
+static constexpr uint32_t sStateVersion = 1;
+
+// A record is the bits of the value, the lower 16 bits of the index of the
+// control and a 16-bit check. The check always has the top bit set, so that
+// the zeros of a new file don't count as valid records.
+static constexpr uint64_t sCheckValidBit = 0x8000;
+
+
+CControlStateFile::~CControlStateFile() {
+  Close();
+}
+
+
+bool CControlStateFile::Open(const wchar_t* path, size_t numControls, uint64_t layoutFingerprint) {
+  Close();
+
+  const auto size = sizeof(StateFileHeader) + numControls * sizeof(uint64_t);
+  if(numControls == 0 || !mFile.OpenForWriting(path, size))
+    return false;
+
+  auto* pData = mFile.MutableData();
+  StateFileHeader header;
+  memcpy(&header, pData, sizeof(header));
+  if(header.magic != sStateMagic || header.version != sStateVersion
+      || header.numRecords != numControls || header.layoutFingerprint != layoutFingerprint) {
+    // The magic goes in last, so that a header that's only half written
+    // doesn't count
+    header = {0, sStateVersion, numControls, layoutFingerprint, 0};
+    memcpy(pData, &header, sizeof(header));
+    memset(pData + sizeof(header), 0, numControls * sizeof(uint64_t));
+    mFile.Flush();
+    header.magic = sStateMagic;
+    memcpy(pData, &header.magic, sizeof(header.magic));
+  }
+
+  mpRecords = reinterpret_cast<uint64_t*>(pData + sizeof(StateFileHeader));
+  mNumRecords = numControls;
+  mLayoutFingerprint = layoutFingerprint;
+  return true;
+}
+
+
+void CControlStateFile::Close() {
+  if(mFile.IsOpen())
+    mFile.Flush();
+  mFile.Close();
+  mpRecords = nullptr;
+  mNumRecords = 0;
+}
+
+
+uint64_t CControlStateFile::Record(size_t control, float value) const {
+  uint32_t valueBits;
+  memcpy(&valueBits, &value, sizeof(valueBits));
+  const auto index = uint64_t(control & 0xFFFF);
+
+  // FNV-1a, over the value, the index and the layout
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for(auto word: {uint64_t(valueBits), uint64_t(control), mLayoutFingerprint}) {
+    for(int byte = 0; byte < 8; ++byte) {
+      hash ^= (word >> (8 * byte)) & 0xFF;
+      hash *= 0x100000001b3ull;
+    }
+  }
+  const auto check = ((hash ^ (hash >> 16) ^ (hash >> 32) ^ (hash >> 48)) & 0xFFFF) | sCheckValidBit;
+
+  return uint64_t(valueBits) | index << 32 | check << 48;
+}
+
+
+bool CControlStateFile::Load(size_t control, float* pValue) const {
+  if(control >= mNumRecords)
+    return false;
+
+  const auto record = reinterpret_cast<const std::atomic<uint64_t>*>(&mpRecords[control])->load(std::memory_order_relaxed);
+  uint32_t valueBits = uint32_t(record);
+  float value;
+  memcpy(&value, &valueBits, sizeof(value));
+  if(record != Record(control, value) || !(value >= 0.f && value <= 1.f))
+    return false;
+
+  *pValue = value;
+  return true;
+}
+
+
+void CControlStateFile::Store(size_t control, float value) {
+  if(control >= mNumRecords)
+    return;
+  reinterpret_cast<std::atomic<uint64_t>*>(&mpRecords[control])->store(Record(control, value), std::memory_order_relaxed);
+}
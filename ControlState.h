@@ -0,0 +1,40 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Keeps the value of every control in a small mapped file, so that they
+// survive a crash and the next start can pick up where the last one ended.
+//
+// Each value is a record of its own, which is written with a single 8-byte
+// store and carries a checksum. A record is either the old or the new one,
+// even if the process is killed while it's written. Records that don't
+// check out, e.g. after a power loss, are ignored. Nothing is flushed
+// while controls are moved, only when the file is closed.
+class CControlStateFile {
+public:
+  ~CControlStateFile();
+
+  // Maps the state for numControls controls. If the file was written for a
+  // different layout, or isn't a state file at all, its records are cleared.
+  bool Open(const wchar_t* path, size_t numControls, uint64_t layoutFingerprint);
+  // Flushes and unmaps the file
+  void Close();
+  bool IsOpen() const { return mpRecords != nullptr; }
+
+  // Returns whether the file has a valid value for the control
+  bool Load(size_t control, float* pValue) const;
+  void Store(size_t control, float value);
+
+private:
+  uint64_t Record(size_t control, float value) const;
+
+  CMappedFile mFile;
+  uint64_t* mpRecords = nullptr;
+  size_t mNumRecords = 0;
+  uint64_t mLayoutFingerprint = 0;
+};
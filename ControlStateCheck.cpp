@@ -0,0 +1,159 @@
+// Copyright (c) v1ne
+
+#include "ControlStateCheck.h"
+
+#include "ControlState.h"
+#include "MappedFile.h"
+
+#include <windows.h>
+
+static constexpr size_t sNumControls = 5000;
+static constexpr uint64_t sLayoutFingerprint = 0x5354415445434B31ull;
+static constexpr int sNumRounds = 20;
+static constexpr DWORD sWriterStartTimeoutMs = 10000;
+
+// What the writer stores in the given pass
+static float WriterValue(size_t control, unsigned int pass) {
+  return float((control + pass) % 1000) / 999.f;
+}
+
+
+// The pass in which the writer stored the value
+static unsigned int WriterPass(size_t control, float value) {
+  return unsigned(int(value * 999.f + 0.5f) + 1000 - int(control % 1000)) % 1000;
+}
+
+
+// Returns the number of valid records. pNumBehind receives how many of them
+// are from another pass than the first record, i.e. the writer was killed in
+// the middle of a pass if it's not 0.
+static size_t CountValidRecords(const wchar_t* path, uint64_t layoutFingerprint, size_t* pNumBehind) {
+  CControlStateFile file;
+  if(!file.Open(path, sNumControls, layoutFingerprint))
+    return 0;
+
+  size_t numValid = 0;
+  auto firstPass = 0u;
+  *pNumBehind = 0;
+  for(size_t control = 0; control < sNumControls; ++control) {
+    float value;
+    if(!file.Load(control, &value))
+      continue;
+    if(!numValid++)
+      firstPass = WriterPass(control, value);
+    else if(WriterPass(control, value) != firstPass)
+      ++*pNumBehind;
+  }
+  return numValid;
+}
+
+
+// Runs the writer and kills it after delayMs. Returns false if it didn't start.
+static bool RunAndKillWriter(const wchar_t* path, int round, DWORD delayMs) {
+  wchar_t eventName[64];
+  wsprintfW(eventName, L"Local\\Win32TouchSlidersStateCheck%u_%d", ::GetCurrentProcessId(), round);
+  const auto hReady = ::CreateEventW(nullptr, TRUE, FALSE, eventName);
+  if(!hReady)
+    return false;
+
+  wchar_t exePath[MAX_PATH];
+  ::GetModuleFileNameW(nullptr, exePath, MAX_PATH);
+  auto commandLine = std::wstring(L"\"") + exePath + L"\" /state-writer \"" + path + L"\" " + eventName;
+
+  STARTUPINFOW startupInfo = {sizeof(startupInfo)};
+  PROCESS_INFORMATION processInfo;
+  if(!::CreateProcessW(nullptr, &commandLine[0], nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr,
+      &startupInfo, &processInfo)) {
+    ::CloseHandle(hReady);
+    return false;
+  }
+
+  const auto isStarted = ::WaitForSingleObject(hReady, sWriterStartTimeoutMs) == WAIT_OBJECT_0;
+  if(isStarted)
+    ::Sleep(delayMs);
+  ::TerminateProcess(processInfo.hProcess, 1);
+  ::WaitForSingleObject(processInfo.hProcess, INFINITE);
+
+  ::CloseHandle(processInfo.hThread);
+  ::CloseHandle(processInfo.hProcess);
+  ::CloseHandle(hReady);
+  return isStarted;
+}
+
+
+bool CheckControlStateFile(std::string* pReport) {
+  wchar_t tempDir[MAX_PATH];
+  wchar_t path[MAX_PATH];
+  if(!::GetTempPathW(MAX_PATH, tempDir) || !::GetTempFileNameW(tempDir, L"cst", 0, path)) {
+    *pReport += "Can't create a temporary file\n";
+    return false;
+  }
+
+  // Every record starts out valid, so any invalid one is the writer's fault
+  {
+    CControlStateFile file;
+    if(!file.Open(path, sNumControls, sLayoutFingerprint)) {
+      *pReport += "Can't open the state file\n";
+      ::DeleteFileW(path);
+      return false;
+    }
+    for(size_t control = 0; control < sNumControls; ++control)
+      file.Store(control, WriterValue(control, 0));
+  }
+
+  auto success = true;
+  char buf[128];
+  for(int round = 0; round < sNumRounds; ++round) {
+    if(!RunAndKillWriter(path, round, DWORD(round % 7))) {
+      *pReport += "The writer didn't start\n";
+      success = false;
+      break;
+    }
+
+    size_t numBehind;
+    const auto numValid = CountValidRecords(path, sLayoutFingerprint, &numBehind);
+    wsprintfA(buf, "Killed writer %d: %u of %u records valid, %u from the pass before\n", round,
+      unsigned(numValid), unsigned(sNumControls), unsigned(numBehind));
+    *pReport += buf;
+    success &= numValid == sNumControls;
+  }
+
+  // A damaged record is rejected, the others aren't
+  {
+    CMappedFile rawFile;
+    size_t size = 0;
+    if(rawFile.OpenForReading(path))
+      size = rawFile.Size();
+    if(size >= 8 && rawFile.OpenForWriting(path, size))
+      rawFile.MutableData()[size - 8 + 1] ^= 0x55;
+  }
+  size_t numBehind;
+  auto numValid = CountValidRecords(path, sLayoutFingerprint, &numBehind);
+  wsprintfA(buf, "Damaged a record: %u valid\n", unsigned(numValid));
+  *pReport += buf;
+  success &= numValid == sNumControls - 1;
+
+  // A file of another layout is cleared
+  numValid = CountValidRecords(path, sLayoutFingerprint + 1, &numBehind);
+  wsprintfA(buf, "Other layout: %u valid\n", unsigned(numValid));
+  *pReport += buf;
+  success &= numValid == 0;
+
+  ::DeleteFileW(path);
+  return success;
+}
+
+
+int RunControlStateWriter(const wchar_t* path, const wchar_t* readyEventName) {
+  CControlStateFile file;
+  if(!file.Open(path, sNumControls, sLayoutFingerprint))
+    return 1;
+
+  const auto hReady = ::OpenEventW(EVENT_MODIFY_STATE, FALSE, readyEventName);
+  for(unsigned int pass = 1;; ++pass) {
+    for(size_t control = 0; control < sNumControls; ++control)
+      file.Store(control, WriterValue(control, pass));
+    if(pass == 1 && hReady)
+      ::SetEvent(hReady);
+  }
+}
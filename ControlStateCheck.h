@@ -0,0 +1,19 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Checks that CControlStateFile keeps every record valid if the process is
+// killed while it writes: a child process rewrites all records in a loop and
+// is terminated at some point of it, then the records are loaded again.
+// Also checks that a damaged record and a state file of another layout are
+// rejected.
+//
+// Returns whether all checks passed. pReport receives a line per round.
+bool CheckControlStateFile(std::string* pReport);
+
+// The child process of CheckControlStateFile. Signals the event once all
+// records have been written and keeps rewriting them until it's killed.
+// Only returns if the file can't be opened.
+int RunControlStateWriter(const wchar_t* path, const wchar_t* readyEventName);
@@ -0,0 +1,369 @@
+// Copyright (c) v1ne
+
+#include "CpuRenderer.h"
+
+#include <algorithm>
+
+#include <math.h>
+
+namespace {
+
+struct GradientStop {
+  uint32_t rgb;
+  float opacity;
+  float position;
+};
+
+// Same colors as the brushes of CD2DDriver::CreateDeviceResources
+struct BrushStyle {
+  GradientStop start;
+  GradientStop end;
+};
+
+BrushStyle StyleOf(BrushId id) {
+  switch(id) {
+  case BrushId::Black: return {{0x000000, 1.f, 0.f}, {0x000000, 1.f, 1.f}};
+  case BrushId::White: return {{0xFFFFFF, 1.f, 0.f}, {0xFFFFFF, 1.f, 1.f}};
+  case BrushId::LightGrey: return {{0xD3D3D3, 1.f, 0.f}, {0xD3D3D3, 1.f, 1.f}};
+  case BrushId::DarkGrey: return {{0xA9A9A9, 1.f, 0.f}, {0xA9A9A9, 1.f, 1.f}};
+  case BrushId::DimGrey: return {{0x696969, 1.f, 0.f}, {0x696969, 1.f, 1.f}};
+  case BrushId::Cornflower: return {{0x6495ED, 1.f, 0.f}, {0x6495ED, 1.f, 1.f}};
+  case BrushId::SomePinkishBlue: return {{0x7B68EE, 1.f, 0.f}, {0x7B68EE, 1.f, 1.f}};
+  case BrushId::SomeGreenish: return {{0x3CB371, 1.f, 0.f}, {0x3CB371, 1.f, 1.f}};
+  case BrushId::SomeOrangish: return {{0xFF8C00, 1.f, 0.f}, {0xFF8C00, 1.f, 1.f}};
+  case BrushId::SomeReddish: return {{0xB22222, 1.f, 0.f}, {0xB22222, 1.f, 1.f}};
+  case BrushId::SemitransparentDark: return {{0x000000, 0.4f, 0.f}, {0x000000, 0.4f, 1.f}};
+  case BrushId::GradientGlossy: return {{0xFFFFFF, 0.5f, 0.3f}, {0xFFFFFF, 0.f, 1.f}};
+  case BrushId::GradientBlue: return {{0x00008B, 1.f, 0.f}, {0x00FFFF, 1.f, 1.f}};
+  case BrushId::GradientOrange: return {{0xFF4500, 1.f, 0.f}, {0xFFFF00, 1.f, 1.f}};
+  case BrushId::GradientRed: return {{0x800000, 1.f, 0.f}, {0xFF0000, 1.f, 1.f}};
+  case BrushId::GradientGreen: return {{0x008000, 1.f, 0.f}, {0xADFF2F, 1.f, 1.f}};
+  case BrushId::GradientBackground: return {{0x000000, 1.f, 0.f}, {0x778899, 1.f, 1.f}};
+  }
+  return {{0x000000, 1.f, 0.f}, {0x000000, 1.f, 1.f}};
+}
+
+// 3x5 pixel glyphs, one row per entry, with the leftmost pixel in bit 2
+struct Glyph {
+  char c;
+  uint8_t rows[5];
+};
+
+const Glyph sGlyphs[] = {
+  {'0', {7, 5, 5, 5, 7}},
+  {'1', {2, 6, 2, 2, 7}},
+  {'2', {7, 1, 7, 4, 7}},
+  {'3', {7, 1, 7, 1, 7}},
+  {'4', {5, 5, 7, 1, 1}},
+  {'5', {7, 4, 7, 1, 7}},
+  {'6', {7, 4, 7, 5, 7}},
+  {'7', {7, 1, 1, 1, 1}},
+  {'8', {7, 5, 7, 5, 7}},
+  {'9', {7, 5, 7, 1, 7}},
+  {'%', {5, 1, 2, 4, 5}},
+  {'-', {0, 0, 7, 0, 0}},
+};
+
+const Glyph* GlyphOf(char c) {
+  for(const auto& glyph: sGlyphs)
+    if(glyph.c == c)
+      return &glyph;
+  return nullptr;
+}
+
+// Same sizes as the text formats of CD2DDriver
+float FontSizeOf(TextStyle style) {
+  return style == TextStyle::Medium ? 18.f : 12.f;
+}
+
+constexpr auto sNumSubScanlines = 4;
+
+} // namespace
+
+
+CCpuRenderer::CCpuRenderer(int width, int height) {
+  Resize(width, height);
+}
+
+
+CCpuRenderer::CCpuRenderer(uint32_t* pPixels, int width, int height)
+  : mWidth(width)
+  , mHeight(height)
+  , mpPixels(pPixels)
+{ }
+
+
+void CCpuRenderer::Resize(int width, int height) {
+  mWidth = width;
+  mHeight = height;
+  mOwnPixels.assign(size_t(width) * height, 0xFFFFFFFF);
+  mpPixels = mOwnPixels.data();
+}
+
+
+Rect2F CCpuRenderer::Viewport() const {
+  return Rect2F{0.f, 0.f, float(mWidth), float(mHeight)};
+}
+
+
+bool CCpuRenderer::BeginDraw() {
+  mClip = Rect2F{0.f, 0.f, float(mWidth), float(mHeight)};
+  mClipStack.clear();
+  return true;
+}
+
+
+bool CCpuRenderer::EndDraw() {
+  return mClipStack.empty();
+}
+
+
+void CCpuRenderer::Clear() {
+  if(mClip.IsEmpty())
+    return;
+
+  for(auto y = int(mClip.top); y < int(mClip.bottom); ++y) {
+    auto* pRow = mpPixels + size_t(y) * mWidth;
+    for(auto x = int(mClip.left); x < int(mClip.right); ++x)
+      pRow[x] = 0xFFFFFFFF;
+  }
+}
+
+
+void CCpuRenderer::SetTransform(const Transform2F& transform) {
+  mTransform = transform;
+  if(!transform.Invert(&mInverseTransform))
+    mInverseTransform = Transform2F::Identity();
+}
+
+
+void CCpuRenderer::PushClip(const Rect2F& rect) {
+  mClipStack.push_back(mClip);
+
+  // Pixels are inside if their centers are, like with aliased D2D clips
+  const auto bounds = mTransform.Apply(rect);
+  const auto snapped = Rect2F{::roundf(bounds.left), ::roundf(bounds.top), ::roundf(bounds.right), ::roundf(bounds.bottom)};
+  mClip = Intersection(mClip, snapped);
+}
+
+
+void CCpuRenderer::PopClip() {
+  if(mClipStack.empty())
+    return;
+
+  mClip = mClipStack.back();
+  mClipStack.pop_back();
+}
+
+
+void CCpuRenderer::FillRect(const Rect2F& rect, const Brush& brush) {
+  const Point2F corners[4] = {rect.TopLeft(), {rect.right, rect.top}, rect.BottomRight(), {rect.left, rect.bottom}};
+  FillPolygon(corners, 4, brush);
+}
+
+
+void CCpuRenderer::FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush) {
+  const auto size = rect.Size();
+  radius = {::fminf(radius.x, size.x / 2), ::fminf(radius.y, size.y / 2)};
+  if(radius.x <= 0.f || radius.y <= 0.f) {
+    FillRect(rect, brush);
+    return;
+  }
+
+  // Clockwise on screen, starting with the top-left corner
+  const Point2F centers[4] = {
+    {rect.left + radius.x, rect.top + radius.y}, {rect.right - radius.x, rect.top + radius.y},
+    {rect.right - radius.x, rect.bottom - radius.y}, {rect.left + radius.x, rect.bottom - radius.y}};
+  const auto segmentsPerCorner = 8;
+
+  Point2F points[4 * (segmentsPerCorner + 1)];
+  auto numPoints = size_t(0);
+  for(int corner = 0; corner < 4; ++corner) {
+    for(int i = 0; i <= segmentsPerCorner; ++i) {
+      const auto radAngle = 3.14159265f * (1.f + 0.5f * (corner + float(i) / segmentsPerCorner));
+      points[numPoints++] = centers[corner] + Point2F{radius.x * ::cosf(radAngle), radius.y * ::sinf(radAngle)};
+    }
+  }
+  FillPolygon(points, numPoints, brush);
+}
+
+
+void CCpuRenderer::FillEllipse(Point2F center, Point2F radius, const Brush& brush) {
+  // Enough segments to keep the error well below a pixel
+  const auto scale = ::sqrtf(::fabsf(mTransform.m11 * mTransform.m22 - mTransform.m12 * mTransform.m21));
+  const auto numSegments = int(::fminf(128.f, ::fmaxf(16.f, ::ceilf(::fmaxf(radius.x, radius.y) * scale))));
+
+  mPolygon.resize(size_t(numSegments));
+  for(int i = 0; i < numSegments; ++i) {
+    const auto radAngle = 2.f * 3.14159265f * float(i) / numSegments;
+    mPolygon[i] = center + Point2F{radius.x * ::cosf(radAngle), radius.y * ::sinf(radAngle)};
+  }
+  FillPolygon(mPolygon.data(), mPolygon.size(), brush);
+}
+
+
+void CCpuRenderer::FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush) {
+  Point2F corners[4];
+  TiltedRectCorners(base, distance, degAngle, size, corners);
+  FillPolygon(corners, 4, brush);
+}
+
+
+// Centered horizontally and aligned to the top, like the DirectWrite formats
+void CCpuRenderer::Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text) {
+  const auto fontSize = FontSizeOf(style);
+  const auto unit = fontSize / 8.f;
+  const auto advance = 4 * unit;
+
+  size_t len = 0;
+  while(len < 16 && text[len])
+    ++len;
+  if(!len)
+    return;
+
+  const auto width = len * advance - unit;
+  auto left = (rect.left + rect.right) / 2.f - width / 2.f;
+  const auto top = rect.top + 0.15f * fontSize;
+
+  for(size_t i = 0; i < len; ++i, left += advance) {
+    const auto* pGlyph = GlyphOf(text[i]);
+    if(!pGlyph)
+      continue;
+
+    for(int row = 0; row < 5; ++row) {
+      // Fill runs of pixels at once, so that there are no seams within them
+      const auto bits = pGlyph->rows[row];
+      for(int column = 0; column < 3; ) {
+        if(!(bits & (4 >> column))) {
+          ++column;
+          continue;
+        }
+
+        auto runEnd = column + 1;
+        while(runEnd < 3 && (bits & (4 >> runEnd)))
+          ++runEnd;
+
+        const auto y = top + row * unit;
+        FillRect({left + column * unit, y, left + runEnd * unit, y + unit}, brush);
+        column = runEnd;
+      }
+    }
+  }
+}
+
+
+CCpuRenderer::Color CCpuRenderer::Shade(const Brush& brush, Point2F devicePos) const {
+  const auto style = StyleOf(brush.id);
+
+  auto t = 0.f;
+  if(brush.IsGradient()) {
+    // Gradient points are in the coordinates of the current transform, like with D2D
+    const auto pos = mInverseTransform.Apply(devicePos);
+    const auto axis = brush.end - brush.start;
+    const auto axisLengthSquared = axis.x * axis.x + axis.y * axis.y;
+    if(axisLengthSquared > 0.f) {
+      const auto relative = pos - brush.start;
+      t = (relative.x * axis.x + relative.y * axis.y) / axisLengthSquared;
+    }
+  }
+
+  auto weight = 0.f;
+  if(t >= style.end.position)
+    weight = 1.f;
+  else if(t > style.start.position)
+    weight = (t - style.start.position) / (style.end.position - style.start.position);
+
+  const auto channel = [weight](uint32_t start, uint32_t end, int shift) {
+    return ((1.f - weight) * ((start >> shift) & 0xFF) + weight * ((end >> shift) & 0xFF)) / 255.f;
+  };
+  const auto alpha = (1.f - weight) * style.start.opacity + weight * style.end.opacity;
+  return {
+    alpha * channel(style.start.rgb, style.end.rgb, 16),
+    alpha * channel(style.start.rgb, style.end.rgb, 8),
+    alpha * channel(style.start.rgb, style.end.rgb, 0),
+    alpha};
+}
+
+
+void CCpuRenderer::FillPolygon(const Point2F* points, size_t numPoints, const Brush& brush) {
+  if(numPoints < 3 || mClip.IsEmpty())
+    return;
+
+  mDevicePolygon.resize(numPoints);
+  auto* pDevice = mDevicePolygon.data();
+
+  for(size_t i = 0; i < numPoints; ++i)
+    pDevice[i] = mTransform.Apply(points[i]);
+  const auto bounds = Rect2F::BoundsOf(pDevice, numPoints);
+
+  const auto clipped = Intersection(Rect2F{::floorf(bounds.left), ::floorf(bounds.top),
+    ::ceilf(bounds.right), ::ceilf(bounds.bottom)}, mClip);
+  if(clipped.IsEmpty())
+    return;
+
+  const auto x0 = int(clipped.left);
+  const auto x1 = int(clipped.right);
+  const auto y0 = int(clipped.top);
+  const auto y1 = int(clipped.bottom);
+  mCoverage.resize(size_t(x1 - x0));
+
+  const auto isSolid = !brush.IsGradient();
+  const auto solidColor = isSolid ? Shade(brush, {}) : Color{};
+
+  for(auto y = y0; y < y1; ++y) {
+    std::fill(mCoverage.begin(), mCoverage.end(), 0.f);
+    auto coveredBegin = x1;
+    auto coveredEnd = x0;
+
+    for(int sub = 0; sub < sNumSubScanlines; ++sub) {
+      const auto sy = y + (sub + 0.5f) / sNumSubScanlines;
+
+      // The polygon is convex, so the scanline enters and leaves it once
+      auto left = clipped.right;
+      auto right = clipped.left;
+      for(size_t i = 0; i < numPoints; ++i) {
+        const auto& p = pDevice[i];
+        const auto& q = pDevice[(i + 1) % numPoints];
+        if((p.y <= sy && q.y > sy) || (q.y <= sy && p.y > sy)) {
+          const auto x = p.x + (sy - p.y) * (q.x - p.x) / (q.y - p.y);
+          left = ::fminf(left, x);
+          right = ::fmaxf(right, x);
+        }
+      }
+
+      left = ::fmaxf(left, clipped.left);
+      right = ::fminf(right, clipped.right);
+      if(right <= left)
+        continue;
+
+      const auto begin = int(::floorf(left));
+      const auto end = int(::ceilf(right));
+      for(auto x = begin; x < end; ++x) {
+        const auto overlap = ::fminf(float(x + 1), right) - ::fmaxf(float(x), left);
+        mCoverage[x - x0] += overlap / sNumSubScanlines;
+      }
+      coveredBegin = begin < coveredBegin ? begin : coveredBegin;
+      coveredEnd = end > coveredEnd ? end : coveredEnd;
+    }
+
+    auto* pRow = mpPixels + size_t(y) * mWidth;
+    for(auto x = coveredBegin; x < coveredEnd; ++x) {
+      const auto coverage = ::fminf(1.f, mCoverage[x - x0]);
+      if(coverage <= 0.f)
+        continue;
+
+      const auto color = isSolid ? solidColor : Shade(brush, {x + 0.5f, y + 0.5f});
+      const auto srcAlpha = color.a * coverage;
+      if(srcAlpha <= 0.f)
+        continue;
+
+      // Source-over with premultiplied colors
+      const auto dst = pRow[x];
+      const auto inverse = 1.f - srcAlpha;
+      const auto blend = [&](float src, int shift) {
+        return uint32_t(::fminf(255.f, src * coverage * 255.f + ((dst >> shift) & 0xFF) * inverse + 0.5f)) << shift;
+      };
+      pRow[x] = blend(color.a, 24) | blend(color.r, 16) | blend(color.g, 8) | blend(color.b, 0);
+    }
+  }
+}
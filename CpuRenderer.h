@@ -0,0 +1,72 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "Renderer.h"
+
+#include <cstdint>
+#include <vector>
+
+// Rasterizes frames into a memory buffer, without any dependency on Windows,
+// so that the paint path can run headless. Pixels are premultiplied BGRA,
+// like the ones of the D2D render target.
+//
+// Shapes are antialiased with 4 sub-scanlines per pixel. Text uses a tiny
+// built-in font, which only covers digits and the percent sign.
+class CCpuRenderer: public CRenderer {
+public:
+  CCpuRenderer(int width, int height);
+  // Renders into pixels owned by someone else, e.g. to share them between
+  // renderers that work on separate parts of the frame
+  CCpuRenderer(uint32_t* pPixels, int width, int height);
+
+  void Resize(int width, int height);
+
+  int Width() const { return mWidth; }
+  int Height() const { return mHeight; }
+  const uint32_t* Pixels() const { return mpPixels; }
+  uint32_t Pixel(int x, int y) const { return mpPixels[size_t(y) * mWidth + x]; }
+
+protected:
+  bool BeginDraw() override;
+  bool EndDraw() override;
+  void Clear() override;
+  Rect2F Viewport() const override;
+
+  void SetTransform(const Transform2F& transform) override;
+  void FillRect(const Rect2F& rect, const Brush& brush) override;
+  void FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush) override;
+  void FillEllipse(Point2F center, Point2F radius, const Brush& brush) override;
+  void FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush) override;
+  void Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text) override;
+
+  void PushClip(const Rect2F& rect) override;
+  void PopClip() override;
+
+private:
+  // Premultiplied
+  struct Color {
+    float r, g, b, a;
+  };
+
+  // Fills a convex polygon, given in the coordinates of the current transform
+  void FillPolygon(const Point2F* points, size_t numPoints, const Brush& brush);
+  Color Shade(const Brush& brush, Point2F devicePos) const;
+
+  int mWidth = 0;
+  int mHeight = 0;
+  std::vector<uint32_t> mOwnPixels;
+  uint32_t* mpPixels = nullptr;
+
+  Transform2F mTransform = Transform2F::Identity();
+  Transform2F mInverseTransform = Transform2F::Identity();
+
+  // Device pixels, aligned to the pixel grid
+  Rect2F mClip;
+  std::vector<Rect2F> mClipStack;
+
+  // Scratch buffers, so that painting doesn't allocate
+  std::vector<Point2F> mPolygon;
+  std::vector<Point2F> mDevicePolygon;
+  std::vector<float> mCoverage;
+};
@@ -0,0 +1,174 @@
+// Copyright (c) v1ne
+
+#include "D2DRenderer.h"
+
+CD2DRenderer::CD2DRenderer(CD2DDriver* pD2dDriver)
+  : mD2dDriver(pD2dDriver)
+{
+  using Color = D2D1::ColorF;
+  auto& resources = mD2dDriver->Resources();
+  const auto solid = [&](BrushId id, Color::Enum color, float opacity) {
+    mBrushes[size_t(id)] = resources.RegisterSolidBrush(Color(color, opacity));
+  };
+  const auto gradient = [&](BrushId id, Color::Enum startColor, float startOpacity, float startPos,
+      Color::Enum endColor, float endOpacity, float endPos) {
+    mBrushes[size_t(id)] = resources.RegisterGradientBrush(
+      Color(startColor, startOpacity), startPos, Color(endColor, endOpacity), endPos);
+  };
+
+  solid(BrushId::Black, Color::Black, 1.f);
+  solid(BrushId::White, Color::White, 1.f);
+  solid(BrushId::LightGrey, Color::LightGray, 1.f);
+  solid(BrushId::DarkGrey, Color::DarkGray, 1.f);
+  solid(BrushId::DimGrey, Color::DimGray, 1.f);
+  solid(BrushId::Cornflower, Color::CornflowerBlue, 1.f);
+  solid(BrushId::SomePinkishBlue, Color::MediumSlateBlue, 1.f);
+  solid(BrushId::SomeGreenish, Color::MediumSeaGreen, 1.f);
+  solid(BrushId::SomeOrangish, Color::DarkOrange, 1.f);
+  solid(BrushId::SomeReddish, Color::Firebrick, 1.f);
+  solid(BrushId::SemitransparentDark, Color::Black, 0.4f);
+  gradient(BrushId::GradientGlossy, Color::White, 0.5f, 0.3f, Color::White, 0.f, 1.f);
+  gradient(BrushId::GradientBlue, Color::Aqua, 1.f, 1.f, Color::DarkBlue, 1.f, 0.f);
+  gradient(BrushId::GradientOrange, Color::Yellow, 1.f, 1.f, Color::OrangeRed, 1.f, 0.f);
+  gradient(BrushId::GradientRed, Color::Red, 1.f, 1.f, Color::Maroon, 1.f, 0.f);
+  gradient(BrushId::GradientGreen, Color::GreenYellow, 1.f, 1.f, Color::Green, 1.f, 0.f);
+  gradient(BrushId::GradientBackground, Color::LightSlateGray, 1.f, 1.f, Color::Black, 1.f, 0.f);
+}
+
+
+CD2DRenderer::~CD2DRenderer() {
+  for(const auto handle: mBrushes)
+    mD2dDriver->Resources().Unregister(handle);
+}
+
+
+bool CD2DRenderer::BeginDraw() {
+  if(FAILED(mD2dDriver->CreateDeviceResources()))
+    return false;
+
+  mpTarget = mD2dDriver->GetRenderTarget();
+  mD2dDriver->BeginDraw();
+  return true;
+}
+
+
+Rect2F CD2DRenderer::Viewport() const {
+  // In DIPs, like the frame
+  const auto size = mpTarget->GetSize();
+  return Rect2F{0.f, 0.f, size.width, size.height};
+}
+
+
+bool CD2DRenderer::EndDraw() {
+  mpTarget = nullptr;
+  return SUCCEEDED(mD2dDriver->EndDraw());
+}
+
+
+void CD2DRenderer::Clear() {
+  mpTarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
+}
+
+
+void CD2DRenderer::SetTransform(const Transform2F& transform) {
+  mpTarget->SetTransform(transform.to<D2D1_MATRIX_3X2_F>());
+}
+
+
+void CD2DRenderer::FillRect(const Rect2F& rect, const Brush& brush) {
+  mpTarget->FillRectangle(rect.to<D2D1_RECT_F>(), ResolveBrush(brush));
+}
+
+
+void CD2DRenderer::FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush) {
+  mpTarget->FillRoundedRectangle(D2D1::RoundedRect(rect.to<D2D1_RECT_F>(), radius.x, radius.y),
+    ResolveBrush(brush));
+}
+
+
+void CD2DRenderer::FillEllipse(Point2F center, Point2F radius, const Brush& brush) {
+  mpTarget->FillEllipse({center.to<D2D1_POINT_2F>(), radius.x, radius.y}, ResolveBrush(brush));
+}
+
+
+void CD2DRenderer::FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush) {
+  mD2dDriver->RenderTiltedRect(base, distance, degAngle, size, ResolveBrush(brush), mpTarget);
+}
+
+
+void CD2DRenderer::Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text) {
+  wchar_t buf[16];
+  size_t len = 0;
+  for(; len < sizeof(buf) / sizeof(buf[0]) && text[len]; ++len)
+    buf[len] = wchar_t(text[len]);
+
+  if(style == TextStyle::Medium)
+    mD2dDriver->RenderMediumText(rect.to<D2D1_RECT_F>(), buf, len, ResolveBrush(brush), mpTarget);
+  else
+    mD2dDriver->RenderText(rect.to<D2D1_RECT_F>(), buf, len, ResolveBrush(brush), mpTarget);
+}
+
+
+void CD2DRenderer::PushClip(const Rect2F& rect) {
+  mpTarget->PushAxisAlignedClip(rect.to<D2D1_RECT_F>(), D2D1_ANTIALIAS_MODE_ALIASED);
+}
+
+
+void CD2DRenderer::PopClip() {
+  mpTarget->PopAxisAlignedClip();
+}
+
+
+bool CD2DRenderer::DrawCachedLayer(const CRenderList& list, uint32_t offset, const Transform2F& base) {
+  const auto& cmd = list.PayloadAt<CRenderList::BeginLayerCmd>(offset);
+  const auto contentBegin = list.Next(offset);
+  const auto contentEnd = offset + cmd.end;
+
+  const auto* pOwner = reinterpret_cast<const void*>(uintptr_t(cmd.owner));
+  const auto layer = mD2dDriver->LayerCache().Acquire(mpTarget, pOwner, cmd.slot, cmd.size,
+    cmd.contentHash, [&](ID2D1RenderTarget* pLayerTarget) {
+      D2D1_MATRIX_3X2_F layerMatrix;
+      pLayerTarget->GetTransform(&layerMatrix);
+      const auto layerBase = Transform2F{layerMatrix._11, layerMatrix._12, layerMatrix._21, layerMatrix._22,
+        layerMatrix._31, layerMatrix._32};
+
+      auto* pWindowTarget = mpTarget;
+      mpTarget = pLayerTarget;
+      Replay(list, contentBegin, contentEnd, layerBase);
+      mpTarget = pWindowTarget;
+    });
+  if(!layer.pBitmap)
+    return false;
+
+  if(!cmd.hasRegion) {
+    // The bitmap is unrotated, so that turning the layer doesn't render it again
+    const auto layerTransform = Transform2F::Translation(cmd.center - cmd.size / 2.f)
+      * Transform2F::Rotation(cmd.degAngle, cmd.center);
+    SetTransform(layerTransform * base);
+    const auto topLeft = Point2F{} - layer.origin;
+    const auto bottomRight = topLeft + layer.size;
+    mpTarget->DrawBitmap(layer.pBitmap, D2D1::RectF(topLeft.x, topLeft.y, bottomRight.x, bottomRight.y));
+  } else {
+    SetTransform(base);
+    const auto sourceRect = D2D1::RectF(layer.origin.x + cmd.sourceRect.left, layer.origin.y + cmd.sourceRect.top,
+      layer.origin.x + cmd.sourceRect.right, layer.origin.y + cmd.sourceRect.bottom);
+    mpTarget->DrawBitmap(layer.pBitmap, cmd.destRect.to<D2D1_RECT_F>(), 1.f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR,
+      &sourceRect);
+  }
+  return true;
+}
+
+
+ID2D1Brush* CD2DRenderer::ResolveBrush(const Brush& brush) {
+  const auto& resources = mD2dDriver->Resources();
+  auto* pBrush = size_t(brush.id) < sNumBrushes ? resources.Resolve(mBrushes[size_t(brush.id)]) : nullptr;
+  if(!pBrush)
+    return resources.Resolve(mBrushes[size_t(BrushId::Black)]);
+
+  if(brush.IsGradient()) {
+    auto* pGradient = static_cast<ID2D1LinearGradientBrush*>(pBrush);
+    pGradient->SetStartPoint(brush.start.to<D2D1_POINT_2F>());
+    pGradient->SetEndPoint(brush.end.to<D2D1_POINT_2F>());
+  }
+  return pBrush;
+}
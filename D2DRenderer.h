@@ -0,0 +1,43 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "D2DDriver.h"
+#include "Renderer.h"
+
+// Renders frames into the window, with the device resources of a CD2DDriver.
+// Layers are composited from the driver's layer cache.
+class CD2DRenderer: public CRenderer {
+public:
+  explicit CD2DRenderer(CD2DDriver* pD2dDriver);
+  ~CD2DRenderer() override;
+
+protected:
+  bool BeginDraw() override;
+  bool EndDraw() override;
+  void Clear() override;
+  Rect2F Viewport() const override;
+
+  void SetTransform(const Transform2F& transform) override;
+  void FillRect(const Rect2F& rect, const Brush& brush) override;
+  void FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush) override;
+  void FillEllipse(Point2F center, Point2F radius, const Brush& brush) override;
+  void FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush) override;
+  void Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text) override;
+
+  void PushClip(const Rect2F& rect) override;
+  void PopClip() override;
+
+  bool DrawCachedLayer(const CRenderList& list, uint32_t offset, const Transform2F& base) override;
+
+private:
+  ID2D1Brush* ResolveBrush(const Brush& brush);
+
+  static constexpr size_t sNumBrushes = size_t(BrushId::GradientBackground) + 1;
+
+  CD2DDriver* mD2dDriver;
+  // Indexed by BrushId
+  ResourceHandle mBrushes[sNumBrushes];
+  // The window, or a layer bitmap while a layer is rendered
+  ID2D1RenderTarget* mpTarget = nullptr;
+};
@@ -0,0 +1,111 @@
+// Copyright (c) v1ne
+
+#include "D2DResourceRegistry.h"
+
+_COM_SMARTPTR_TYPEDEF(ID2D1GradientStopCollection, __uuidof(ID2D1GradientStopCollection));
+_COM_SMARTPTR_TYPEDEF(ID2D1LinearGradientBrush, __uuidof(ID2D1LinearGradientBrush));
+_COM_SMARTPTR_TYPEDEF(ID2D1SolidColorBrush, __uuidof(ID2D1SolidColorBrush));
+
+ResourceHandle CD2DResourceRegistry::RegisterSolidBrush(const D2D1_COLOR_F& color) {
+  Entry entry;
+  entry.stops[0] = {0.f, color};
+  return Register(entry);
+}
+
+
+ResourceHandle CD2DResourceRegistry::RegisterGradientBrush(const D2D1_COLOR_F& startColor, float startPos,
+    const D2D1_COLOR_F& endColor, float endPos) {
+  Entry entry;
+  entry.isGradient = true;
+  entry.stops[0] = {startPos, startColor};
+  entry.stops[1] = {endPos, endColor};
+  return Register(entry);
+}
+
+
+ResourceHandle CD2DResourceRegistry::Register(const Entry& description) {
+  uint16_t index;
+  if(!mFreeEntries.empty()) {
+    index = mFreeEntries.back();
+    mFreeEntries.pop_back();
+  } else {
+    index = uint16_t(mEntries.size());
+    mEntries.emplace_back();
+  }
+
+  auto& entry = mEntries[index];
+  const auto generation = entry.generation;
+  entry = description;
+  entry.generation = generation;
+  entry.isInUse = true;
+  if(mpTarget)
+    Create(entry);
+
+  return {index, generation};
+}
+
+
+void CD2DResourceRegistry::Unregister(ResourceHandle handle) {
+  if(handle.index >= mEntries.size() || mEntries[handle.index].generation != handle.generation)
+    return;
+
+  auto& entry = mEntries[handle.index];
+  entry.spBrush.Release();
+  entry.isInUse = false;
+  // Skip 0 when wrapping around
+  entry.generation = uint16_t(entry.generation + 1) ? uint16_t(entry.generation + 1) : 1;
+  mFreeEntries.push_back(handle.index);
+}
+
+
+HRESULT CD2DResourceRegistry::Create(Entry& entry) {
+  if(!entry.isGradient) {
+    ID2D1SolidColorBrushPtr spBrush;
+    const auto hr = mpTarget->CreateSolidColorBrush(entry.stops[0].color, &spBrush);
+    entry.spBrush = spBrush.GetInterfacePtr();
+    return hr;
+  }
+
+  ID2D1GradientStopCollectionPtr spStops;
+  auto hr = mpTarget->CreateGradientStopCollection(entry.stops, 2, &spStops);
+  ID2D1LinearGradientBrushPtr spBrush;
+  hr = SUCCEEDED(hr) ? mpTarget->CreateLinearGradientBrush(
+    D2D1::LinearGradientBrushProperties(D2D1::Point2F(0.f, 0.f), D2D1::Point2F(0.f, 0.f)),
+    D2D1::BrushProperties(), spStops, &spBrush) : hr;
+  entry.spBrush = spBrush.GetInterfacePtr();
+  return hr;
+}
+
+
+HRESULT CD2DResourceRegistry::Rebuild(ID2D1RenderTarget* pTarget) {
+  Discard();
+  mpTarget = pTarget;
+  ++mDeviceGeneration;
+
+  auto hr = S_OK;
+  for(auto& entry: mEntries) {
+    if(!entry.isInUse)
+      continue;
+
+    const auto entryHr = Create(entry);
+    if(FAILED(entryHr))
+      hr = entryHr;
+  }
+  return hr;
+}
+
+
+void CD2DResourceRegistry::Discard() {
+  for(auto& entry: mEntries)
+    entry.spBrush.Release();
+  mpTarget = nullptr;
+}
+
+
+ID2D1Brush* CD2DResourceRegistry::Resolve(ResourceHandle handle) const {
+  if(handle.index >= mEntries.size())
+    return nullptr;
+
+  const auto& entry = mEntries[handle.index];
+  return entry.isInUse && entry.generation == handle.generation ? entry.spBrush.GetInterfacePtr() : nullptr;
+}
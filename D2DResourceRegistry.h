@@ -0,0 +1,66 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <d2d1.h>
+#include <d2d1helper.h>
+#include <comdef.h>
+
+#include <cstdint>
+#include <vector>
+
+_COM_SMARTPTR_TYPEDEF(ID2D1Brush, __uuidof(ID2D1Brush));
+
+// Refers to a resource of a CD2DResourceRegistry. A handle stays valid across
+// device losses; it only goes stale when its resource is unregistered.
+struct ResourceHandle {
+  uint16_t index = 0;
+  // 0 is never handed out, so a default handle is always stale
+  uint16_t generation = 0;
+};
+
+// Keeps the device-dependent resources, along with descriptions of how to
+// create them. When the device is lost, everything is released and then
+// created again in one pass from the descriptions, so nobody who holds a
+// handle needs to know.
+//
+// Gradient brushes are shared, so their start and end points need to be set
+// right before they're used.
+class CD2DResourceRegistry {
+public:
+  ResourceHandle RegisterSolidBrush(const D2D1_COLOR_F& color);
+  ResourceHandle RegisterGradientBrush(const D2D1_COLOR_F& startColor, float startPos,
+    const D2D1_COLOR_F& endColor, float endPos);
+  void Unregister(ResourceHandle handle);
+
+  // Creates all resources for pTarget. Resources that are registered later
+  // on are created right away.
+  HRESULT Rebuild(ID2D1RenderTarget* pTarget);
+  void Discard();
+
+  // Returns null if the handle is stale or the resource doesn't exist now
+  ID2D1Brush* Resolve(ResourceHandle handle) const;
+
+  // Incremented by each Rebuild
+  unsigned int DeviceGeneration() const { return mDeviceGeneration; }
+  size_t NumResources() const { return mEntries.size() - mFreeEntries.size(); }
+
+private:
+  struct Entry {
+    uint16_t generation = 1;
+    bool isInUse = false;
+    bool isGradient = false;
+    D2D1_GRADIENT_STOP stops[2];
+    ID2D1BrushPtr spBrush;
+  };
+
+  ResourceHandle Register(const Entry& entry);
+  HRESULT Create(Entry& entry);
+
+  std::vector<Entry> mEntries;
+  std::vector<uint16_t> mFreeEntries;
+
+  // Set between Rebuild and Discard
+  ID2D1RenderTarget* mpTarget = nullptr;
+  unsigned int mDeviceGeneration = 0;
+};
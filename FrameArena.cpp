@@ -0,0 +1,74 @@
+// Copyright (c) v1ne
+
+#include "FrameArena.h"
+
+#include <string.h>
+
+#ifdef _DEBUG
+static constexpr bool sPoisonOnReset = true;
+#else
+static constexpr bool sPoisonOnReset = false;
+#endif
+
+CFrameArena::CFrameArena(size_t initialBytes) {
+  AddBlock(initialBytes);
+}
+
+
+void CFrameArena::AddBlock(size_t minSize) {
+  const auto lastSize = mBlocks.empty() ? 0 : mBlocks.back().size;
+  const auto size = minSize > 2 * lastSize ? minSize : 2 * lastSize;
+  mBlocks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[size]), size});
+  ++mStats.numHeapAllocations;
+}
+
+
+void* CFrameArena::Allocate(size_t size, size_t alignment) {
+  for(;;) {
+    auto& block = mBlocks[mCurrentBlock];
+    const auto address = uintptr_t(block.pData.get()) + mOffset;
+    const auto padding = (alignment - address % alignment) % alignment;
+    if(mOffset + padding + size <= block.size) {
+      mOffset += padding + size;
+      mBytesInFrame += padding + size;
+      return block.pData.get() + mOffset - size;
+    }
+
+    // Continue in the next block, which is made big enough to fit this
+    mBytesInFrame += block.size - mOffset;
+    if(mCurrentBlock + 1 == mBlocks.size())
+      AddBlock(size + alignment);
+    ++mCurrentBlock;
+    mOffset = 0;
+  }
+}
+
+
+void CFrameArena::Reset() {
+  if(mBytesInFrame > mStats.highWaterBytes)
+    mStats.highWaterBytes = mBytesInFrame;
+
+  if(mBlocks.size() > 1) {
+    size_t totalSize = 0;
+    for(const auto& block: mBlocks)
+      totalSize += block.size;
+    mBlocks.clear();
+    AddBlock(totalSize);
+  } else if(sPoisonOnReset)
+    memset(mBlocks[0].pData.get(), 0xDD, mOffset);
+
+  mCurrentBlock = 0;
+  mOffset = 0;
+  mBytesInFrame = 0;
+}
+
+
+CFrameArena::Stats CFrameArena::TakeStats() {
+  auto stats = mStats;
+  stats.capacityBytes = 0;
+  for(const auto& block: mBlocks)
+    stats.capacityBytes += block.size;
+
+  mStats = {};
+  return stats;
+}
@@ -0,0 +1,61 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Hands out memory that lives until the end of the frame, by bumping a
+// pointer. Reset() frees everything at once. Once the arena has grown to fit
+// a frame, the following frames don't touch the heap at all.
+//
+// Debug builds fill the memory with 0xDD on reset, so that anything which
+// holds on to it beyond the frame stands out.
+class CFrameArena {
+public:
+  struct Stats {
+    // The most that was allocated within one frame
+    size_t highWaterBytes = 0;
+    size_t capacityBytes = 0;
+    // How often the arena had to allocate from the heap
+    unsigned int numHeapAllocations = 0;
+  };
+
+  explicit CFrameArena(size_t initialBytes = 16 * 1024);
+  CFrameArena(const CFrameArena&) = delete;
+  CFrameArena& operator=(const CFrameArena&) = delete;
+
+  void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  // Destructors are never run, so only trivial types are allowed
+  template<typename T> T* AllocateArray(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value, "the arena doesn't run destructors");
+    return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  // Frees everything that was allocated. If the frame needed more than one
+  // block, they're replaced by one that fits it all.
+  void Reset();
+
+  // Returns the statistics since the last call
+  Stats TakeStats();
+
+private:
+  struct Block {
+    std::unique_ptr<uint8_t[]> pData;
+    size_t size;
+  };
+
+  void AddBlock(size_t minSize);
+
+  std::vector<Block> mBlocks;
+  size_t mCurrentBlock = 0;
+  size_t mOffset = 0;
+  // Including padding and the unused ends of full blocks
+  size_t mBytesInFrame = 0;
+
+  Stats mStats;
+};
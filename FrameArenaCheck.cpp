@@ -0,0 +1,114 @@
+// Copyright (c) v1ne
+
+#include "FrameArenaCheck.h"
+
+#include "FrameArena.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+const size_t sInitialBytes = 1024;
+const int sNumFrames = 4;
+
+struct Allocation {
+  uint8_t* pData;
+  size_t size;
+};
+
+
+// Allocates sizes and alignments that vary, like the text and transforms of
+// views do, until numBytes have been asked for. Each allocation is filled with
+// its index, so that overlaps show once all of them are checked.
+std::vector<Allocation> AllocateFrame(CFrameArena& arena, size_t numBytes, size_t* pNumMisaligned) {
+  std::vector<Allocation> allocations;
+  size_t numAllocated = 0;
+  for(size_t i = 0; numAllocated < numBytes; ++i) {
+    const auto size = 1 + i * 37 % 300;
+    const auto alignment = size_t(1) << (i % 7);
+    auto* pData = static_cast<uint8_t*>(arena.Allocate(size, alignment));
+    if(uintptr_t(pData) % alignment)
+      ++*pNumMisaligned;
+    memset(pData, int(i & 0xFF), size);
+    allocations.push_back({pData, size});
+    numAllocated += size;
+  }
+  return allocations;
+}
+
+
+size_t CountOverwritten(const std::vector<Allocation>& allocations) {
+  size_t numOverwritten = 0;
+  for(size_t i = 0; i < allocations.size(); ++i) {
+    for(size_t byte = 0; byte < allocations[i].size; ++byte) {
+      if(allocations[i].pData[byte] != uint8_t(i & 0xFF)) {
+        ++numOverwritten;
+        break;
+      }
+    }
+  }
+  return numOverwritten;
+}
+
+}
+
+
+bool CheckFrameArena(std::string* pReport) {
+  auto success = true;
+  char buf[192];
+
+  // Frames of the same size, the first of which doesn't fit
+  {
+    CFrameArena arena(sInitialBytes);
+    arena.TakeStats();
+    for(int frame = 0; frame < sNumFrames; ++frame) {
+      size_t numMisaligned = 0;
+      const auto allocations = AllocateFrame(arena, 20 * sInitialBytes, &numMisaligned);
+      const auto numOverwritten = CountOverwritten(allocations);
+      arena.Reset();
+      const auto stats = arena.TakeStats();
+
+      // Only the first frame may grow the arena, and it's a single block afterwards
+      const auto isGood = !numMisaligned && !numOverwritten && (frame ? !stats.numHeapAllocations
+        : stats.numHeapAllocations > 1 && stats.capacityBytes >= stats.highWaterBytes);
+      snprintf(buf, sizeof(buf), "Frame %d: %u allocations, %u misaligned, %u overwritten, "
+        "%u bytes at most, %u bytes capacity, %u heap allocations\n", frame, unsigned(allocations.size()),
+        unsigned(numMisaligned), unsigned(numOverwritten), unsigned(stats.highWaterBytes),
+        unsigned(stats.capacityBytes), stats.numHeapAllocations);
+      *pReport += buf;
+      success &= isGood;
+    }
+  }
+
+  // A reset hands out the same memory again
+  {
+    CFrameArena arena(sInitialBytes);
+    auto* pFirst = arena.Allocate(100);
+    arena.Allocate(200);
+    arena.Reset();
+    const auto isReused = arena.Allocate(100) == pFirst;
+    *pReport += isReused ? "Reset: the memory is reused\n" : "Reset: the memory ISN'T reused\n";
+    success &= isReused;
+  }
+
+  // An allocation larger than any block so far
+  {
+    CFrameArena arena(sInitialBytes);
+    const auto size = 50 * sInitialBytes;
+    auto* pData = static_cast<uint8_t*>(arena.Allocate(size, 64));
+    memset(pData, 0xAB, size);
+    auto* pNext = static_cast<uint8_t*>(arena.Allocate(16));
+    const auto isApart = pNext + 16 <= pData || pNext >= pData + size;
+    arena.Reset();
+    const auto stats = arena.TakeStats();
+    const auto isGood = uintptr_t(pData) % 64 == 0 && isApart && stats.capacityBytes >= size;
+    snprintf(buf, sizeof(buf), "Large allocation: %u bytes, %s, %u bytes capacity after the reset\n",
+      unsigned(size), isApart ? "apart from the next one" : "OVERLAPS the next one", unsigned(stats.capacityBytes));
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  return success;
+}
@@ -0,0 +1,13 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Drives a CFrameArena through frames like the recording does: allocations
+// have to be aligned and must not overlap, a frame that doesn't fit makes it
+// grow, and after the reset that follows, the same frame fits into a single
+// block without touching the heap. Reset has to hand out the same memory again.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckFrameArena(std::string* pReport);
@@ -0,0 +1,122 @@
+// Copyright (c) v1ne
+
+#include "FrameGovernor.h"
+
+// Each load level sheds more load than the one below it. The last one halves
+// the frame rate, which gives each frame twice the time.
+static constexpr float sDetailScales[] = {1.f, 0.5f, 0.25f, 0.25f};
+static constexpr int sNumLoadLevels = int(sizeof(sDetailScales) / sizeof(sDetailScales[0]));
+static constexpr int sHalfRateLoadLevel = sNumLoadLevels - 1;
+
+// Load is shed quickly, but only restored once frames have been cheap for a
+// while, so that the level of detail doesn't flicker.
+static constexpr int sFramesBeforeShedding = 8;
+static constexpr int sFramesBeforeRestoring = 60;
+// Fractions of the frame interval
+static constexpr double sOverBudget = 0.9;
+static constexpr double sUnderBudget = 0.5;
+
+// Weight of the latest frame in the moving average of the paint time
+static constexpr double sAverageWeight = 0.2;
+
+
+CFrameGovernor::CFrameGovernor(unsigned int targetFramesPerSecond)
+  : mTargetFramesPerSecond(targetFramesPerSecond)
+{}
+
+
+void CFrameGovernor::SetTargetFrameRate(unsigned int framesPerSecond) {
+  mTargetFramesPerSecond = framesPerSecond > 0 ? framesPerSecond : 1;
+  mLoadLevel = 0;
+  mNumFramesOverBudget = 0;
+  mNumFramesUnderBudget = 0;
+}
+
+
+unsigned int CFrameGovernor::FrameRate() const {
+  return mLoadLevel >= sHalfRateLoadLevel ? mTargetFramesPerSecond / 2 : mTargetFramesPerSecond;
+}
+
+
+CFrameGovernor::Clock::duration CFrameGovernor::FrameInterval(int loadLevel) const {
+  const auto framesPerSecond = loadLevel >= sHalfRateLoadLevel ? mTargetFramesPerSecond / 2 : mTargetFramesPerSecond;
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / (framesPerSecond > 0 ? framesPerSecond : 1);
+}
+
+
+bool CFrameGovernor::IsFrameDue(Clock::time_point now, Clock::duration* pWait) {
+  if(!mHasRecordedFrame)
+    return true;
+
+  const auto nextFrameTime = mLastFrameTime + FrameInterval(mLoadLevel);
+  if(now >= nextFrameTime)
+    return true;
+
+  *pWait = nextFrameTime - now;
+  ++mStats.numDeferred;
+  return false;
+}
+
+
+void CFrameGovernor::OnFrameRecorded(Clock::time_point now, Clock::duration recordTime) {
+  const auto isFirstFrame = !mHasRecordedFrame;
+  mHasRecordedFrame = true;
+  mLastFrameTime = now;
+
+  // The frame is replayed later on, so the replay time of the one before
+  // stands in for it
+  const auto paintNanoseconds = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(recordTime).count())
+    + mLastReplayNanoseconds.load(std::memory_order_relaxed);
+  mAveragePaintNanoseconds = isFirstFrame
+    ? double(paintNanoseconds)
+    : mAveragePaintNanoseconds + sAverageWeight * (double(paintNanoseconds) - mAveragePaintNanoseconds);
+
+  ++mStats.numFrames;
+  mSumPaintNanoseconds += paintNanoseconds;
+  if(std::chrono::nanoseconds(paintNanoseconds) > FrameInterval(mLoadLevel))
+    ++mStats.numMissedDeadlines;
+
+  UpdateLoadLevel(std::chrono::nanoseconds(uint64_t(mAveragePaintNanoseconds)));
+}
+
+
+void CFrameGovernor::OnFrameRendered(Clock::duration replayTime) {
+  mLastReplayNanoseconds.store(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(replayTime).count()),
+    std::memory_order_relaxed);
+}
+
+
+void CFrameGovernor::UpdateLoadLevel(Clock::duration paintTime) {
+  const auto isOverBudget = paintTime > FrameInterval(mLoadLevel) * sOverBudget;
+  // Only restore load if the frames would fit into the shorter interval, too
+  const auto isUnderBudget = mLoadLevel > 0 && paintTime < FrameInterval(mLoadLevel - 1) * sUnderBudget;
+
+  mNumFramesOverBudget = isOverBudget ? mNumFramesOverBudget + 1 : 0;
+  mNumFramesUnderBudget = isUnderBudget ? mNumFramesUnderBudget + 1 : 0;
+
+  if(mNumFramesOverBudget >= sFramesBeforeShedding && mLoadLevel < sNumLoadLevels - 1) {
+    ++mLoadLevel;
+    mNumFramesOverBudget = 0;
+  } else if(mNumFramesUnderBudget >= sFramesBeforeRestoring) {
+    --mLoadLevel;
+    mNumFramesUnderBudget = 0;
+  }
+}
+
+
+float CFrameGovernor::DetailScale() const {
+  return sDetailScales[mLoadLevel];
+}
+
+
+CFrameGovernor::Stats CFrameGovernor::TakeStats() {
+  auto stats = mStats;
+  stats.targetFramesPerSecond = mTargetFramesPerSecond;
+  stats.framesPerSecond = FrameRate();
+  stats.detailScale = DetailScale();
+  stats.averagePaintMicroseconds = stats.numFrames ? mSumPaintNanoseconds / stats.numFrames / 1000 : 0;
+
+  mStats = {};
+  mSumPaintNanoseconds = 0;
+  return stats;
+}
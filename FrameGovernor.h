@@ -0,0 +1,77 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Paces frames, so that the frame rate doesn't follow the rate of input
+// messages. Input is still handled, and MIDI is still sent, for every message,
+// but a frame is only recorded once per frame interval.
+//
+// It also tracks what a frame costs to paint, i.e. the time to record it and
+// the time to replay it. If that exceeds the frame interval, views are
+// painted with less detail, and as a last resort, the frame rate is halved.
+//
+// Everything but OnFrameRendered is called on the input thread.
+class CFrameGovernor {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    unsigned int targetFramesPerSecond = 0;
+    // May be lower than the target while frames are too expensive
+    unsigned int framesPerSecond = 0;
+    float detailScale = 1.f;
+    unsigned int numFrames = 0;
+    // Frames that took longer to paint than the frame interval
+    unsigned int numMissedDeadlines = 0;
+    // Requests for a frame that came in before the interval was over
+    unsigned int numDeferred = 0;
+    uint64_t averagePaintMicroseconds = 0;
+  };
+
+  explicit CFrameGovernor(unsigned int targetFramesPerSecond = 60);
+
+  void SetTargetFrameRate(unsigned int framesPerSecond);
+  unsigned int TargetFrameRate() const { return mTargetFramesPerSecond; }
+  // The rate that frames are recorded at right now
+  unsigned int FrameRate() const;
+
+  // Returns whether a frame may be recorded now. If not, pWait receives the
+  // time until it may.
+  bool IsFrameDue(Clock::time_point now, Clock::duration* pWait);
+  // A frame was recorded at `now`, which took recordTime
+  void OnFrameRecorded(Clock::time_point now, Clock::duration recordTime);
+  // Render thread. A frame was replayed, which took replayTime, not
+  // counting the wait for the display.
+  void OnFrameRendered(Clock::duration replayTime);
+
+  // How large views count as on screen when they choose their level of
+  // detail. Below 1 while frames are too expensive.
+  float DetailScale() const;
+
+  // Returns the stats since the last call
+  Stats TakeStats();
+
+private:
+  Clock::duration FrameInterval(int loadLevel) const;
+  void UpdateLoadLevel(Clock::duration paintTime);
+
+  unsigned int mTargetFramesPerSecond;
+  // 0 while frames are within budget. Each level above sheds more load.
+  int mLoadLevel = 0;
+  // Consecutive frames that suggest a change of the load level
+  int mNumFramesOverBudget = 0;
+  int mNumFramesUnderBudget = 0;
+
+  bool mHasRecordedFrame = false;
+  Clock::time_point mLastFrameTime;
+  // Moving average, in nanoseconds
+  double mAveragePaintNanoseconds = 0.;
+  std::atomic<uint64_t> mLastReplayNanoseconds{0};
+
+  Stats mStats;
+  uint64_t mSumPaintNanoseconds = 0;
+};
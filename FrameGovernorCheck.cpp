@@ -0,0 +1,142 @@
+// Copyright (c) v1ne
+
+#include "FrameGovernorCheck.h"
+
+#include "FrameGovernor.h"
+
+#include <stdio.h>
+
+namespace {
+
+using Clock = CFrameGovernor::Clock;
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+const unsigned int sTargetFramesPerSecond = 60;
+// Within the frame interval at 60 fps, above it, and in between
+const auto sCheapPaintTime = Milliseconds(3.);
+const auto sExpensivePaintTime = Milliseconds(30.);
+const auto sModeratePaintTime = Milliseconds(12.);
+// Restoring takes 60 frames per load level, with some to spare
+const int sMaxFramesPerPhase = 400;
+
+// A simulated clock and render thread
+struct Simulation {
+  CFrameGovernor governor{sTargetFramesPerSecond};
+  Clock::time_point now;
+
+  // Records a frame as soon as it's due. Half of the paint time is spent on
+  // recording, the other half on replaying it, which the governor only learns
+  // of with the next frame.
+  void Frame(Milliseconds paintTime) {
+    Clock::duration wait;
+    if(!governor.IsFrameDue(now, &wait))
+      now += wait;
+    const auto halfTime = std::chrono::duration_cast<Clock::duration>(paintTime / 2.);
+    governor.OnFrameRecorded(now, halfTime);
+    governor.OnFrameRendered(halfTime);
+    now += halfTime;
+  }
+};
+
+
+struct Level {
+  float detailScale;
+  unsigned int framesPerSecond;
+
+  bool operator==(const Level& other) const {
+    return detailScale == other.detailScale && framesPerSecond == other.framesPerSecond;
+  }
+  bool operator!=(const Level& other) const { return !(*this == other); }
+};
+
+
+Level LevelOf(const CFrameGovernor& governor) {
+  return {governor.DetailScale(), governor.FrameRate()};
+}
+
+
+// Runs frames until the governor reaches `last`. pNumFrames receives the
+// number of frames after which each change happened, and pReport the levels.
+// Returns false if another level than `expected` came next.
+bool RunUntil(Simulation& simulation, Milliseconds paintTime, const Level* pExpected, size_t numExpected,
+    int* pNumFrames, std::string* pReport) {
+  size_t next = 0;
+  auto level = LevelOf(simulation.governor);
+  for(int frame = 1; frame <= sMaxFramesPerPhase && next < numExpected; ++frame) {
+    simulation.Frame(paintTime);
+    const auto newLevel = LevelOf(simulation.governor);
+    if(newLevel == level)
+      continue;
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "  after %d frames: %d%% detail, %u fps\n", frame, int(newLevel.detailScale * 100),
+      newLevel.framesPerSecond);
+    *pReport += buf;
+    if(newLevel != pExpected[next])
+      return false;
+    pNumFrames[next++] = frame;
+    level = newLevel;
+  }
+  return next == numExpected;
+}
+
+}
+
+
+bool CheckFrameGovernor(std::string* pReport) {
+  auto success = true;
+  Simulation simulation;
+  const auto full = Level{1.f, sTargetFramesPerSecond};
+
+  // Cheap frames keep everything, and requests within the interval are deferred
+  {
+    auto isDeferred = true;
+    for(int frame = 0; frame < 100; ++frame) {
+      simulation.Frame(sCheapPaintTime);
+      Clock::duration wait;
+      isDeferred &= !simulation.governor.IsFrameDue(simulation.now, &wait);
+    }
+    const auto stats = simulation.governor.TakeStats();
+    const auto isGood = LevelOf(simulation.governor) == full && isDeferred && !stats.numMissedDeadlines;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Cheap frames: %d%% detail, %u fps, %u missed deadlines, %u deferred\n",
+      int(stats.detailScale * 100), stats.framesPerSecond, stats.numMissedDeadlines, stats.numDeferred);
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  // Moderate frames are within budget, so nothing changes
+  {
+    *pReport += "Moderate frames:\n";
+    int numFrames;
+    const auto isChanged = RunUntil(simulation, sModeratePaintTime, &full, 1, &numFrames, pReport);
+    const auto isGood = !isChanged && LevelOf(simulation.governor) == full;
+    *pReport += isGood ? "  no change\n" : "  CHANGED\n";
+    success &= isGood;
+  }
+
+  // Expensive frames shed load, one level at a time
+  {
+    *pReport += "Expensive frames:\n";
+    const Level levels[] = {{0.5f, 60}, {0.25f, 60}, {0.25f, 30}};
+    int numFrames[3];
+    const auto isGood = RunUntil(simulation, sExpensivePaintTime, levels, 3, numFrames, pReport);
+    if(!isGood)
+      *pReport += "  DIDN'T shed load as expected\n";
+    success &= isGood;
+  }
+
+  // Cheap frames restore it, but only once they've been cheap for a while
+  {
+    *pReport += "Cheap frames again:\n";
+    const Level levels[] = {{0.25f, 60}, {0.5f, 60}, full};
+    int numFrames[3];
+    auto isGood = RunUntil(simulation, sCheapPaintTime, levels, 3, numFrames, pReport);
+    isGood = isGood && numFrames[0] >= 60 && numFrames[1] - numFrames[0] >= 60 && numFrames[2] - numFrames[1] >= 60;
+    if(!isGood)
+      *pReport += "  DIDN'T restore load as expected\n";
+    success &= isGood;
+  }
+
+  return success;
+}
@@ -0,0 +1,14 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Feeds a CFrameGovernor with paint times on a simulated clock. Cheap frames
+// have to keep full detail and the target rate, expensive ones have to shed
+// load step by step down to half the rate, and once frames are cheap again,
+// the load has to be restored step by step, but not right away. Requests
+// within the frame interval have to be deferred.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckFrameGovernor(std::string* pReport);
@@ -12,3 +12,85 @@ Point2F rotateRad(const Point2F p, const float radAngle) {
       p.x * fCos + p.y * fSin,
     - p.x * fSin + p.y * fCos};
 }
+
+
+Transform2F Transform2F::Scale(Point2F factors, Point2F center) {
+  return {factors.x, 0.f, 0.f, factors.y,
+    center.x - factors.x * center.x, center.y - factors.y * center.y};
+}
+
+
+Transform2F Transform2F::Rotation(float degAngle, Point2F center) {
+  const auto radAngle = degAngle * (3.14159265f / 180.f);
+  const auto fSin = float(sin(radAngle));
+  const auto fCos = float(cos(radAngle));
+
+  return {fCos, fSin, -fSin, fCos,
+    center.x - center.x * fCos + center.y * fSin,
+    center.y - center.x * fSin - center.y * fCos};
+}
+
+
+Rect2F Rect2F::BoundsOf(const Point2F* points, size_t numPoints) {
+  if(!numPoints)
+    return Empty();
+
+  auto bounds = Rect2F{points[0].x, points[0].y, points[0].x, points[0].y};
+  for(size_t i = 1; i < numPoints; ++i) {
+    bounds.left = fminf(bounds.left, points[i].x);
+    bounds.top = fminf(bounds.top, points[i].y);
+    bounds.right = fmaxf(bounds.right, points[i].x);
+    bounds.bottom = fmaxf(bounds.bottom, points[i].y);
+  }
+  return bounds;
+}
+
+
+Rect2F Transform2F::Apply(const Rect2F& rect) const {
+  const Point2F corners[4] = {
+    Apply(Point2F{rect.left, rect.top}), Apply(Point2F{rect.right, rect.top}),
+    Apply(Point2F{rect.right, rect.bottom}), Apply(Point2F{rect.left, rect.bottom})};
+  return Rect2F::BoundsOf(corners, 4);
+}
+
+
+Rect2F Transform2F::ApplyInner(const Rect2F& rect) const {
+  if(m12 == 0.f && m21 == 0.f)
+    return Apply(rect);
+
+  if(m11 != m22 || m12 != -m21)
+    return Rect2F::Empty();
+
+  // Rotated and uniformly scaled: The circle within the rect stays within it,
+  // and so does the square within the circle
+  const auto scale = ::sqrtf(m11 * m11 + m12 * m12);
+  const auto size = rect.Size();
+  const auto halfSide = (size.x < size.y ? size.x : size.y) / 2.f * scale * 0.70710678f;
+  const auto center = Apply((rect.TopLeft() + rect.BottomRight()) / 2.f);
+  return Rect2F::FromPoints(center - Point2F{halfSide}, center + Point2F{halfSide});
+}
+
+
+bool Transform2F::Invert(Transform2F* pInverse) const {
+  const auto determinant = m11 * m22 - m12 * m21;
+  if(determinant == 0.f)
+    return false;
+
+  const auto inverseDeterminant = 1.f / determinant;
+  *pInverse = {
+    m22 * inverseDeterminant, -m12 * inverseDeterminant,
+    -m21 * inverseDeterminant, m11 * inverseDeterminant,
+    (m21 * dy - m22 * dx) * inverseDeterminant, (m12 * dx - m11 * dy) * inverseDeterminant};
+  return true;
+}
+
+
+void TiltedRectCorners(Point2F base, float distance, float degAngle, Point2F size, Point2F corners[4]) {
+  const auto middleOfRectNearBase = base + rotateDeg(Vec2Right(distance), degAngle);
+  const auto halfRectHeightR = rotateDeg(Vec2Up(size.y/2), degAngle);
+  const auto rectLengthR = rotateDeg(Vec2Right(size.x), degAngle);
+  corners[0] = middleOfRectNearBase + halfRectHeightR;
+  corners[1] = middleOfRectNearBase - halfRectHeightR;
+  corners[2] = corners[1] + rectLengthR;
+  corners[3] = corners[0] + rectLengthR;
+}
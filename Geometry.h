@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <math.h>
+#include <stddef.h>
+
 template<typename T>
 struct Point2 {
 // data members:
@@ -88,3 +91,108 @@ template<typename T>
 static Point2<T> Vec2Right(T length) { return {length, 0.f}; }
 template<typename T>
 static Point2<T> Vec2Left(T length) { return {-length, 0.f}; }
+
+
+struct Rect2F {
+// data members:
+  float left;
+  float top;
+  float right;
+  float bottom;
+// end data members
+
+  static Rect2F Empty() { return {1.f, 1.f, 0.f, 0.f}; }
+  static Rect2F FromPoints(Point2F topLeft, Point2F bottomRight) {
+    return {topLeft.x, topLeft.y, bottomRight.x, bottomRight.y};
+  }
+  // Axis-aligned bounds of the points
+  static Rect2F BoundsOf(const Point2F* points, size_t numPoints);
+
+  bool IsEmpty() const { return left >= right || top >= bottom; }
+  Point2F TopLeft() const { return {left, top}; }
+  Point2F BottomRight() const { return {right, bottom}; }
+  Point2F Size() const { return {right - left, bottom - top}; }
+  float Area() const { return IsEmpty() ? 0.f : (right - left) * (bottom - top); }
+
+  bool Contains(Point2F p) const {
+    return p.x >= left && p.x < right && p.y >= top && p.y < bottom;
+  }
+
+  bool Contains(const Rect2F& other) const {
+    return other.left >= left && other.right <= right && other.top >= top && other.bottom <= bottom;
+  }
+
+  bool Intersects(const Rect2F& other) const {
+    return !IsEmpty() && !other.IsEmpty()
+      && other.left < right && other.right > left && other.top < bottom && other.bottom > top;
+  }
+
+  Rect2F Inflated(float amount) const {
+    return {left - amount, top - amount, right + amount, bottom + amount};
+  }
+
+  friend Rect2F Union(const Rect2F& a, const Rect2F& b) {
+    if(a.IsEmpty()) return b;
+    if(b.IsEmpty()) return a;
+    return {a.left < b.left ? a.left : b.left, a.top < b.top ? a.top : b.top,
+      a.right > b.right ? a.right : b.right, a.bottom > b.bottom ? a.bottom : b.bottom};
+  }
+
+  friend Rect2F Intersection(const Rect2F& a, const Rect2F& b) {
+    return {a.left > b.left ? a.left : b.left, a.top > b.top ? a.top : b.top,
+      a.right < b.right ? a.right : b.right, a.bottom < b.bottom ? a.bottom : b.bottom};
+  }
+
+  template<typename U> U to() const { return {left, top, right, bottom}; }
+};
+
+
+// Affine transform for row vectors, laid out like D2D1_MATRIX_3X2_F.
+// a * b applies a first, then b.
+struct Transform2F {
+// data members:
+  float m11, m12;
+  float m21, m22;
+  float dx, dy;
+// end data members
+
+  static Transform2F Identity() { return {1.f, 0.f, 0.f, 1.f, 0.f, 0.f}; }
+  static Transform2F Translation(Point2F offset) { return {1.f, 0.f, 0.f, 1.f, offset.x, offset.y}; }
+  static Transform2F Scale(Point2F factors, Point2F center = {});
+  // Clockwise on screen, like D2D1::Matrix3x2F::Rotation
+  static Transform2F Rotation(float degAngle, Point2F center = {});
+
+  bool IsIdentity() const {
+    return m11 == 1.f && m12 == 0.f && m21 == 0.f && m22 == 1.f && dx == 0.f && dy == 0.f;
+  }
+
+  // How much lengths grow on average, i.e. the square root of the area scale
+  float ScaleFactor() const { return sqrtf(fabsf(m11 * m22 - m12 * m21)); }
+
+  Point2F Apply(Point2F p) const {
+    return {p.x * m11 + p.y * m21 + dx, p.x * m12 + p.y * m22 + dy};
+  }
+
+  // Axis-aligned bounds of the transformed rect
+  Rect2F Apply(const Rect2F& rect) const;
+  // An axis-aligned rect that lies within the transformed rect. It's exact
+  // for axis-aligned transforms, conservative for rotations and empty for
+  // anything else.
+  Rect2F ApplyInner(const Rect2F& rect) const;
+
+  bool Invert(Transform2F* pInverse) const;
+
+  friend Transform2F operator*(const Transform2F& a, const Transform2F& b) {
+    return {
+      a.m11 * b.m11 + a.m12 * b.m21, a.m11 * b.m12 + a.m12 * b.m22,
+      a.m21 * b.m11 + a.m22 * b.m21, a.m21 * b.m12 + a.m22 * b.m22,
+      a.dx * b.m11 + a.dy * b.m21 + b.dx, a.dx * b.m12 + a.dy * b.m22 + b.dy};
+  }
+
+  template<typename U> U to() const { return {m11, m12, m21, m22, dx, dy}; }
+};
+
+
+// Corners of a rect of the given size, tilted by degAngle around base and
+// starting `distance` away from it. Its height is centered on the tilted axis.
+void TiltedRectCorners(Point2F base, float distance, float degAngle, Point2F size, Point2F corners[4]);
@@ -0,0 +1,186 @@
+// Copyright (c) v1ne
+
+#include "GoldenImageCheck.h"
+
+#include "CpuRenderer.h"
+#include "HeadlessScene.h"
+#include "TiledCpuRenderer.h"
+#include "WorkStealingPool.h"
+
+#include <fstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+
+struct GoldenImage {
+  const char* pName;
+  // The client area, in pixels
+  Point2F size;
+  float canvasScale;
+  // Like CFrameGovernor::DetailScale
+  float detailScale;
+  int frame;
+};
+
+// Sliders and knobs are 50 points wide, so 0.625 paints them at full detail,
+// 0.375 at reduced detail and, at half the detail, flat
+const GoldenImage sGoldenImages[] = {
+  {"layout", {400.f, 380.f}, 0.625f, 1.f, 0},
+  {"layout-animated", {400.f, 380.f}, 0.625f, 1.f, 5},
+  {"layout-reduced", {240.f, 228.f}, 0.375f, 1.f, 0},
+  {"layout-flat", {240.f, 228.f}, 0.375f, 0.5f, 0},
+};
+
+// Another compiler may round a sample differently, which moves an edge by a
+// sub-scanline. That changes a few pixels a lot, but most not at all.
+const int sChannelTolerance = 2;
+const size_t sPixelsPerAllowedMismatch = 1000;
+
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> rgb;
+};
+
+
+// The frames are opaque, so the premultiplied BGRA pixels are the colors
+Image ToImage(const uint32_t* pPixels, int width, int height) {
+  Image image;
+  image.width = width;
+  image.height = height;
+  image.rgb.resize(size_t(width) * height * 3);
+  for(size_t i = 0; i < size_t(width) * height; ++i) {
+    image.rgb[i * 3] = uint8_t(pPixels[i] >> 16);
+    image.rgb[i * 3 + 1] = uint8_t(pPixels[i] >> 8);
+    image.rgb[i * 3 + 2] = uint8_t(pPixels[i]);
+  }
+  return image;
+}
+
+
+bool ReadPpm(const std::string& path, Image* pImage) {
+  std::ifstream file(path, std::ios::binary);
+  std::string magic;
+  int maxValue = 0;
+  if(!(file >> magic >> pImage->width >> pImage->height >> maxValue) || magic != "P6" || maxValue != 255
+      || pImage->width <= 0 || pImage->height <= 0)
+    return false;
+
+  // A single whitespace separates the header from the pixels
+  file.get();
+  pImage->rgb.resize(size_t(pImage->width) * pImage->height * 3);
+  return bool(file.read(reinterpret_cast<char*>(pImage->rgb.data()), std::streamsize(pImage->rgb.size())));
+}
+
+
+bool WritePpm(const std::string& path, const Image& image) {
+  std::ofstream file(path, std::ios::binary);
+  file << "P6\n" << image.width << " " << image.height << "\n255\n";
+  file.write(reinterpret_cast<const char*>(image.rgb.data()), std::streamsize(image.rgb.size()));
+  return bool(file);
+}
+
+
+// Returns the number of pixels that differ by more than sChannelTolerance
+size_t CountMismatches(const Image& golden, const Image& image, int* pFirstX, int* pFirstY) {
+  size_t numMismatches = 0;
+  for(size_t i = 0; i < size_t(image.width) * image.height; ++i) {
+    auto isMismatch = false;
+    for(size_t channel = 0; channel < 3; ++channel)
+      isMismatch |= abs(int(golden.rgb[i * 3 + channel]) - int(image.rgb[i * 3 + channel])) > sChannelTolerance;
+    if(!isMismatch)
+      continue;
+    if(!numMismatches) {
+      *pFirstX = int(i % image.width);
+      *pFirstY = int(i / image.width);
+    }
+    ++numMismatches;
+  }
+  return numMismatches;
+}
+
+
+bool Compare(const Image* pGolden, const Image& image, const char* pName, const char* pHow, std::string* pReport) {
+  char buf[192];
+  if(!pGolden) {
+    snprintf(buf, sizeof(buf), "%s (%s): no golden image, run with --update-golden\n", pName, pHow);
+    *pReport += buf;
+    return false;
+  }
+  if(pGolden->width != image.width || pGolden->height != image.height) {
+    snprintf(buf, sizeof(buf), "%s (%s): the golden image is %dx%d, not %dx%d\n", pName, pHow,
+      pGolden->width, pGolden->height, image.width, image.height);
+    *pReport += buf;
+    return false;
+  }
+
+  int firstX = 0, firstY = 0;
+  const auto numMismatches = CountMismatches(*pGolden, image, &firstX, &firstY);
+  const auto numAllowed = size_t(image.width) * image.height / sPixelsPerAllowedMismatch;
+  if(!numMismatches)
+    snprintf(buf, sizeof(buf), "%s (%s): matches\n", pName, pHow);
+  else
+    snprintf(buf, sizeof(buf), "%s (%s): %u pixels differ, %u are allowed, first at (%d,%d)\n", pName, pHow,
+      unsigned(numMismatches), unsigned(numAllowed), firstX, firstY);
+  *pReport += buf;
+  return numMismatches <= numAllowed;
+}
+
+}
+
+
+bool CheckGoldenImages(const SelfCheckOptions& options, std::string* pReport) {
+  CWorkStealingPool pool(4);
+  auto isEqual = true;
+
+  for(const auto& golden: sGoldenImages) {
+    const auto width = int(golden.size.x);
+    const auto height = int(golden.size.y);
+    CHeadlessScene scene(BuiltInLayout(), golden.size);
+    scene.SetCanvasTransform(Transform2F::Scale(Point2F{golden.canvasScale}));
+
+    // The frame on its own
+    CRenderList lists[2];
+    lists[0].SetDetailScale(golden.detailScale);
+    lists[1].SetDetailScale(golden.detailScale);
+    scene.Animate(golden.frame);
+    scene.Record(lists[0]);
+    CCpuRenderer full(width, height);
+    full.Render(lists[0], nullptr);
+    const auto fullImage = ToImage(full.Pixels(), width, height);
+
+    const auto path = std::string(options.pGoldenDir) + "/" + golden.pName + ".ppm";
+    Image goldenImage;
+    if(options.updateGoldenImages) {
+      if(!WritePpm(path, fullImage)) {
+        *pReport += path + ": can't be written\n";
+        isEqual = false;
+        continue;
+      }
+      *pReport += path + ": updated\n";
+    }
+    const auto hasGolden = ReadPpm(path, &goldenImage);
+    isEqual &= Compare(hasGolden ? &goldenImage : nullptr, fullImage, golden.pName, "full", pReport);
+
+    if(!golden.frame)
+      continue;
+
+    // The same frame, after the frames before it on the tiled renderer
+    CTiledCpuRenderer tiled(width, height, pool);
+    for(int frame = 0; frame <= golden.frame; ++frame) {
+      auto& list = lists[frame % 2];
+      const auto& previous = lists[(frame + 1) % 2];
+      scene.Animate(frame);
+      scene.Record(list);
+      Rect2F dirty;
+      const auto isPartial = frame && list.Diff(previous, &dirty);
+      tiled.Render(list, isPartial ? &dirty : nullptr);
+    }
+    const auto partialImage = ToImage(tiled.Pixels(), width, height);
+    isEqual &= Compare(hasGolden ? &goldenImage : nullptr, partialImage, golden.pName, "partial, tiled", pReport);
+  }
+  return isEqual;
+}
@@ -0,0 +1,15 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "SelfCheck.h"
+
+#include <string>
+
+// Renders the built-in layout with the CPU renderers and compares the pixels
+// against the golden images in options.pGoldenDir, which are binary PPMs.
+// Covers the canvas zoomed in and out, shed load, and a frame that was
+// reached through partial frames on the tiled renderer.
+//
+// Returns whether all images matched. pReport receives a line per image.
+bool CheckGoldenImages(const SelfCheckOptions& options, std::string* pReport);
@@ -0,0 +1,74 @@
+// Copyright (c) v1ne
+
+// Runs the self-checks and benchmarks of SelfCheck.h without Windows.
+//
+// Usage:
+//   headless [--golden-dir <dir>] [--update-golden] [<check>...]
+//     Runs the checks, or all of them that aren't benchmarks. Golden images
+//     are in Golden/ next to this file by default.
+//   headless --benchmarks
+//     Runs all benchmarks
+//   headless --list
+//     Lists the checks and benchmarks
+//
+// Returns 0 if all checks passed.
+
+#include "../SelfCheck.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static int List() {
+  for(size_t i = 0; i < gNumSelfChecks; ++i)
+    printf("%-24s %s%s\n", gSelfChecks[i].pName, gSelfChecks[i].pDescription,
+      gSelfChecks[i].isBenchmark ? " (benchmark)" : "");
+  return 0;
+}
+
+
+int main(int argc, char** argv) {
+  SelfCheckOptions options;
+  options.pGoldenDir = "Golden";
+  std::vector<const SelfCheck*> checks;
+  auto runBenchmarks = false;
+
+  for(int i = 1; i < argc; ++i) {
+    if(!strcmp(argv[i], "--list"))
+      return List();
+    if(!strcmp(argv[i], "--golden-dir") && i + 1 < argc)
+      options.pGoldenDir = argv[++i];
+    else if(!strcmp(argv[i], "--update-golden"))
+      options.updateGoldenImages = true;
+    else if(!strcmp(argv[i], "--benchmarks"))
+      runBenchmarks = true;
+    else if(const auto* pCheck = FindSelfCheck(argv[i]))
+      checks.push_back(pCheck);
+    else {
+      fprintf(stderr, "There's no check named %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  if(checks.empty()) {
+    for(size_t i = 0; i < gNumSelfChecks; ++i)
+      if(gSelfChecks[i].isBenchmark == runBenchmarks)
+        checks.push_back(&gSelfChecks[i]);
+  }
+
+  auto numFailed = 0;
+  for(const auto* pCheck: checks) {
+    printf("== %s\n", pCheck->pName);
+    fflush(stdout);
+    std::string report;
+    const auto success = pCheck->pRun(options, &report);
+    printf("%s%s\n", report.c_str(), success ? "Passed" : "FAILED");
+    fflush(stdout);
+    numFailed += !success;
+  }
+
+  if(numFailed)
+    printf("%d of %u failed\n", numFailed, unsigned(checks.size()));
+  return numFailed ? 1 : 0;
+}
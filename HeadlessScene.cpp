@@ -0,0 +1,133 @@
+// Copyright (c) v1ne
+
+#include "HeadlessScene.h"
+
+#include <algorithm>
+
+// Like NUM_CORE_OBJECTS of CComTouchDriver
+static constexpr int sNumSquares = 2;
+static constexpr auto sSquareSize = 200.f;
+
+// Controls change every this many frames
+static constexpr int sNumAnimationPhases = 4;
+
+
+// Like CSlider::BrushForMode
+static BrushId ValueBrush(const LayoutControl& control) {
+  switch(control.controller % 3) {
+  case 0: return BrushId::SomePinkishBlue;
+  case 1: return BrushId::Cornflower;
+  }
+  return BrushId::SomeGreenish;
+}
+
+
+// Some value that changes a bit with each change
+static float ControlValue(size_t control, int numChanges) {
+  return float((control * 37 + 11 + size_t(numChanges) * 13) % 101) / 100.f;
+}
+
+
+CHeadlessScene::CHeadlessScene(const std::vector<LayoutControl>& controls, Point2F clientArea)
+  : mClientArea(clientArea)
+{
+  // Like CComTouchDriver::RenderInitialState, with the colors of the squares it creates
+  const BrushId squareBrushes[][2] = {
+    {BrushId::GradientBlue, BrushId::Cornflower}, {BrushId::GradientOrange, BrushId::SomeOrangish}};
+  for(int i = 0; i < sNumSquares; ++i) {
+    View view = {};
+    view.isSquare = true;
+    view.square.size = Point2F{sSquareSize};
+    view.square.pos = clientArea - Point2F{sSquareSize, sSquareSize * (i + 1)};
+    view.square.gradientBrush = squareBrushes[i][0];
+    view.square.flatBrush = squareBrushes[i][1];
+    mViews.push_back(view);
+  }
+
+  for(const auto& control: controls) {
+    if(control.bank != 0)
+      break;
+    View view = {};
+    view.slider.pos = control.rect.TopLeft();
+    view.slider.size = control.rect.Size();
+    view.slider.isKnob = control.type == CControlModel::ControlType::Knob;
+    view.slider.valueBrush = ValueBrush(control);
+    mViews.push_back(view);
+  }
+
+  SetCanvasTransform(Transform2F::Identity());
+  Animate(0);
+}
+
+
+void CHeadlessScene::SetCanvasTransform(const Transform2F& canvasTransform) {
+  Transform2F inverse;
+  if(!canvasTransform.Invert(&inverse))
+    return;
+  mCanvasTransform = canvasTransform;
+  mVisibleCanvasArea = inverse.Apply(Rect2F::FromPoints({}, mClientArea));
+}
+
+
+void CHeadlessScene::Animate(int frame) {
+  size_t square = 0;
+  size_t control = 0;
+  for(auto& view: mViews) {
+    if(view.isSquare) {
+      view.square.degAngle = float(frame * (square++ % 2 ? -2 : 3));
+      continue;
+    }
+
+    // The control changes in frames phase, phase + sNumAnimationPhases, ...
+    const auto phase = int(control % sNumAnimationPhases) + 1;
+    const auto numChanges = frame >= phase ? (frame - phase) / sNumAnimationPhases + 1 : 0;
+    view.slider.value = ControlValue(control, numChanges);
+    ++control;
+  }
+}
+
+
+void CHeadlessScene::BringSquaresToFront() {
+  std::stable_partition(mViews.begin(), mViews.end(), [](const View& view) { return !view.isSquare; });
+}
+
+
+void CHeadlessScene::Record(CRenderList& list) {
+  list.Reset();
+  RecordBackground(list);
+  RecordViews(list, 0, mViews.size());
+}
+
+
+void CHeadlessScene::RecordBackground(CRenderList& list) {
+  list.BeginView(nullptr);
+  list.FillRect(Rect2F::FromPoints({}, mClientArea), Brush(BrushId::GradientBackground,
+    {mClientArea.x/2, 0.f}, {mClientArea.x/2, mClientArea.y}));
+  list.EndView();
+}
+
+
+void CHeadlessScene::RecordViews(CRenderList& list, size_t begin, size_t end) {
+  for(auto i = begin; i < end; ++i) {
+    const auto& view = mViews[i];
+    if(!Bounds(view).Intersects(mVisibleCanvasArea))
+      continue;
+
+    list.BeginView(&view, mCanvasTransform);
+    if(view.isSquare)
+      PaintSquareLook(list, view.square, DetailOnScreen(list, view.square.size));
+    else
+      PaintSliderLook(list, &view, view.slider, DetailOnScreen(list, view.slider.size));
+    list.EndView();
+  }
+}
+
+
+// Like CTransformableDrawingObject::Bounds
+Rect2F CHeadlessScene::Bounds(const View& view) const {
+  const auto& pos = view.isSquare ? view.square.pos : view.slider.pos;
+  const auto& size = view.isSquare ? view.square.size : view.slider.size;
+  const auto center = pos + size / 2.f;
+  const auto radius = Point2F{size.mag() / 2.f};
+  return Rect2F::FromPoints(center - radius, center + radius);
+}
@@ -0,0 +1,56 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "Geometry.h"
+#include "LayoutFormat.h"
+#include "RenderList.h"
+#include "ViewPainter.h"
+
+#include <vector>
+
+// What the app shows of the first bank of a layout while nothing is touched:
+// the background, the squares in the bottom-right corner and the controls on
+// top, painted with the same looks as the views. Records the same frames as
+// CComTouchDriver, but without windows, so that the paint path can be
+// rendered, checked and timed headless.
+class CHeadlessScene {
+public:
+  // The client area is in logical points. Headless, they're pixels.
+  CHeadlessScene(const std::vector<LayoutControl>& controls, Point2F clientArea);
+
+  // Zooms and pans the canvas, like CComTouchDriver::SetCanvasTransform
+  void SetCanvasTransform(const Transform2F& canvasTransform);
+  // Sets the values and angles of a frame. Frame 0 is the layout as it is
+  // laid out, and each frame after it changes every fourth control and turns
+  // the squares, so that it can be rendered as a partial frame.
+  void Animate(int frame);
+  // Paints the squares above the controls, like the app does once they're touched
+  void BringSquaresToFront();
+
+  // The squares and the controls of the bank
+  size_t NumViews() const { return mViews.size(); }
+
+  // Records a whole frame, like CComTouchDriver::RecordFrame. Views that are
+  // off the canvas aren't recorded.
+  void Record(CRenderList& list);
+  // Records the background, which is a span of its own
+  void RecordBackground(CRenderList& list);
+  // Records the views [begin, end) in paint order, each as a span of its own,
+  // like CComTouchDriver::RecordChunk
+  void RecordViews(CRenderList& list, size_t begin, size_t end);
+
+private:
+  struct View {
+    bool isSquare;
+    SliderLook slider;
+    SquareLook square;
+  };
+
+  Rect2F Bounds(const View& view) const;
+
+  std::vector<View> mViews;
+  Point2F mClientArea;
+  Transform2F mCanvasTransform = Transform2F::Identity();
+  Rect2F mVisibleCanvasArea;
+};
@@ -0,0 +1,112 @@
+// Copyright (c) v1ne
+
+#include "LayerCache.h"
+
+#include <math.h>
+
+CLayerCache::CLayerCache(size_t budgetBytes)
+  : mBudgetBytes(budgetBytes)
+{ }
+
+
+CLayerCache::Layer CLayerCache::Acquire(ID2D1RenderTarget* pTarget, const void* pOwner, unsigned int slot,
+    Point2F size, uint64_t contentHash, const PaintFn& paint) {
+  const auto key = Key{pOwner, slot};
+  auto iIndex = mIndex.find(key);
+  if(iIndex != mIndex.end()) {
+    auto iEntry = iIndex->second;
+    if(iEntry->size.x == size.x && iEntry->size.y == size.y && iEntry->contentHash == contentHash) {
+      ++mCurrentFrame.hits;
+      mEntries.splice(mEntries.begin(), mEntries, iEntry);
+      return iEntry->layer;
+    }
+
+    Erase(iEntry);
+  }
+
+  ++mCurrentFrame.misses;
+
+  Entry entry = {key, nullptr, size, contentHash, {}, 0};
+  if(!Render(pTarget, entry, paint))
+    return {};
+
+  EvictFor(entry.bytes);
+  mBytesInUse += entry.bytes;
+  mCurrentFrame.bytesInUse = mBytesInUse;
+
+  mEntries.push_front(entry);
+  mIndex[key] = mEntries.begin();
+  return mEntries.front().layer;
+}
+
+
+bool CLayerCache::Render(ID2D1RenderTarget* pTarget, Entry& entry, const PaintFn& paint) {
+  // Leave a pixel of room around the layer for antialiased edges
+  const auto padding = Point2F{1.f, 1.f};
+  const auto bitmapSize = Point2F{::ceilf(entry.size.x), ::ceilf(entry.size.y)} + padding * 2.f;
+
+  const auto maxBitmapSize = float(pTarget->GetMaximumBitmapSize());
+  if(bitmapSize.x > maxBitmapSize || bitmapSize.y > maxBitmapSize)
+    return false;
+
+  ID2D1BitmapRenderTargetPtr spLayerTarget;
+  if(FAILED(pTarget->CreateCompatibleRenderTarget(bitmapSize.to<D2D1_SIZE_F>(), &spLayerTarget)))
+    return false;
+
+  const auto layerTransform = D2D1::Matrix3x2F::Translation(padding.to<D2D1_SIZE_F>());
+
+  spLayerTarget->BeginDraw();
+  spLayerTarget->Clear(D2D1::ColorF(0.f, 0.f, 0.f, 0.f));
+  spLayerTarget->SetTransform(&layerTransform);
+  paint(spLayerTarget);
+  if(FAILED(spLayerTarget->EndDraw()))
+    return false;
+
+  if(FAILED(spLayerTarget->GetBitmap(&entry.spBitmap)))
+    return false;
+
+  const auto pixelSize = entry.spBitmap->GetPixelSize();
+  entry.bytes = size_t(pixelSize.width) * pixelSize.height * 4;
+  entry.layer = {entry.spBitmap, padding, bitmapSize};
+  return true;
+}
+
+
+void CLayerCache::Erase(EntryList::iterator iEntry) {
+  mBytesInUse -= iEntry->bytes;
+  mCurrentFrame.bytesInUse = mBytesInUse;
+  mIndex.erase(iEntry->key);
+  mEntries.erase(iEntry);
+}
+
+
+void CLayerCache::EvictFor(size_t bytes) {
+  while(!mEntries.empty() && mBytesInUse + bytes > mBudgetBytes) {
+    Erase(std::prev(mEntries.end()));
+    ++mCurrentFrame.evictions;
+  }
+}
+
+
+void CLayerCache::Invalidate(const void* pOwner) {
+  auto iIndex = mIndex.lower_bound(Key{pOwner, 0});
+  while(iIndex != mIndex.end() && iIndex->first.pOwner == pOwner) {
+    auto iEntry = iIndex->second;
+    ++iIndex;
+    Erase(iEntry);
+  }
+}
+
+
+void CLayerCache::Clear() {
+  mIndex.clear();
+  mEntries.clear();
+  mBytesInUse = 0;
+  mCurrentFrame.bytesInUse = 0;
+}
+
+
+void CLayerCache::BeginFrame() {
+  mCurrentFrame = FrameStats();
+  mCurrentFrame.bytesInUse = mBytesInUse;
+}
@@ -0,0 +1,94 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "Geometry.h"
+
+#include <d2d1.h>
+#include <d2d1helper.h>
+#include <comdef.h>
+
+#include <functional>
+#include <list>
+#include <map>
+
+_COM_SMARTPTR_TYPEDEF(ID2D1Bitmap, __uuidof(ID2D1Bitmap));
+_COM_SMARTPTR_TYPEDEF(ID2D1BitmapRenderTarget, __uuidof(ID2D1BitmapRenderTarget));
+
+// Keeps pre-rendered bitmaps of the static parts of views ("layers"), so that
+// they only need to be composited each frame instead of being painted again.
+//
+// A layer is identified by its owner and a slot number. It's rendered again
+// when its size or content hash changes. Layers are kept unrotated; a rotation
+// is applied when compositing them. All layers share a memory budget; if it's
+// exceeded, the least recently used layers are evicted.
+class CLayerCache {
+public:
+  static constexpr size_t sDefaultBudgetBytes = 8 * 1024 * 1024;
+
+  struct FrameStats {
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    unsigned int evictions = 0;
+    size_t bytesInUse = 0;
+  };
+
+  struct Layer {
+    ID2D1Bitmap* pBitmap = nullptr;
+    // Top-left corner of the layer within the bitmap, in DIPs
+    Point2F origin;
+    // Bitmap size in DIPs
+    Point2F size;
+  };
+
+  // Paints the layer content in layer coordinates, i.e. (0,0) is the top-left
+  // corner of the layer
+  using PaintFn = std::function<void(ID2D1RenderTarget*)>;
+
+  explicit CLayerCache(size_t budgetBytes = sDefaultBudgetBytes);
+
+  // Returns the layer, rendering it first if needed. pBitmap is null if the
+  // layer couldn't be rendered.
+  Layer Acquire(ID2D1RenderTarget* pTarget, const void* pOwner, unsigned int slot,
+    Point2F size, uint64_t contentHash, const PaintFn& paint);
+
+  void Invalidate(const void* pOwner);
+  void Clear();
+
+  void BeginFrame();
+  FrameStats CurrentFrameStats() const { return mCurrentFrame; }
+
+private:
+  struct Key {
+    const void* pOwner;
+    unsigned int slot;
+
+    bool operator<(const Key& other) const {
+      return pOwner != other.pOwner ? pOwner < other.pOwner : slot < other.slot;
+    }
+  };
+
+  struct Entry {
+    Key key;
+    ID2D1BitmapPtr spBitmap;
+    Point2F size;
+    uint64_t contentHash;
+    Layer layer;
+    size_t bytes;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  bool Render(ID2D1RenderTarget* pTarget, Entry& entry, const PaintFn& paint);
+  void Erase(EntryList::iterator iEntry);
+  void EvictFor(size_t bytes);
+
+  // Most recently used first
+  EntryList mEntries;
+  std::map<Key, EntryList::iterator> mIndex;
+
+  size_t mBudgetBytes;
+  size_t mBytesInUse = 0;
+
+  FrameStats mCurrentFrame;
+};
@@ -0,0 +1,84 @@
+// Copyright (c) v1ne
+
+#include "Layout.h"
+
+
+bool CLayout::Load(const wchar_t* path, std::string* pError) {
+  mpControls = nullptr;
+  mNumControls = mNumBanks = 0;
+  mOwnedControls.clear();
+
+  if(!mFile.OpenForReading(path)) {
+    *pError = "The file can't be opened";
+    return false;
+  }
+
+  const auto numBanks = ValidateLayout(mFile.Data(), mFile.Size(), pError);
+  if(!numBanks) {
+    mFile.Close();
+    return false;
+  }
+
+  mpControls = reinterpret_cast<const LayoutControl*>(mFile.Data() + sizeof(LayoutFileHeader));
+  mNumControls = (mFile.Size() - sizeof(LayoutFileHeader)) / sizeof(LayoutControl);
+  mNumBanks = numBanks;
+  return true;
+}
+
+
+bool CLayout::Assign(std::vector<LayoutControl> controls, std::string* pError) {
+  mFile.Close();
+  mOwnedControls = std::move(controls);
+  mpControls = nullptr;
+  mNumControls = mNumBanks = 0;
+
+  const auto numBanks = ValidateLayoutControls(mOwnedControls.data(), mOwnedControls.size(), pError);
+  if(!numBanks)
+    return false;
+
+  mpControls = mOwnedControls.data();
+  mNumControls = mOwnedControls.size();
+  mNumBanks = numBanks;
+  return true;
+}
+
+
+uint64_t CLayout::MappingFingerprint() const {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for(size_t i = 0; i < mNumControls; ++i) {
+    const auto& control = mpControls[i];
+    for(auto byte: {uint8_t(control.bank), uint8_t(control.bank >> 8), uint8_t(control.type),
+        control.device, control.channel, control.controller, uint8_t(control.resolution)}) {
+      hash ^= byte;
+      hash *= 0x100000001b3ull;
+    }
+  }
+  return hash;
+}
+
+
+bool CompileLayoutFile(const wchar_t* textPath, const wchar_t* binaryPath, std::string* pError) {
+  CMappedFile text;
+  if(!text.OpenForReading(textPath)) {
+    *pError = "The text layout can't be opened";
+    return false;
+  }
+
+  std::vector<uint8_t> image;
+  if(!CompileLayout(reinterpret_cast<const char*>(text.Data()), text.Size(), &image, pError))
+    return false;
+
+  auto hFile = ::CreateFileW(binaryPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(hFile == INVALID_HANDLE_VALUE) {
+    *pError = "The compiled layout can't be created";
+    return false;
+  }
+  DWORD numWritten = 0;
+  const auto success = ::WriteFile(hFile, image.data(), DWORD(image.size()), &numWritten, nullptr)
+    && numWritten == image.size();
+  ::CloseHandle(hFile);
+  if(!success)
+    *pError = "The compiled layout can't be written";
+  return success;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "LayoutFormat.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where the controls of each bank are and what they're mapped to
+class CLayout {
+public:
+  // Maps a compiled layout. The controls aren't copied, they're used from the
+  // mapping. Returns false and explains why in pError if it's not a valid layout.
+  bool Load(const wchar_t* path, std::string* pError);
+  // Uses controls from memory, e.g. a layout that's built in. They're sorted by bank.
+  bool Assign(std::vector<LayoutControl> controls, std::string* pError);
+
+  const LayoutControl* Controls() const { return mpControls; }
+  size_t NumControls() const { return mNumControls; }
+  size_t NumBanks() const { return mNumBanks; }
+  // Changes if the banks, types or MIDI mapping of the controls do, but not if they're only moved
+  uint64_t MappingFingerprint() const;
+
+private:
+  CMappedFile mFile;
+  std::vector<LayoutControl> mOwnedControls;
+  const LayoutControl* mpControls = nullptr;
+  size_t mNumControls = 0;
+  size_t mNumBanks = 0;
+};
+
+// Compiles a text layout file into a binary one
+bool CompileLayoutFile(const wchar_t* textPath, const wchar_t* binaryPath, std::string* pError);
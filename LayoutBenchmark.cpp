@@ -0,0 +1,92 @@
+// Copyright (c) v1ne
+
+#include "LayoutBenchmark.h"
+
+#include "Benchmark.h"
+#include "LayoutFormat.h"
+
+#include <fstream>
+#include <stdio.h>
+
+namespace {
+
+const size_t sNumControls[] = {1000, 10000, 100000};
+const int sNumRuns = 10;
+const char* const sFileName = "LayoutBenchmark.bin";
+
+
+// Banks of the built-in layout, with controllers numbered through across
+// channels, like StressLayout.txt
+std::string LayoutText(size_t numControls) {
+  const auto bank = BuiltInLayout();
+  std::string text;
+  char line[128];
+  for(size_t i = 0; i < numControls; ++i) {
+    const auto& control = bank[i % bank.size()];
+    snprintf(line, sizeof(line), "%u %s %g %g %g %g %u %u\n", unsigned(i / bank.size()),
+      control.type == CControlModel::ControlType::Knob ? "knob" : "slider", control.rect.left, control.rect.top,
+      control.rect.Size().x, control.rect.Size().y, unsigned(i / 128 % 16 + 1), unsigned(i % 128));
+    text += line;
+  }
+  return text;
+}
+
+
+bool ReadFile(const char* pPath, std::vector<uint8_t>* pData) {
+  std::ifstream file(pPath, std::ios::binary | std::ios::ate);
+  if(!file)
+    return false;
+  pData->resize(size_t(file.tellg()));
+  file.seekg(0);
+  return bool(file.read(reinterpret_cast<char*>(pData->data()), std::streamsize(pData->size())));
+}
+
+}
+
+
+bool BenchmarkLayoutLoad(const SelfCheckOptions&, std::string* pReport) {
+  auto success = true;
+  for(const auto numControls: sNumControls) {
+    const auto text = LayoutText(numControls);
+    CBenchmarkTimes compile, read, validate;
+    std::vector<uint8_t> image;
+    std::string error;
+    for(int run = 0; run < sNumRuns; ++run) {
+      auto begin = CBenchmarkTimes::Clock::now();
+      success &= CompileLayout(text.c_str(), text.size(), &image, &error);
+      compile.Add(CBenchmarkTimes::Clock::now() - begin);
+    }
+
+    {
+      std::ofstream file(sFileName, std::ios::binary);
+      file.write(reinterpret_cast<const char*>(image.data()), std::streamsize(image.size()));
+      success &= bool(file);
+    }
+
+    size_t numBanks = 0;
+    for(int run = 0; run < sNumRuns; ++run) {
+      std::vector<uint8_t> data;
+      auto begin = CBenchmarkTimes::Clock::now();
+      success &= ReadFile(sFileName, &data);
+      read.Add(CBenchmarkTimes::Clock::now() - begin);
+
+      begin = CBenchmarkTimes::Clock::now();
+      numBanks = ValidateLayout(data.data(), data.size(), &error);
+      validate.Add(CBenchmarkTimes::Clock::now() - begin);
+      success &= numBanks != 0;
+    }
+    remove(sFileName);
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%u controls in %u banks, %u bytes of text, %u bytes compiled\n",
+      unsigned(numControls), unsigned(numBanks), unsigned(text.size()), unsigned(image.size()));
+    *pReport += buf;
+    *pReport += compile.Summary("  Compile");
+    *pReport += read.Summary("  Read the file");
+    *pReport += validate.Summary("  Validate");
+  }
+
+  if(!success)
+    *pReport += "Couldn't compile, write or load a layout\n";
+  return success;
+}
@@ -0,0 +1,13 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "SelfCheck.h"
+
+#include <string>
+
+// Compiles text layouts of 1000 to 100000 controls in banks of the built-in
+// layout, writes them to a file and loads them back. Reports the time to
+// compile, to read the file and to validate the controls, which is all that
+// CLayout::Load does besides mapping the file.
+bool BenchmarkLayoutLoad(const SelfCheckOptions& options, std::string* pReport);
@@ -0,0 +1,240 @@
+// Copyright (c) v1ne
+
+#include "LayoutFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static constexpr uint32_t sLayoutMagic = 0x5459414C; // "LAYT"
+static constexpr uint16_t sLayoutVersion = 1;
+
+static constexpr unsigned int sNumDevices = 16;
+static constexpr unsigned int sNumChannels = 16;
+static constexpr unsigned int sNumControllers = 128;
+// The MSBs of 14-bit controllers. Their LSBs follow.
+static constexpr unsigned int sNum14BitControllers = 32;
+
+// The built-in layout has sBuiltInNumSliders sliders, a big slider and sBuiltInNumKnobs knobs
+static constexpr int sBuiltInNumSliders = 14;
+static constexpr int sBuiltInNumKnobs = 15;
+static constexpr int sBuiltInNumControls = sBuiltInNumSliders + 1 + sBuiltInNumKnobs;
+
+
+static std::string LineError(size_t line, const char* message) {
+  char buf[160];
+  snprintf(buf, sizeof(buf), "Line %u: %s", unsigned(line), message);
+  return buf;
+}
+
+
+size_t ValidateLayoutControls(const LayoutControl* pControls, size_t numControls, std::string* pError) {
+  if(numControls == 0) {
+    *pError = "The layout has no controls";
+    return 0;
+  }
+
+  for(size_t i = 0; i < numControls; ++i) {
+    const auto& control = pControls[i];
+    const char* pProblem = nullptr;
+    if(i > 0 && control.bank < pControls[i - 1].bank)
+      pProblem = "isn't sorted by bank";
+    else if(control.type != CControlModel::ControlType::Slider && control.type != CControlModel::ControlType::Knob)
+      pProblem = "has an unknown type";
+    else if(control.device >= sNumDevices || control.channel >= sNumChannels || control.controller >= sNumControllers
+        || control.resolution > MidiResolution::Nrpn14Bit
+        || (control.resolution == MidiResolution::Cc14Bit && control.controller >= sNum14BitControllers))
+      pProblem = "isn't mapped to a valid MIDI controller";
+    else if(!std::isfinite(control.rect.left) || !std::isfinite(control.rect.top)
+        || !std::isfinite(control.rect.right) || !std::isfinite(control.rect.bottom)
+        || control.rect.IsEmpty())
+      pProblem = "has an empty rect";
+
+    if(pProblem) {
+      char buf[96];
+      snprintf(buf, sizeof(buf), "Control %u %s", unsigned(i), pProblem);
+      *pError = buf;
+      return 0;
+    }
+  }
+
+  return size_t(pControls[numControls - 1].bank) + 1;
+}
+
+
+size_t ValidateLayout(const uint8_t* pData, size_t size, std::string* pError) {
+  if(size < sizeof(LayoutFileHeader)) {
+    *pError = "The file is too small for a layout";
+    return 0;
+  }
+
+  LayoutFileHeader header;
+  memcpy(&header, pData, sizeof(header));
+  if(header.magic != sLayoutMagic) {
+    *pError = "The file isn't a compiled layout";
+    return 0;
+  }
+  if(header.version != sLayoutVersion || header.controlSize != sizeof(LayoutControl)) {
+    *pError = "The layout was compiled for a different version";
+    return 0;
+  }
+  if((size - sizeof(header)) / sizeof(LayoutControl) != header.numControls
+      || (size - sizeof(header)) % sizeof(LayoutControl) != 0) {
+    *pError = "The size of the file doesn't match the number of controls";
+    return 0;
+  }
+
+  // Mapped views are page-aligned and the header keeps the controls aligned
+  return ValidateLayoutControls(reinterpret_cast<const LayoutControl*>(pData + sizeof(header)), header.numControls, pError);
+}
+
+
+bool CompileLayout(const char* pText, size_t length, std::vector<uint8_t>* pImage, std::string* pError) {
+  std::vector<LayoutControl> controls;
+
+  size_t lineNumber = 0;
+  for(size_t begin = 0; begin < length;) {
+    ++lineNumber;
+    auto end = begin;
+    while(end < length && pText[end] != '\n')
+      ++end;
+
+    // Without the comment
+    std::string line(pText + begin, end - begin);
+    begin = end + 1;
+    line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+    if(line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+
+    unsigned int bank, device = 1, channel, controller;
+    char type[16];
+    char deviceAndChannel[16];
+    char resolution[16] = "7bit";
+    float left, top, width, height;
+    int numParsed = 0;
+    auto isValid = sscanf(line.c_str(), "%u %15s %f %f %f %f %15s %u %n",
+      &bank, type, &left, &top, &width, &height, deviceAndChannel, &controller, &numParsed) == 8;
+    // The device is optional
+    if(isValid) {
+      int numParsedChannel = 0;
+      if(strchr(deviceAndChannel, ':'))
+        isValid = sscanf(deviceAndChannel, "%u:%u%n", &device, &channel, &numParsedChannel) == 2;
+      else
+        isValid = sscanf(deviceAndChannel, "%u%n", &channel, &numParsedChannel) == 1;
+      isValid = isValid && deviceAndChannel[numParsedChannel] == '\0';
+    }
+    // The resolution is optional
+    if(isValid && size_t(numParsed) != line.size()) {
+      int numParsedResolution = 0;
+      isValid = sscanf(line.c_str() + numParsed, "%15s %n", resolution, &numParsedResolution) == 1
+        && size_t(numParsed + numParsedResolution) == line.size();
+    }
+    if(!isValid) {
+      *pError = LineError(lineNumber,
+        "Expected: <bank> slider|knob <left> <top> <width> <height> [<device>:]<channel> <controller> [7bit|14bit|nrpn]");
+      return false;
+    }
+
+    LayoutControl control = {};
+    if(!strcmp(type, "slider"))
+      control.type = CControlModel::ControlType::Slider;
+    else if(!strcmp(type, "knob"))
+      control.type = CControlModel::ControlType::Knob;
+    else {
+      *pError = LineError(lineNumber, "The type must be slider or knob");
+      return false;
+    }
+
+    if(!strcmp(resolution, "7bit"))
+      control.resolution = MidiResolution::Cc7Bit;
+    else if(!strcmp(resolution, "14bit"))
+      control.resolution = MidiResolution::Cc14Bit;
+    else if(!strcmp(resolution, "nrpn"))
+      control.resolution = MidiResolution::Nrpn14Bit;
+    else {
+      *pError = LineError(lineNumber, "The resolution must be 7bit, 14bit or nrpn");
+      return false;
+    }
+
+    if(bank > UINT16_MAX - 1) {
+      *pError = LineError(lineNumber, "The bank is out of range");
+      return false;
+    }
+    if(device < 1 || device > sNumDevices || channel < 1 || channel > sNumChannels || controller >= sNumControllers) {
+      *pError = LineError(lineNumber, "The device and the channel must be 1-16 and the controller 0-127");
+      return false;
+    }
+    if(control.resolution == MidiResolution::Cc14Bit && controller >= sNum14BitControllers) {
+      *pError = LineError(lineNumber, "14-bit controllers must be 0-31");
+      return false;
+    }
+    if(!(width > 0.f) || !(height > 0.f)) {
+      *pError = LineError(lineNumber, "The control must have a size");
+      return false;
+    }
+
+    control.rect = Rect2F::FromPoints({left, top}, {left + width, top + height});
+    control.bank = uint16_t(bank);
+    control.device = uint8_t(device - 1);
+    control.channel = uint8_t(channel - 1);
+    control.controller = uint8_t(controller);
+    controls.push_back(control);
+  }
+
+  // Controls keep their order within a bank
+  std::stable_sort(controls.begin(), controls.end(),
+    [](const LayoutControl& a, const LayoutControl& b) { return a.bank < b.bank; });
+  if(!ValidateLayoutControls(controls.data(), controls.size(), pError))
+    return false;
+
+  const LayoutFileHeader header = {sLayoutMagic, sLayoutVersion, uint16_t(sizeof(LayoutControl)),
+    uint32_t(controls.size()), 0};
+  pImage->resize(sizeof(header) + controls.size() * sizeof(LayoutControl));
+  memcpy(pImage->data(), &header, sizeof(header));
+  memcpy(pImage->data() + sizeof(header), controls.data(), controls.size() * sizeof(LayoutControl));
+  return true;
+}
+
+
+std::vector<LayoutControl> BuiltInLayout() {
+  const auto sliderBorder = Point2F{5};
+  const auto sliderSize = Point2F{50, 200};
+  const auto sliderDistance = sliderSize + sliderBorder;
+  const auto numSliderColumns = 7;
+
+  const auto bigSliderPos = Point2F{sliderBorder.x + sliderDistance.x*numSliderColumns, sliderBorder.y};
+  const auto bigSliderSize = Point2F{50, 2*sliderDistance.y - sliderBorder.y};
+
+  // The knobs go below the sliders
+  const auto knobBorder = Point2F{2.f};
+  const auto knobSize = Point2F{50.f};
+  const auto knobDistance = knobSize + knobBorder;
+  const auto knobOrigin = Point2F{knobBorder.x, 2*sliderDistance.y + sliderBorder.y};
+  const auto numKnobColumns = 5;
+
+  std::vector<LayoutControl> controls(sBuiltInNumControls);
+  for(int i = 0; i < sBuiltInNumControls; i++) {
+    auto& control = controls[i];
+    if(i < sBuiltInNumSliders) {
+      const auto pos = sliderBorder + sliderDistance.mulByComponent(
+        Point2I{i % numSliderColumns, i / numSliderColumns});
+      control.rect = Rect2F::FromPoints(pos, pos + sliderSize);
+      control.type = CControlModel::ControlType::Slider;
+    } else if(i == sBuiltInNumSliders) {
+      control.rect = Rect2F::FromPoints(bigSliderPos, bigSliderPos + bigSliderSize);
+      control.type = CControlModel::ControlType::Slider;
+    } else {
+      const auto knob = i - sBuiltInNumSliders - 1;
+      const auto pos = knobOrigin + knobDistance.mulByComponent(
+        Point2I{knob % numKnobColumns, knob / numKnobColumns});
+      control.rect = Rect2F::FromPoints(pos, pos + knobSize);
+      control.type = CControlModel::ControlType::Knob;
+    }
+
+    control.bank = 0;
+    control.channel = 0;
+    control.controller = uint8_t(i);
+  }
+  return controls;
+}
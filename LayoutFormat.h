@@ -0,0 +1,59 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "ControlModel.h"
+#include "Geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compiled layouts are a header followed by an array of LayoutControl, in the
+// byte order of the machine, so that they can be used right from a mapped
+// file. Controls are sorted by bank.
+struct LayoutFileHeader {
+  uint32_t magic;
+  uint16_t version;
+  // sizeof(LayoutControl), so that a file from a different build is rejected
+  uint16_t controlSize;
+  uint32_t numControls;
+  uint32_t reserved;
+};
+
+struct LayoutControl {
+  // In canvas coordinates, i.e. logical points while the canvas isn't zoomed
+  Rect2F rect;
+  uint16_t bank;
+  CControlModel::ControlType type;
+  uint8_t channel;
+  // For Cc14Bit, the one with the MSB
+  uint8_t controller;
+  MidiResolution resolution;
+  // Index of the MIDI output
+  uint8_t device;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(LayoutFileHeader) == 16, "The layout file format depends on this");
+static_assert(sizeof(LayoutControl) == 24, "The layout file format depends on this");
+
+// The layout for when there's no compiled one. It's a single bank of sliders
+// and knobs. StressLayout.txt has many banks of it.
+std::vector<LayoutControl> BuiltInLayout();
+
+// Checks that controls can be used as they are. Returns the number of banks,
+// or 0 if they can't be used.
+size_t ValidateLayoutControls(const LayoutControl* pControls, size_t numControls, std::string* pError);
+
+// Checks that a compiled layout can be used as it is. Returns the number of
+// banks, or 0 if it can't be used.
+size_t ValidateLayout(const uint8_t* pData, size_t size, std::string* pError);
+
+// Compiles a text layout. Each line describes a control:
+//   <bank> slider|knob <left> <top> <width> <height> [<device 1-16>:]<MIDI channel 1-16> <controller 0-127> [7bit|14bit|nrpn]
+// The device is the MIDI output, in the order they're opened, the first by
+// default. 14bit sends the LSB on controller+32, so the controller must be
+// 0-31. nrpn sends NRPN <controller>. Everything after a '#' is a comment.
+bool CompileLayout(const char* pText, size_t length, std::vector<uint8_t>* pImage, std::string* pError);
@@ -0,0 +1,119 @@
+// Copyright (c) v1ne
+
+#include "MappedFile.h"
+
+CMappedFile::~CMappedFile() {
+  Close();
+}
+
+
+bool CMappedFile::OpenForReading(const wchar_t* path) {
+  Close();
+
+  mhFile = ::CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if(mhFile == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if(!::GetFileSizeEx(mhFile, &size) || size.QuadPart <= 0 || uint64_t(size.QuadPart) > SIZE_MAX) {
+    Close();
+    return false;
+  }
+
+  mhMapping = ::CreateFileMappingW(mhFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if(mhMapping)
+    mpView = ::MapViewOfFile(mhMapping, FILE_MAP_READ, 0, 0, 0);
+  if(!mpView) {
+    Close();
+    return false;
+  }
+
+  mSize = size_t(size.QuadPart);
+  return true;
+}
+
+
+bool CMappedFile::OpenForWriting(const wchar_t* path, size_t size) {
+  Close();
+  if(size == 0)
+    return false;
+
+  mhFile = ::CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+    FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(mhFile == INVALID_HANDLE_VALUE)
+    return false;
+
+  // Mapping more than the file has grows it
+  const auto size64 = uint64_t(size);
+  mhMapping = ::CreateFileMappingW(mhFile, nullptr, PAGE_READWRITE, DWORD(size64 >> 32), DWORD(size64), nullptr);
+  if(mhMapping)
+    mpView = ::MapViewOfFile(mhMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+  if(!mpView) {
+    Close();
+    return false;
+  }
+
+  mSize = size;
+  mIsWritable = true;
+  return true;
+}
+
+
+bool CMappedFile::CreateShared(const wchar_t* name, size_t size) {
+  Close();
+  if(size == 0)
+    return false;
+
+  const auto size64 = uint64_t(size);
+  mhMapping = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, DWORD(size64 >> 32), DWORD(size64),
+    name);
+  return MapShared(size);
+}
+
+
+bool CMappedFile::OpenShared(const wchar_t* name, size_t size) {
+  Close();
+  if(size == 0)
+    return false;
+
+  mhMapping = ::OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, name);
+  return MapShared(size);
+}
+
+
+bool CMappedFile::MapShared(size_t size) {
+  if(mhMapping)
+    mpView = ::MapViewOfFile(mhMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+  if(!mpView) {
+    Close();
+    return false;
+  }
+
+  mSize = size;
+  mIsWritable = true;
+  return true;
+}
+
+
+bool CMappedFile::Flush() {
+  if(!mpView || !mIsWritable || mhFile == INVALID_HANDLE_VALUE)
+    return false;
+  return ::FlushViewOfFile(mpView, 0) && ::FlushFileBuffers(mhFile);
+}
+
+
+void CMappedFile::Close() {
+  if(mpView)
+    ::UnmapViewOfFile(mpView);
+  if(mhMapping)
+    ::CloseHandle(mhMapping);
+  if(mhFile != INVALID_HANDLE_VALUE)
+    ::CloseHandle(mhFile);
+
+  mhFile = INVALID_HANDLE_VALUE;
+  mhMapping = nullptr;
+  mpView = nullptr;
+  mSize = 0;
+  mIsWritable = false;
+}
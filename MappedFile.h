@@ -0,0 +1,48 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <windows.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// A file that's mapped into memory as a whole, so that it can be used in
+// place instead of being read into a buffer. Also maps shared memory that
+// isn't backed by a file.
+class CMappedFile {
+public:
+  CMappedFile() = default;
+  ~CMappedFile();
+  CMappedFile(const CMappedFile&) = delete;
+  CMappedFile& operator=(const CMappedFile&) = delete;
+
+  // Maps an existing file for reading. Empty files can't be mapped.
+  bool OpenForReading(const wchar_t* path);
+  // Maps the first `size` bytes of a file for reading and writing. The file is
+  // created or grown as needed, with zeros. Writes reach the file without
+  // Flush, even if the process dies, but not necessarily if the system does.
+  bool OpenForWriting(const wchar_t* path, size_t size);
+  // Maps named shared memory for reading and writing, which other processes
+  // map by the same name. CreateShared creates it with zeros if it doesn't
+  // exist yet, OpenShared only maps it if it does.
+  bool CreateShared(const wchar_t* name, size_t size);
+  bool OpenShared(const wchar_t* name, size_t size);
+  // Waits until everything written so far is on disk
+  bool Flush();
+  void Close();
+
+  bool IsOpen() const { return mpView != nullptr; }
+  const uint8_t* Data() const { return static_cast<const uint8_t*>(mpView); }
+  uint8_t* MutableData() { return mIsWritable ? static_cast<uint8_t*>(mpView) : nullptr; }
+  size_t Size() const { return mSize; }
+
+private:
+  bool MapShared(size_t size);
+
+  HANDLE mhFile = INVALID_HANDLE_VALUE;
+  HANDLE mhMapping = nullptr;
+  void* mpView = nullptr;
+  size_t mSize = 0;
+  bool mIsWritable = false;
+};
@@ -0,0 +1,60 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Moves MIDI to a device. Encoding, buffering and stats are up to MidiOutput.
+class CMidiBackend {
+public:
+  virtual ~CMidiBackend() = default;
+
+  virtual const std::wstring& DeviceName() const = 0;
+
+  // A MIDI 1.0 channel message: the status byte and the data bytes, from the
+  // lowest byte up
+  virtual bool SendShortMessage(uint32_t message) = 0;
+  // A MIDI 1.0 byte stream, e.g. many messages with running status. The
+  // bytes are copied, and the call returns without waiting for the device.
+  // Everything that's sent arrives in order.
+  virtual bool SendBytes(const uint8_t* pBytes, size_t size) = 0;
+
+  // Whether the device takes Universal MIDI Packets. Devices that don't get
+  // MIDI 2.0 down-converted to MIDI 1.0.
+  virtual bool IsUmpCapable() const { return false; }
+  virtual bool SendPackets(const uint32_t* pWords, size_t numWords) {
+    (void)pWords; (void)numWords;
+    return false;
+  }
+};
+
+// Calls sendMessage with each message of a MIDI 1.0 byte stream of channel
+// messages, which may use running status, as SendShortMessage takes them.
+// For drivers that don't take byte streams.
+template<typename SendFn>
+bool ForEachShortMessage(const uint8_t* pBytes, size_t size, SendFn sendMessage) {
+  auto success = true;
+  uint8_t status = 0;
+  uint32_t message = 0;
+  auto numDataBytes = 0;
+  for(size_t i = 0; i < size; ++i) {
+    const auto byte = pBytes[i];
+    if(byte & 0x80) {
+      status = byte;
+      numDataBytes = 0;
+      continue;
+    }
+
+    if(!numDataBytes)
+      message = status;
+    message |= uint32_t(byte) << (8 * ++numDataBytes);
+    // Program and channel pressure changes have a single data byte
+    if(numDataBytes == ((status & 0xE0) == 0xC0 ? 1 : 2)) {
+      success &= sendMessage(message);
+      numDataBytes = 0;
+    }
+  }
+  return success;
+}
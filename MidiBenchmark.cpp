@@ -0,0 +1,437 @@
+// Copyright (c) v1ne
+
+#include "MidiBenchmark.h"
+
+#include "Benchmark.h"
+#include "LayoutFormat.h"
+#include "MidiRouter.h"
+#include "MidiScheduler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int sNumRuns = 20;
+const size_t sNumManyControls = 2000;
+const size_t sNumManyDevices = 4;
+// A drag with up to ten fingers on a digitizer that reports 120 times a
+// second, each finger on a control of its own
+const size_t sNumFingers[] = {1, 5, 10};
+const int sTouchFramesPerSecond = 120;
+const int sNumDragFrames = 2 * sTouchFramesPerSecond;
+// Like /midi-buffer by default
+const size_t sFlushThresholdBytes = 256;
+const int sNumRoutingRounds = 200;
+// A gesture on a control with an input every 8 ms. The window gets to each
+// input after a stall that varies, like painting and other messages take.
+const int sNumGestureInputs = 250;
+const auto sInputInterval = std::chrono::milliseconds(8);
+const int sStallMilliseconds[] = {0, 2, 8, 1, 0, 12, 3, 5, 0, 6};
+// Longer than the window falls behind in the stalls
+const unsigned int sLatencyMicroseconds = 20000;
+// MIDI sends 31250 bits per second, 10 bits per byte
+const unsigned int sWireBytesPerSecond = 3125;
+
+
+// Takes bytes at the rate of a MIDI cable: each byte leaves the wire 320 us
+// after the one before it, or right away if the wire is idle
+class CSimulatedMidiBackend : public CMidiBackend {
+public:
+  const std::wstring& DeviceName() const override { return mDeviceName; }
+
+  bool SendShortMessage(uint32_t message) override {
+    // Program and channel pressure changes have a single data byte
+    return Transmit((message & 0xE0) == 0xC0 ? 2 : 3);
+  }
+  bool SendBytes(const uint8_t*, size_t size) override { return Transmit(size); }
+
+  size_t NumCalls() const { return mNumCalls; }
+  size_t NumBytes() const { return mNumBytes; }
+  const std::vector<Clock::time_point>& CallTimes() const { return mCallTimes; }
+  // When the last byte that was sent so far has left the wire
+  Clock::time_point WireIdleTime() const { return mWireIdleTime; }
+
+private:
+  bool Transmit(size_t size) {
+    const auto now = Clock::now();
+    if(mWireIdleTime < now)
+      mWireIdleTime = now;
+    mWireIdleTime += size * std::chrono::microseconds(CMidiEncoder::sWireMicrosecondsPerByte);
+    ++mNumCalls;
+    mNumBytes += size;
+    mCallTimes.push_back(now);
+    return true;
+  }
+
+  std::wstring mDeviceName = L"Simulated MIDI device";
+  size_t mNumCalls = 0;
+  size_t mNumBytes = 0;
+  Clock::time_point mWireIdleTime;
+  std::vector<Clock::time_point> mCallTimes;
+};
+
+
+// A router with simulated outputs. pBackends receives them, in the order of
+// the outputs.
+void AddSimulatedOutputs(CMidiRouter* pRouter, size_t numDevices, std::vector<CSimulatedMidiBackend*>* pBackends) {
+  for(size_t device = 0; device < numDevices; ++device) {
+    auto pBackend = std::make_unique<CSimulatedMidiBackend>();
+    pBackends->push_back(pBackend.get());
+    pRouter->AddOutput(std::move(pBackend));
+  }
+}
+
+
+// Controls are spread over the devices in turn, and over the controllers of
+// each device channel by channel
+std::vector<CMidiRouter::Target> ManyTargets(size_t numControls, size_t numDevices) {
+  std::vector<CMidiRouter::Target> targets;
+  for(size_t i = 0; i < numControls; ++i) {
+    const auto indexOnDevice = i / numDevices;
+    targets.push_back({uint8_t(i % numDevices), uint8_t(indexOnDevice / 128 % 16), uint8_t(indexOnDevice % 128),
+      MidiResolution::Cc7Bit});
+  }
+  return targets;
+}
+
+
+uint16_t ValueOf(size_t control, const CMidiRouter::Target& target) {
+  return uint16_t(control * 37 % (CMidiEncoder::MaxValue(target.resolution) + 1));
+}
+
+
+struct ResyncResult {
+  size_t numCalls = 0;
+  size_t numBytes = 0;
+  // Until the last byte has left the wire
+  Clock::duration wireTime{};
+};
+
+
+ResyncResult ResultOf(const std::vector<CSimulatedMidiBackend*>& backends, Clock::time_point begin) {
+  ResyncResult result;
+  for(const auto* pBackend: backends) {
+    result.numCalls += pBackend->NumCalls();
+    result.numBytes += pBackend->NumBytes();
+    if(pBackend->WireIdleTime() - begin > result.wireTime)
+      result.wireTime = pBackend->WireIdleTime() - begin;
+  }
+  return result;
+}
+
+
+// Like CComTouchDriver::ResyncMidi: a stream per device, with every value in full
+ResyncResult ResyncAsStreams(const std::vector<CMidiRouter::Target>& targets, size_t numDevices,
+  CBenchmarkTimes* pTimes)
+{
+  CMidiRouter router;
+  std::vector<CSimulatedMidiBackend*> backends;
+  AddSimulatedOutputs(&router, numDevices, &backends);
+  for(const auto& target: targets)
+    router.AddTarget(target);
+  std::vector<CMidiEncoder> encoders(numDevices);
+
+  const auto begin = Clock::now();
+  for(size_t control = 0; control < targets.size(); ++control) {
+    const auto& target = targets[control];
+    encoders[target.device].Controller(target.channel, target.controller, target.resolution,
+      ValueOf(control, target), CMidiEncoder::sNoValue);
+  }
+  for(size_t device = 0; device < numDevices; ++device) {
+    router.Output(device).beginStream(encoders[device]);
+    router.Output(device).sendStream(encoders[device]);
+  }
+  pTimes->Add(Clock::now() - begin);
+
+  return ResultOf(backends, begin);
+}
+
+
+// Each value as a short message of its own, as without buffering
+ResyncResult ResyncAsShortMessages(const std::vector<CMidiRouter::Target>& targets, size_t numDevices,
+  CBenchmarkTimes* pTimes)
+{
+  CMidiRouter router;
+  std::vector<CSimulatedMidiBackend*> backends;
+  AddSimulatedOutputs(&router, numDevices, &backends);
+  for(const auto& target: targets)
+    router.AddTarget(target);
+
+  const auto begin = Clock::now();
+  for(size_t control = 0; control < targets.size(); ++control)
+    router.Send(control, ValueOf(control, targets[control]), CMidiEncoder::sNoValue);
+  router.Flush();
+  pTimes->Add(Clock::now() - begin);
+
+  return ResultOf(backends, begin);
+}
+
+
+std::string ResyncSummary(const char* pLabel, const ResyncResult& result, const CBenchmarkTimes& times) {
+  char buf[160];
+  snprintf(buf, sizeof(buf), "  %s: %u calls, %u bytes, %.1f ms on the wire, median %.1f us in the app\n", pLabel,
+    unsigned(result.numCalls), unsigned(result.numBytes),
+    std::chrono::duration<double, std::milli>(result.wireTime).count(), times.MedianNanoseconds() / 1000.);
+  return buf;
+}
+
+
+
+// The value of a finger's control in a frame. Fingers move at different
+// speeds, back and forth.
+uint8_t DragValue(size_t finger, int frame) {
+  const auto pos = (frame * int(finger + 1)) % 254;
+  return uint8_t(pos < 128 ? pos : 254 - pos);
+}
+
+
+// Drags, and sends the values of each frame, like the window does after a
+// touch message. Reports the calls and bytes per second.
+std::string DragSummary(const char* pLabel, size_t numFingers, size_t flushThresholdBytes, MidiOutput::Stats* pStats) {
+  MidiOutput output;
+  output.open(std::make_unique<CSimulatedMidiBackend>());
+  output.setBuffering(flushThresholdBytes);
+
+  CBenchmarkTimes times;
+  std::vector<uint8_t> lastValues(numFingers, 0xFF);
+  for(int frame = 0; frame < sNumDragFrames; ++frame) {
+    const auto begin = Clock::now();
+    for(size_t finger = 0; finger < numFingers; ++finger) {
+      // Like CSlider, only changes are sent
+      const auto value = DragValue(finger, frame);
+      if(value != lastValues[finger])
+        output.sendControllerChange(uint8_t(finger), value);
+      lastValues[finger] = value;
+    }
+    output.flush();
+    times.Add(Clock::now() - begin);
+  }
+
+  *pStats = output.takeStats();
+  const auto seconds = double(sNumDragFrames) / sTouchFramesPerSecond;
+  char buf[160];
+  snprintf(buf, sizeof(buf), "  %s: %.0f calls/s, %.0f bytes/s (%.0f%% of the wire), median %.1f us per frame\n",
+    pLabel, pStats->numCalls / seconds, pStats->numBytes / seconds,
+    100. * pStats->numBytes / seconds / sWireBytesPerSecond, times.MedianNanoseconds() / 1000.);
+  return buf;
+}
+
+
+
+// Sends a value for each control, then flushes, like a frame in which all
+// controls moved. Reports how many values per second that routes.
+std::string RoutingSummary(const char* pLabel, MidiOutput::Protocol protocol, MidiOutput::Stats* pStats) {
+  CMidiRouter router;
+  std::vector<CSimulatedMidiBackend*> backends;
+  AddSimulatedOutputs(&router, sNumManyDevices, &backends);
+  const auto targets = ManyTargets(sNumManyControls, sNumManyDevices);
+  for(const auto& target: targets)
+    router.AddTarget(target);
+  router.SetBuffering(sFlushThresholdBytes);
+  router.SetProtocol(protocol);
+
+  CBenchmarkTimes times;
+  std::vector<uint16_t> values(targets.size(), CMidiEncoder::sNoValue);
+  for(int round = 0; round < sNumRoutingRounds; ++round) {
+    const auto begin = Clock::now();
+    for(size_t control = 0; control < targets.size(); ++control) {
+      const auto value = uint16_t((control + size_t(round)) % 128);
+      router.Send(control, value, values[control]);
+      values[control] = value;
+    }
+    router.Flush();
+    times.Add(Clock::now() - begin);
+  }
+
+  *pStats = router.TakeStats();
+  size_t minBytes = SIZE_MAX, maxBytes = 0;
+  for(const auto* pBackend: backends) {
+    minBytes = pBackend->NumBytes() < minBytes ? pBackend->NumBytes() : minBytes;
+    maxBytes = pBackend->NumBytes() > maxBytes ? pBackend->NumBytes() : maxBytes;
+  }
+  const auto nanoseconds = double(times.MedianNanoseconds());
+  char buf[192];
+  snprintf(buf, sizeof(buf), "  %s: median %.1f us per round, %.2f million values/s, %u calls, "
+    "%u to %u bytes per device\n", pLabel, nanoseconds / 1000., nanoseconds ? targets.size() * 1000. / nanoseconds : 0.,
+    pStats->numCalls, unsigned(minBytes), unsigned(maxBytes));
+  return buf;
+}
+
+
+
+// Plays the gesture through a scheduler with the latency, which sends each
+// value on its own. Reports the delay from each input to its value reaching
+// the device, and how much it varies.
+std::string JitterSummary(const char* pLabel, unsigned int latencyMicroseconds, size_t* pNumSent) {
+  CMidiRouter router;
+  std::vector<CSimulatedMidiBackend*> backends;
+  AddSimulatedOutputs(&router, 1, &backends);
+  router.AddTarget({0, 0, 0, MidiResolution::Cc7Bit});
+
+  CMidiScheduler::Stats stats;
+  const auto begin = Clock::now();
+  {
+    CMidiScheduler scheduler(&router);
+    scheduler.SetLatency(latencyMicroseconds);
+    // Touch times are in milliseconds, like TOUCHINPUT::dwTime
+    const auto beginMilliseconds = ::GetTickCount();
+    auto lastValue = CMidiEncoder::sNoValue;
+    for(int input = 0; input < sNumGestureInputs; ++input) {
+      std::this_thread::sleep_until(begin + input * sInputInterval);
+      const auto stall = sStallMilliseconds[input % (sizeof(sStallMilliseconds) / sizeof(sStallMilliseconds[0]))];
+      std::this_thread::sleep_for(std::chrono::milliseconds(stall));
+
+      scheduler.SetSourceTime(beginMilliseconds + DWORD(input * sInputInterval.count()));
+      const auto value = uint16_t(input % 128);
+      scheduler.Send(0, value, lastValue);
+      scheduler.Flush();
+      lastValue = value;
+    }
+    // Waits for the last values, then stops the thread
+    std::this_thread::sleep_for(std::chrono::microseconds(latencyMicroseconds) + std::chrono::milliseconds(50));
+    stats = scheduler.TakeStats();
+  }
+
+  // From each input to its value
+  const auto& callTimes = backends[0]->CallTimes();
+  *pNumSent = callTimes.size();
+  double sum = 0., sumOfSquares = 0., minDelay = 0., maxDelay = 0.;
+  for(size_t i = 0; i < callTimes.size(); ++i) {
+    const auto input = begin + int(i) * sInputInterval;
+    const auto delay = std::chrono::duration<double, std::milli>(callTimes[i] - input).count();
+    sum += delay;
+    sumOfSquares += delay * delay;
+    minDelay = !i || delay < minDelay ? delay : minDelay;
+    maxDelay = !i || delay > maxDelay ? delay : maxDelay;
+  }
+  const auto numSent = double(callTimes.size() ? callTimes.size() : 1);
+  const auto mean = sum / numSent;
+  const auto variance = sumOfSquares / numSent - mean * mean;
+  const auto deviation = sqrt(variance > 0. ? variance : 0.);
+
+  char buf[192];
+  snprintf(buf, sizeof(buf), "  %s: %.1f ms delay on average, jitter %.2f ms standard deviation, %.1f ms peak to "
+    "peak, %u late\n", pLabel, mean, deviation, maxDelay - minDelay, stats.numLate);
+  return buf;
+}
+
+}
+
+
+const SelfCheck gMidiBenchmarks[] = {
+  {"midi-resync-benchmark", "Resyncing the built-in layout and 2000 controls on 4 devices at the MIDI wire rate",
+    true, BenchmarkMidiResync},
+  {"midi-buffering-benchmark", "Calls and bytes per second of a drag with 1, 5 and 10 fingers, with and without buffering",
+    true, BenchmarkMidiBuffering},
+  {"midi-routing-benchmark", "Routing 2000 controls to 4 devices, as MIDI 1.0 and down-converted MIDI 2.0", true,
+    BenchmarkMidiRouting},
+  {"midi-jitter-benchmark", "Jitter of a gesture with paint stalls, sent right away and at a constant latency", true,
+    BenchmarkMidiJitter},
+};
+
+const size_t gNumMidiBenchmarks = sizeof(gMidiBenchmarks) / sizeof(gMidiBenchmarks[0]);
+
+
+bool BenchmarkMidiResync(const SelfCheckOptions&, std::string* pReport) {
+  std::vector<CMidiRouter::Target> builtInTargets;
+  for(const auto& control: BuiltInLayout())
+    builtInTargets.push_back({control.device, control.channel, control.controller, control.resolution});
+
+  struct Case {
+    const char* pLabel;
+    std::vector<CMidiRouter::Target> targets;
+    size_t numDevices;
+  };
+  const Case cases[] = {
+    {"The built-in layout", builtInTargets, 1},
+    {"2000 controls on 4 devices", ManyTargets(sNumManyControls, sNumManyDevices), sNumManyDevices},
+  };
+
+  auto success = true;
+  for(const auto& testCase: cases) {
+    CBenchmarkTimes streamTimes, shortMessageTimes;
+    ResyncResult stream, shortMessages;
+    for(int run = 0; run < sNumRuns; ++run) {
+      stream = ResyncAsStreams(testCase.targets, testCase.numDevices, &streamTimes);
+      shortMessages = ResyncAsShortMessages(testCase.targets, testCase.numDevices, &shortMessageTimes);
+    }
+
+    char buf[96];
+    snprintf(buf, sizeof(buf), "%s, %u values:\n", testCase.pLabel, unsigned(testCase.targets.size()));
+    *pReport += buf;
+    *pReport += ResyncSummary("As a stream per device", stream, streamTimes);
+    *pReport += ResyncSummary("As short messages", shortMessages, shortMessageTimes);
+    // Running status can only leave out bytes
+    success &= stream.numBytes <= shortMessages.numBytes && stream.numCalls <= testCase.numDevices;
+  }
+
+  if(!success)
+    *pReport += "A stream took more bytes or calls than short messages\n";
+  return success;
+}
+
+
+bool BenchmarkMidiBuffering(const SelfCheckOptions&, std::string* pReport) {
+  auto success = true;
+  for(const auto numFingers: sNumFingers) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "Drag with %u fingers at %d Hz:\n", unsigned(numFingers), sTouchFramesPerSecond);
+    *pReport += buf;
+    MidiOutput::Stats unbuffered, buffered;
+    *pReport += DragSummary("Short messages", numFingers, 0, &unbuffered);
+    *pReport += DragSummary("Buffered with running status", numFingers, sFlushThresholdBytes, &buffered);
+    // Both send every value, and buffers take at most a call per frame
+    success &= buffered.numMessages == unbuffered.numMessages && buffered.numBytes <= unbuffered.numBytes
+      && buffered.numCalls <= unsigned(sNumDragFrames);
+  }
+
+  if(!success)
+    *pReport += "Buffering took more calls or bytes, or lost values\n";
+  return success;
+}
+
+
+bool BenchmarkMidiRouting(const SelfCheckOptions&, std::string* pReport) {
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%u controls on %u devices, %d rounds in which all of them change:\n",
+    unsigned(sNumManyControls), unsigned(sNumManyDevices), sNumRoutingRounds);
+  *pReport += buf;
+
+  MidiOutput::Stats midi1, midi2;
+  *pReport += RoutingSummary("MIDI 1.0", MidiOutput::Protocol::Midi1, &midi1);
+  *pReport += RoutingSummary("MIDI 2.0, down-converted", MidiOutput::Protocol::Midi2, &midi2);
+
+  // Every value reaches a device, and down-converting gives the same bytes
+  const auto numValues = unsigned(sNumManyControls * sNumRoutingRounds);
+  const auto success = midi1.numValues == numValues && midi1.numMessages == numValues
+    && midi2.numMessages == numValues && midi2.numBytes == midi1.numBytes;
+  if(!success)
+    *pReport += "Values were lost, or down-converting changed the bytes\n";
+  return success;
+}
+
+
+bool BenchmarkMidiJitter(const SelfCheckOptions&, std::string* pReport) {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%d inputs, %d ms apart, handled after stalls of up to 12 ms:\n", sNumGestureInputs,
+    int(sInputInterval.count()));
+  *pReport += buf;
+
+  // Sleeps take the system clock's 15.6 ms otherwise
+  ::timeBeginPeriod(1);
+  size_t numSentRightAway, numSentWithLatency;
+  *pReport += JitterSummary("Right away", 0, &numSentRightAway);
+  snprintf(buf, sizeof(buf), "With %u ms latency", sLatencyMicroseconds / 1000);
+  *pReport += JitterSummary(buf, sLatencyMicroseconds, &numSentWithLatency);
+  ::timeEndPeriod(1);
+
+  const auto success = numSentRightAway == size_t(sNumGestureInputs)
+    && numSentWithLatency == size_t(sNumGestureInputs);
+  if(!success)
+    *pReport += "Not all values were sent\n";
+  return success;
+}
@@ -0,0 +1,36 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "SelfCheck.h"
+
+#include <string>
+
+// Benchmarks of the MIDI output. They send to simulated devices that take
+// bytes at the rate of a MIDI cable, so the numbers don't depend on drivers
+// or hardware. Like the entries of SelfCheck.h, but they need Windows.
+extern const SelfCheck gMidiBenchmarks[];
+extern const size_t gNumMidiBenchmarks;
+
+// Resyncs the built-in layout to a device and 2000 controls to 4 devices,
+// like CComTouchDriver::ResyncMidi, as a stream with running status per
+// device. Reports how long that takes on the wire and in the app, next to
+// sending each value as a short message of its own.
+bool BenchmarkMidiResync(const SelfCheckOptions& options, std::string* pReport);
+
+// Drags 1, 5 and 10 controls for two seconds, with 120 touch frames a
+// second, and sends the values of each frame on their own and buffered with
+// running status. Reports the calls and bytes per second of each.
+bool BenchmarkMidiBuffering(const SelfCheckOptions& options, std::string* pReport);
+
+// Routes 2000 controls to 4 devices, 500 controllers each on 4 channels,
+// and changes all of them in each round. Reports how many values per second
+// that takes to route, encode and hand to the devices, as MIDI 1.0 and as
+// MIDI 2.0 that's down-converted for them.
+bool BenchmarkMidiRouting(const SelfCheckOptions& options, std::string* pReport);
+
+// Plays a gesture through a CMidiScheduler while the window thread stalls
+// for up to 12 ms before it gets to an input, once sending right away and
+// once at a latency of 20 ms. Reports how much the delay from input to
+// device varies.
+bool BenchmarkMidiJitter(const SelfCheckOptions& options, std::string* pReport);
@@ -0,0 +1,79 @@
+// Copyright (c) v1ne
+
+#include "MidiEncoder.h"
+
+// Controllers that MIDI assigns to NRPNs
+static constexpr uint8_t sDataEntryMsb = 6;
+static constexpr uint8_t sDataEntryLsb = 38;
+static constexpr uint8_t sNrpnLsb = 98;
+static constexpr uint8_t sNrpnMsb = 99;
+// The LSB of controller n is on n+32
+static constexpr uint8_t sLsbOffset = 32;
+
+
+size_t CMidiEncoder::MaxSize(MidiResolution resolution) {
+  switch(resolution) {
+  case MidiResolution::Cc7Bit: return 3;
+  case MidiResolution::Cc14Bit: return 6;
+  case MidiResolution::Nrpn14Bit: return 12;
+  }
+  return 0;
+}
+
+
+void CMidiEncoder::ControllerChange(uint8_t channel, uint8_t controller, uint8_t value) {
+  const auto status = uint8_t(0b1011 << 4 | (channel & 0b1111));
+  if(status != mRunningStatus) {
+    mBytes.push_back(status);
+    mRunningStatus = status;
+  }
+  mBytes.push_back(controller & 0b0111'1111);
+  mBytes.push_back(value & 0b0111'1111);
+  ++mNumMessages;
+}
+
+
+void CMidiEncoder::Controller(uint8_t channel, uint8_t controller, MidiResolution resolution, uint16_t value,
+  uint16_t previousValue)
+{
+  if(resolution == MidiResolution::Cc7Bit) {
+    ControllerChange(channel, controller, uint8_t(value));
+    return;
+  }
+
+  const auto msb = uint8_t(value >> 7 & 0x7F);
+  const auto lsb = uint8_t(value & 0x7F);
+  // Receivers keep the MSB and combine it with each new LSB
+  const auto isMsbSent = previousValue == sNoValue || (previousValue >> 7 & 0x7F) != msb;
+
+  if(resolution == MidiResolution::Cc14Bit) {
+    if(isMsbSent)
+      ControllerChange(channel, controller, msb);
+    ControllerChange(channel, uint8_t(controller + sLsbOffset), lsb);
+    return;
+  }
+
+  auto& selectedParameter = mSelectedParameter[channel & 0b1111];
+  const auto isSelected = selectedParameter == controller;
+  if(!isSelected) {
+    ControllerChange(channel, sNrpnMsb, 0);
+    ControllerChange(channel, sNrpnLsb, controller);
+    selectedParameter = controller;
+  }
+  if(isMsbSent || !isSelected)
+    ControllerChange(channel, sDataEntryMsb, msb);
+  ControllerChange(channel, sDataEntryLsb, lsb);
+}
+
+
+void CMidiEncoder::ForgetSelectedParameters() {
+  for(auto& parameter: mSelectedParameter)
+    parameter = sNoValue;
+}
+
+
+void CMidiEncoder::Clear() {
+  mBytes.clear();
+  mNumMessages = 0;
+  mRunningStatus = 0;
+}
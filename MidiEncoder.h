@@ -0,0 +1,64 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a controller's value is sent
+enum class MidiResolution : uint8_t {
+  // One controller change
+  Cc7Bit,
+  // The MSB on controller n (0-31) and the LSB on controller n+32
+  Cc14Bit,
+  // NRPN n: the parameter number, then data entry MSB and LSB
+  Nrpn14Bit,
+};
+
+// Encodes MIDI messages into a byte stream. Channel messages leave out the
+// status byte if it's the same as the one before (running status), which
+// saves a third of the bytes for runs of controller changes on one channel.
+class CMidiEncoder {
+public:
+  // MIDI sends 31250 bits per second, 10 bits per byte
+  static constexpr unsigned int sWireMicrosecondsPerByte = 320;
+  // Stands for a value that the receiver doesn't know
+  static constexpr uint16_t sNoValue = 0xFFFF;
+
+  CMidiEncoder() { ForgetSelectedParameters(); }
+
+  static uint16_t MaxValue(MidiResolution resolution) {
+    return resolution == MidiResolution::Cc7Bit ? 127 : 16383;
+  }
+  // Bytes that a value may take at most, without running status
+  static size_t MaxSize(MidiResolution resolution);
+
+  void ControllerChange(uint8_t channel, uint8_t controller, uint8_t value);
+  // value has the bits of the resolution. If previousValue is what the
+  // receiver has, the MSB is only sent if it changed, and an NRPN is only
+  // selected if it isn't already.
+  void Controller(uint8_t channel, uint8_t controller, MidiResolution resolution, uint16_t value,
+    uint16_t previousValue);
+
+  // The receiver only knows the running status of this stream. Whatever is
+  // sent in between, e.g. a short message, has to reset it.
+  void ResetRunningStatus() { mRunningStatus = 0; }
+  // The receiver may have seen other NRPNs selected, e.g. by another stream
+  void ForgetSelectedParameters();
+  // Also resets the running status, but not the selected NRPNs
+  void Clear();
+
+  const uint8_t* Data() const { return mBytes.data(); }
+  size_t Size() const { return mBytes.size(); }
+  size_t NumMessages() const { return mNumMessages; }
+  // How many bytes went into the stream without running status
+  size_t UncompressedSize() const { return mNumMessages * 3; }
+
+private:
+  std::vector<uint8_t> mBytes;
+  size_t mNumMessages = 0;
+  uint8_t mRunningStatus = 0;
+  // The NRPN that data entry goes to, per channel
+  uint16_t mSelectedParameter[16];
+};
@@ -0,0 +1,130 @@
+// Copyright (c) v1ne
+
+#include "MidiEncoderCheck.h"
+
+#include "MidiBackend.h"
+#include "MidiEncoder.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+std::string HexBytes(const uint8_t* pBytes, size_t size) {
+  std::string hex;
+  char buf[4];
+  for(size_t i = 0; i < size; ++i) {
+    snprintf(buf, sizeof(buf), i ? " %02X" : "%02X", pBytes[i]);
+    hex += buf;
+  }
+  return hex;
+}
+
+
+// Reports the bytes of the encoder, and the expected ones if they differ
+bool ExpectBytes(const char* pLabel, const CMidiEncoder& encoder, std::initializer_list<uint8_t> expected,
+  std::string* pReport)
+{
+  const auto isGood = encoder.Size() == expected.size()
+    && std::equal(expected.begin(), expected.end(), encoder.Data());
+  *pReport += pLabel;
+  *pReport += ": " + HexBytes(encoder.Data(), encoder.Size());
+  if(!isGood)
+    *pReport += ", EXPECTED " + HexBytes(expected.begin(), expected.size());
+  *pReport += "\n";
+  return isGood;
+}
+
+}
+
+
+bool CheckMidiEncoder(std::string* pReport) {
+  auto success = true;
+  CMidiEncoder encoder;
+
+  // Controller changes on a channel share the status byte, until another
+  // channel or a reset comes between them
+  encoder.ControllerChange(0, 7, 0x40);
+  encoder.ControllerChange(0, 8, 0x41);
+  encoder.ControllerChange(1, 7, 0x42);
+  encoder.ControllerChange(1, 8, 0x43);
+  encoder.ResetRunningStatus();
+  encoder.ControllerChange(1, 9, 0x44);
+  success &= ExpectBytes("Running status", encoder,
+    {0xB0, 7, 0x40, 8, 0x41, 0xB1, 7, 0x42, 8, 0x43, 0xB1, 9, 0x44}, pReport);
+  success &= encoder.NumMessages() == 5 && encoder.UncompressedSize() == 15;
+
+  // Each buffer starts with a status byte
+  encoder.Clear();
+  encoder.ControllerChange(1, 10, 0x45);
+  success &= ExpectBytes("Running status after clearing", encoder, {0xB1, 10, 0x45}, pReport);
+
+  // A 14-bit controller in full, then with the same MSB, then with another one
+  encoder.Clear();
+  encoder.Controller(2, 3, MidiResolution::Cc14Bit, 0x1234, CMidiEncoder::sNoValue);
+  encoder.Controller(2, 3, MidiResolution::Cc14Bit, 0x1235, 0x1234);
+  encoder.Controller(2, 3, MidiResolution::Cc14Bit, 0x12B5, 0x1235);
+  success &= ExpectBytes("14-bit controller", encoder,
+    {0xB2, 3, 0x24, 35, 0x34, 35, 0x35, 3, 0x25, 35, 0x35}, pReport);
+
+  // An NRPN is selected once. Another one is selected and sent in full, also
+  // if its MSB is the same.
+  encoder.Clear();
+  encoder.Controller(0, 5, MidiResolution::Nrpn14Bit, 0x0101, CMidiEncoder::sNoValue);
+  encoder.Controller(0, 5, MidiResolution::Nrpn14Bit, 0x0102, 0x0101);
+  encoder.Controller(0, 6, MidiResolution::Nrpn14Bit, 0x0103, 0x0102);
+  success &= ExpectBytes("NRPN", encoder,
+    {0xB0, 99, 0, 98, 5, 6, 2, 38, 1, 38, 2, 99, 0, 98, 6, 6, 2, 38, 3}, pReport);
+
+  // Once the receiver may have seen another NRPN, it's selected again
+  encoder.Clear();
+  encoder.ForgetSelectedParameters();
+  encoder.Controller(0, 6, MidiResolution::Nrpn14Bit, 0x0104, 0x0103);
+  success &= ExpectBytes("NRPN after forgetting it", encoder, {0xB0, 99, 0, 98, 6, 6, 2, 38, 4}, pReport);
+
+  // Values of all resolutions on several channels split into the messages
+  // that went in, each with its status byte, and none takes more than its
+  // MaxSize
+  {
+    encoder.Clear();
+    encoder.ForgetSelectedParameters();
+    std::vector<uint32_t> expected;
+    CMidiEncoder single;
+    auto isWithinMaxSize = true;
+    for(int i = 0; i < 60; ++i) {
+      const auto resolution = MidiResolution(i % 3);
+      const auto channel = uint8_t(i / 20);
+      const auto controller = uint8_t(i % 3 == 1 ? i % 32 : i);
+      const auto value = uint16_t(i * 1237 % (CMidiEncoder::MaxValue(resolution) + 1));
+      const auto previousValue = i % 2 ? uint16_t(value ^ 1) : CMidiEncoder::sNoValue;
+      const auto size = encoder.Size();
+      encoder.Controller(channel, controller, resolution, value, previousValue);
+      isWithinMaxSize &= encoder.Size() - size <= CMidiEncoder::MaxSize(resolution);
+
+      // The same messages from an encoder that starts each value with the
+      // status byte. All messages of a value are on its channel.
+      single.Clear();
+      single.Controller(channel, controller, resolution, value, previousValue);
+      const auto* pBytes = single.Data();
+      for(size_t byte = 1; byte + 1 < single.Size(); byte += 2)
+        expected.push_back(pBytes[0] | uint32_t(pBytes[byte]) << 8 | uint32_t(pBytes[byte + 1]) << 16);
+    }
+
+    std::vector<uint32_t> messages;
+    ForEachShortMessage(encoder.Data(), encoder.Size(), [&](uint32_t message) {
+      messages.push_back(message);
+      return true;
+    });
+    const auto isGood = messages == expected && isWithinMaxSize && messages.size() == encoder.NumMessages();
+    char buf[160];
+    snprintf(buf, sizeof(buf), "Short messages: %u from %u bytes, %s, %s\n", unsigned(messages.size()),
+      unsigned(encoder.Size()), messages == expected ? "as encoded" : "NOT as encoded",
+      isWithinMaxSize ? "within MaxSize" : "NOT within MaxSize");
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  return success;
+}
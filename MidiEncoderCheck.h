@@ -0,0 +1,15 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Encodes controller values with a CMidiEncoder and compares the bytes with
+// what MIDI prescribes: runs of messages on a channel leave out the status
+// byte, 14-bit controllers and NRPNs only send the MSB if it changed, and an
+// NRPN is only selected again if another one was. The stream also has to
+// split into the same short messages that ForEachShortMessage hands to
+// drivers that don't take byte streams.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckMidiEncoder(std::string* pReport);
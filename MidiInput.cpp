@@ -0,0 +1,206 @@
+// Copyright (c) v1ne
+
+#include "MidiInput.h"
+
+#include "MidiRouter.h"
+
+// Controllers that MIDI assigns to parameter numbers
+static constexpr uint8_t sDataEntryMsb = 6;
+static constexpr uint8_t sDataEntryLsb = 38;
+static constexpr uint8_t sNrpnLsb = 98;
+static constexpr uint8_t sNrpnMsb = 99;
+static constexpr uint8_t sRpnLsb = 100;
+static constexpr uint8_t sRpnMsb = 101;
+// The LSB of controller n is on n+32
+static constexpr uint8_t sLsbOffset = 32;
+
+
+CMidiInput::CMidiInput(const CMidiRouter& router, size_t device, size_t numControls)
+  : mRouter(router)
+  , mDevice(device)
+  , mMailbox(numControls)
+{}
+
+
+CMidiInput::~CMidiInput() {
+  Close();
+}
+
+
+bool CMidiInput::Open(unsigned int numDevice, HWND hNotify, UINT notifyMessage) {
+  Close();
+  if(numDevice >= ::midiInGetNumDevs())
+    return false;
+
+  MIDIINCAPSW caps;
+  if(::midiInGetDevCapsW(numDevice, &caps, sizeof(MIDIINCAPSW)) == MMSYSERR_NOERROR)
+    mDeviceName = std::wstring(caps.szPname);
+
+  mhNotify = hNotify;
+  mNotifyMessage = notifyMessage;
+  mIsClosing = false;
+  mReturnedBuffers = 0;
+  HMIDIIN hMidiIn;
+  if(::midiInOpen(&hMidiIn, numDevice, DWORD_PTR(&CMidiInput::Callback), DWORD_PTR(this), CALLBACK_FUNCTION)
+    != MMSYSERR_NOERROR)
+  {
+    return false;
+  }
+  mhMidiIn = hMidiIn;
+
+  // The driver fills these with SysEx, and hands them back one by one
+  for(size_t i = 0; i < sNumSysExBuffers; ++i) {
+    auto& header = mSysExHeaders[i];
+    header = {};
+    header.lpData = reinterpret_cast<LPSTR>(mSysExBuffers[i]);
+    header.dwBufferLength = DWORD(sSysExBufferSize);
+    if(::midiInPrepareHeader(mhMidiIn, &header, sizeof(MIDIHDR)) != MMSYSERR_NOERROR
+      || ::midiInAddBuffer(mhMidiIn, &header, sizeof(MIDIHDR)) != MMSYSERR_NOERROR)
+    {
+      Close();
+      return false;
+    }
+  }
+
+  if(::midiInStart(mhMidiIn) != MMSYSERR_NOERROR) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+
+void CMidiInput::Close() {
+  if(!mhMidiIn)
+    return;
+
+  // Resetting hands back the SysEx buffers, which mustn't be added again
+  mIsClosing = true;
+  ::midiInStop(mhMidiIn);
+  ::midiInReset(mhMidiIn);
+  for(auto& header: mSysExHeaders)
+    if(header.dwFlags & MHDR_PREPARED)
+      ::midiInUnprepareHeader(mhMidiIn, &header, sizeof(MIDIHDR));
+  ::midiInClose(mhMidiIn);
+  mhMidiIn = nullptr;
+}
+
+
+void CALLBACK CMidiInput::Callback(HMIDIIN hMidiIn, UINT message, DWORD_PTR instance, DWORD_PTR param1,
+  DWORD_PTR param2)
+{
+  UNREFERENCED_PARAMETER(hMidiIn);
+  UNREFERENCED_PARAMETER(param2);
+  auto* pThis = reinterpret_cast<CMidiInput*>(instance);
+
+  if(message == MIM_DATA) {
+    // A whole message, with its status byte
+    const uint8_t bytes[3] = {uint8_t(param1), uint8_t(param1 >> 8), uint8_t(param1 >> 16)};
+    const auto numDataBytes = CMidiParser::NumDataBytes(bytes[0]);
+    pThis->Receive(bytes, numDataBytes > 0 ? size_t(1 + numDataBytes) : 1);
+  } else if(message == MIM_LONGDATA) {
+    auto* pHeader = reinterpret_cast<MIDIHDR*>(param1);
+    pThis->Receive(reinterpret_cast<const uint8_t*>(pHeader->lpData), pHeader->dwBytesRecorded);
+    if(pThis->mIsClosing)
+      return;
+    const auto buffer = size_t(pHeader - pThis->mSysExHeaders);
+    pThis->mReturnedBuffers.fetch_or(1u << buffer, std::memory_order_release);
+    if(pThis->mhNotify)
+      ::PostMessageW(pThis->mhNotify, pThis->mNotifyMessage, WPARAM(pThis->mDevice), 0);
+  }
+}
+
+
+void CMidiInput::AddReturnedBuffers() {
+  if(!mhMidiIn)
+    return;
+
+  const auto returnedBuffers = mReturnedBuffers.exchange(0, std::memory_order_acquire);
+  for(size_t i = 0; i < sNumSysExBuffers; ++i)
+    if(returnedBuffers & 1u << i)
+      ::midiInAddBuffer(mhMidiIn, &mSysExHeaders[i], sizeof(MIDIHDR));
+}
+
+
+void CMidiInput::Receive(const uint8_t* pBytes, size_t size) {
+  mParser.Parse(pBytes, size, [this](const MidiMessage& message) { OnMessage(message); });
+}
+
+
+void CMidiInput::OnMessage(const MidiMessage& message) {
+  mNumMessages.fetch_add(1, std::memory_order_relaxed);
+  if(message.status == 0xF0)
+    mNumSysEx.fetch_add(1, std::memory_order_relaxed);
+  else if((message.status & 0xF0) == 0xB0)
+    OnControlChange(message.status & 0x0F, message.data[0], message.data[1]);
+}
+
+
+void CMidiInput::OnControlChange(uint8_t channel, uint8_t controller, uint8_t value) {
+  auto& state = mChannels[channel];
+  size_t control;
+  switch(controller) {
+  case sNrpnMsb:
+    state.isNrpnSelected = true;
+    state.parameterMsb = value;
+    return;
+  case sNrpnLsb:
+    state.isNrpnSelected = true;
+    state.parameterLsb = value;
+    return;
+  case sRpnMsb:
+  case sRpnLsb:
+    state.isNrpnSelected = false;
+    return;
+  case sDataEntryMsb:
+  case sDataEntryLsb:
+    // Layouts only map NRPNs below 128
+    if(state.isNrpnSelected && state.parameterMsb == 0
+      && mRouter.FindControl(mDevice, channel, state.parameterLsb, true, &control))
+    {
+      if(controller == sDataEntryMsb) {
+        // The LSB starts over with a new MSB
+        state.dataEntryMsb = value;
+        Deliver(control, uint16_t(value << 7));
+      } else
+        Deliver(control, uint16_t(state.dataEntryMsb << 7 | value));
+      return;
+    }
+    break;
+  }
+
+  if(controller < sLsbOffset && mRouter.FindControl(mDevice, channel, controller, false, &control)
+    && mRouter.TargetOf(control).resolution == MidiResolution::Cc14Bit)
+  {
+    state.controllerMsbs[controller] = value;
+    Deliver(control, uint16_t(value << 7));
+  } else if(controller >= sLsbOffset && controller < 2 * sLsbOffset
+    && mRouter.FindControl(mDevice, channel, uint8_t(controller - sLsbOffset), false, &control)
+    && mRouter.TargetOf(control).resolution == MidiResolution::Cc14Bit)
+  {
+    Deliver(control, uint16_t(state.controllerMsbs[controller - sLsbOffset] << 7 | value));
+  } else if(mRouter.FindControl(mDevice, channel, controller, false, &control)
+    && mRouter.TargetOf(control).resolution == MidiResolution::Cc7Bit)
+  {
+    Deliver(control, value);
+  }
+}
+
+
+void CMidiInput::Deliver(size_t control, uint16_t value) {
+  mNumValues.fetch_add(1, std::memory_order_relaxed);
+  if(mMailbox.Post(uint32_t(control), value) && mhNotify)
+    ::PostMessageW(mhNotify, mNotifyMessage, WPARAM(mDevice), 0);
+}
+
+
+CMidiInput::Stats CMidiInput::TakeStats() {
+  Stats stats;
+  stats.numMessages = mNumMessages.exchange(0);
+  stats.numSysEx = mNumSysEx.exchange(0);
+  stats.numValues = mNumValues.exchange(0);
+  const auto numCoalesced = mMailbox.NumCoalesced();
+  stats.numCoalesced = numCoalesced - mNumCoalescedReported;
+  mNumCoalescedReported = numCoalesced;
+  return stats;
+}
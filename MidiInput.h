@@ -0,0 +1,106 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "ControlMailbox.h"
+#include "MidiParser.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class CMidiRouter;
+
+// Takes what a device sends back, e.g. a DAW that plays back automation,
+// for the controls that are mapped to it. Controller changes, 14-bit pairs
+// and NRPNs are decoded on WinMM's thread and posted to a mailbox. The
+// window is sent a message when there's something new in it, and takes the
+// values on its own thread. SysEx buffers that the driver hands back are
+// given to it again on the window thread, too, since WinMM mustn't be called
+// from its callback.
+class CMidiInput {
+public:
+  struct Stats {
+    unsigned int numMessages = 0;
+    unsigned int numSysEx = 0;
+    // Values of mapped controllers
+    unsigned int numValues = 0;
+    // Values that were replaced by a newer one before they were taken
+    unsigned int numCoalesced = 0;
+  };
+
+  // The input of device `device` of the router, i.e. what its targets
+  // refer to
+  CMidiInput(const CMidiRouter& router, size_t device, size_t numControls);
+  ~CMidiInput();
+
+  // hNotify is sent notifyMessage, with the device as wParam, when values
+  // come in while the mailbox is empty, or when the driver hands back a
+  // SysEx buffer
+  bool Open(unsigned int numDevice, HWND hNotify, UINT notifyMessage);
+  void Close();
+  bool IsOpen() const { return mhMidiIn != nullptr; }
+  const std::wstring& DeviceName() const { return mDeviceName; }
+
+  // Window thread. Returns false once there are no more values. The value
+  // has the bits of the resolution of the control's target.
+  bool Take(uint32_t* pControl, uint16_t* pValue) { return mMailbox.Take(pControl, pValue); }
+
+  // Window thread. Gives the SysEx buffers that the driver handed back to it
+  // again.
+  void AddReturnedBuffers();
+
+  // WinMM's thread. Parses the bytes that the device sent.
+  void Receive(const uint8_t* pBytes, size_t size);
+
+  // Returns the stats since the last call
+  Stats TakeStats();
+
+private:
+  // The header and the buffer of each SysEx buffer in use by the driver
+  static constexpr size_t sNumSysExBuffers = 4;
+  static constexpr size_t sSysExBufferSize = 1024;
+  static_assert(sNumSysExBuffers <= 32, "Returned buffers are kept as bits");
+
+  struct ChannelState {
+    // The selected parameter, if it's an NRPN
+    bool isNrpnSelected = false;
+    uint8_t parameterMsb = 0;
+    uint8_t parameterLsb = 0;
+    uint8_t dataEntryMsb = 0;
+    // Of the 14-bit controllers
+    uint8_t controllerMsbs[32] = {};
+  };
+
+  static void CALLBACK Callback(HMIDIIN hMidiIn, UINT message, DWORD_PTR instance, DWORD_PTR param1,
+    DWORD_PTR param2);
+  void OnMessage(const MidiMessage& message);
+  void OnControlChange(uint8_t channel, uint8_t controller, uint8_t value);
+  void Deliver(size_t control, uint16_t value);
+
+  const CMidiRouter& mRouter;
+  size_t mDevice;
+  HMIDIIN mhMidiIn = nullptr;
+  std::wstring mDeviceName;
+  HWND mhNotify = nullptr;
+  UINT mNotifyMessage = 0;
+  std::atomic<bool> mIsClosing{false};
+  MIDIHDR mSysExHeaders[sNumSysExBuffers];
+  // A bit per SysEx buffer that the driver handed back
+  std::atomic<uint32_t> mReturnedBuffers{0};
+  uint8_t mSysExBuffers[sNumSysExBuffers][sSysExBufferSize];
+
+  // Used on WinMM's thread only
+  CMidiParser mParser;
+  ChannelState mChannels[16];
+
+  CControlMailbox mMailbox;
+
+  std::atomic<unsigned int> mNumMessages{0};
+  std::atomic<unsigned int> mNumSysEx{0};
+  std::atomic<unsigned int> mNumValues{0};
+  unsigned int mNumCoalescedReported = 0;
+};
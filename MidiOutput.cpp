@@ -1,48 +1,141 @@
 #include "MidiOutput.h"
 
+#include "WinMmMidiBackend.h"
+
 #include <Windows.h>
-#include <sstream>
-#include <iostream>
+
+// Not all drivers take channel messages in a buffer
+static bool SendAsShortMessages(CMidiBackend& backend, const CMidiEncoder& encoder) {
+  return ForEachShortMessage(encoder.Data(), encoder.Size(),
+    [&](uint32_t message) { return backend.SendShortMessage(message); });
+}
 
 bool MidiOutput::open(unsigned int numDevice) {
-  const auto numDevices = ::midiOutGetNumDevs();
-  if(numDevice >= numDevices)
+  auto pBackend = std::make_unique<CWinMmMidiBackend>();
+  const auto isOpen = pBackend->Open(numDevice);
+  mDeviceName = pBackend->DeviceName();
+  if(!isOpen)
     return false;
 
-  MIDIOUTCAPSW caps;
-  if(::midiOutGetDevCapsW(numDevice, &caps, sizeof(MIDIOUTCAPSW)) == MMSYSERR_NOERROR)
-    mDeviceName = std::wstring(caps.szPname);
+  return open(std::unique_ptr<CMidiBackend>(std::move(pBackend)));
+}
 
-  MMRESULT result;
-  if((result = ::midiOutOpen((HMIDIOUT*)&mhMidiOut, numDevice, NULL, NULL, CALLBACK_NULL)) != MMSYSERR_NOERROR)
+bool MidiOutput::open(std::unique_ptr<CMidiBackend> pBackend) {
+  if(!pBackend)
     return false;
 
+  mDeviceName = pBackend->DeviceName();
+  mpBackend = std::move(pBackend);
   return true;
 }
 
 MidiOutput::~MidiOutput() {
-  if(mhMidiOut) {
-    auto ret = ::midiOutReset(HMIDIOUT(mhMidiOut));
-    auto ret2 = ::midiOutClose(HMIDIOUT(mhMidiOut));
+  flush();
+}
+
+void MidiOutput::setProtocol(Protocol protocol) {
+  flush();
+  mProtocol = protocol;
+}
+
+void MidiOutput::setBuffering(size_t flushThresholdBytes) {
+  flush();
+  mFlushThresholdBytes = flushThresholdBytes;
+}
+
+bool MidiOutput::flush() {
+  if(mPendingValues.empty())
+    return true;
+  if(mProtocol == Protocol::Midi2)
+    return flushAsPackets();
+
+  mEncoder.Clear();
+  for(const auto& pending: mPendingValues)
+    mEncoder.Controller(pending.channel, pending.controller, pending.resolution, pending.value, pending.previousValue);
+  mPendingValues.clear();
+  mPendingSize = 0;
+
+  return sendEncoded(mEncoder, mFlushThresholdBytes != 0);
+}
+
+bool MidiOutput::flushAsPackets() {
+  mUmpEncoder.Clear();
+  mPreviousValues.clear();
+  for(const auto& pending: mPendingValues) {
+    const auto numBits = pending.resolution == MidiResolution::Cc7Bit ? 7 : 14;
+    const auto value = CUmpEncoder::UpscaleValue(pending.value, numBits);
+    if(pending.resolution == MidiResolution::Nrpn14Bit)
+      mUmpEncoder.AssignableController(0, pending.channel, 0, pending.controller, value);
+    else
+      mUmpEncoder.ControlChange(0, pending.channel, pending.controller, value);
+    // Keeps the resolution when down-converting, also if the mapping changed
+    if(pending.resolution != MidiResolution::Nrpn14Bit)
+      mDownConverter.SetFineController(pending.channel, pending.controller,
+        pending.resolution == MidiResolution::Cc14Bit);
+    mPreviousValues.push_back(pending.previousValue);
+  }
+  mPendingValues.clear();
+  mPendingSize = 0;
 
-    if(ret != MMSYSERR_NOERROR || ret2 != MMSYSERR_NOERROR)
-      ::DebugBreak();
+  if(mpBackend && mpBackend->IsUmpCapable()) {
+    const auto success = mpBackend->SendPackets(mUmpEncoder.Data(), mUmpEncoder.NumWords());
+    ++mStats.numCalls;
+    mStats.numMessages += unsigned(mUmpEncoder.NumPackets());
+    mStats.numBytes += unsigned(mUmpEncoder.NumWords() * sizeof(uint32_t));
+    mStats.numBytesWithoutRunningStatus += unsigned(mUmpEncoder.NumWords() * sizeof(uint32_t));
+    return success;
   }
+
+  mEncoder.Clear();
+  mDownConverter.Translate(mUmpEncoder.Data(), mUmpEncoder.NumWords(), mPreviousValues.data(), &mEncoder);
+  return sendEncoded(mEncoder, mFlushThresholdBytes != 0);
 }
 
-bool MidiOutput::sendControllerChange(uint8_t controller, uint8_t value) {
-  const uint8_t channel = 0;
+bool MidiOutput::sendEncoded(const CMidiEncoder& encoder, bool isBuffered) {
+  auto success = false;
+  if(mpBackend && isBuffered) {
+    success = mpBackend->SendBytes(encoder.Data(), encoder.Size());
+    ++mStats.numCalls;
+    if(success)
+      mStats.numBytes += unsigned(encoder.Size());
+  }
+  if(!success && mpBackend) {
+    // Only this flush, the next one tries a buffer again
+    if(isBuffered)
+      ++mStats.numRefusedBuffers;
+    success = SendAsShortMessages(*mpBackend, encoder);
+    mStats.numCalls += unsigned(encoder.NumMessages());
+    mStats.numBytes += unsigned(encoder.UncompressedSize());
+  }
+  mStats.numMessages += unsigned(encoder.NumMessages());
+  mStats.numBytesWithoutRunningStatus += unsigned(encoder.UncompressedSize());
+  return success;
+}
+
+bool MidiOutput::sendController(uint8_t channel, uint8_t controller, MidiResolution resolution, uint16_t value,
+  uint16_t previousValue)
+{
+  ++mStats.numValues;
+  for(auto& pending: mPendingValues) {
+    if(pending.channel == channel && pending.controller == controller && pending.resolution == resolution) {
+      // The receiver still has the value from before the pending one
+      pending.value = value;
+      ++mStats.numCoalesced;
+      return true;
+    }
+  }
 
-  RawMsg msg;
-  msg.status = 0b1011 << 4 | channel;
-  msg.byte1 = controller & 0b0111'1111;
-  msg.byte2 = value & 0b0111'1111;
+  mPendingValues.push_back({channel, controller, resolution, value, previousValue});
+  mPendingSize += CMidiEncoder::MaxSize(resolution);
+  return mPendingSize < mFlushThresholdBytes || flush();
+}
 
-  return sendRaw(msg);
+bool MidiOutput::sendControllerChange(uint8_t controller, uint8_t value, uint8_t channel) {
+  return sendController(channel, controller, MidiResolution::Cc7Bit, value, CMidiEncoder::sNoValue);
 }
 
 bool MidiOutput::sendRaw(RawMsg msg) {
-  if(!mhMidiOut)
+  if(!mpBackend)
     return false;
 
   static_assert(sizeof(msg) == sizeof(DWORD), "packing mismatch");
@@ -52,9 +145,35 @@ bool MidiOutput::sendRaw(RawMsg msg) {
   if((HIWORD(dwMsg) & 0xFF) != msg.byte2)
     ::DebugBreak();
 
-  MMRESULT result;
-  while ((result = ::midiOutShortMsg(HMIDIOUT(mhMidiOut), dwMsg)) == MIDIERR_NOTREADY)
-    ::Sleep(10);
+  ++mStats.numCalls;
+  mStats.numBytes += 3;
+  return mpBackend->SendShortMessage(dwMsg);
+}
+
+void MidiOutput::beginStream(const CMidiEncoder& encoder) {
+  // The stream may select other NRPNs
+  mEncoder.ForgetSelectedParameters();
+
+  // Counted as a single buffer, even if it goes out as short messages
+  if(encoder.Size()) {
+    ++mStats.numCalls;
+    mStats.numMessages += unsigned(encoder.NumMessages());
+    mStats.numBytes += unsigned(encoder.Size());
+    mStats.numBytesWithoutRunningStatus += unsigned(encoder.UncompressedSize());
+  }
+}
+
+bool MidiOutput::sendStream(const CMidiEncoder& encoder) const {
+  if(!encoder.Size())
+    return true;
+  if(!mpBackend)
+    return false;
+
+  return mpBackend->SendBytes(encoder.Data(), encoder.Size()) || SendAsShortMessages(*mpBackend, encoder);
+}
 
-  return result == MMSYSERR_NOERROR;
+MidiOutput::Stats MidiOutput::takeStats() {
+  auto stats = mStats;
+  mStats = {};
+  return stats;
 }
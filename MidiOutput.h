@@ -1,7 +1,13 @@
 #pragma once
 
+#include "MidiBackend.h"
+#include "MidiEncoder.h"
+#include "UmpEncoder.h"
+
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 class MidiOutput {
 public:
@@ -22,12 +28,86 @@ public:
   };
   #pragma pack(pop)
 
+  enum class Protocol {
+    Midi1,
+    // Control changes with 32-bit values, in Universal MIDI Packets. Devices
+    // that only take MIDI 1.0 get them down-converted.
+    Midi2,
+  };
+
+  struct Stats {
+    // Values handed to sendController
+    unsigned int numValues = 0;
+    // Values that were replaced by a newer one before they were sent
+    unsigned int numCoalesced = 0;
+    // MIDI 1.0 messages or UMPs
+    unsigned int numMessages = 0;
+    // Calls into the driver
+    unsigned int numCalls = 0;
+    unsigned int numBytes = 0;
+    unsigned int numBytesWithoutRunningStatus = 0;
+    // Buffers that the driver didn't take, which went out as short messages
+    unsigned int numRefusedBuffers = 0;
+  };
+
   bool open(unsigned int numDevice);
-  bool sendControllerChange(uint8_t controller, uint8_t value); // on channel 0
+  // Sends to a device that's already open, e.g. a simulated one
+  bool open(std::unique_ptr<CMidiBackend> pBackend);
+
+  void setProtocol(Protocol protocol);
+
+  // Controller values are collected until flush, and sent with running
+  // status, as a single buffer. If a controller changes again before that,
+  // only its last value is sent. Once flushThresholdBytes may have been
+  // collected, they're flushed right away. 0 sends each value on its own.
+  void setBuffering(size_t flushThresholdBytes);
+  // Sends the collected values. Each buffer starts with a status byte,
+  // since not all drivers keep the running status between buffers.
+  bool flush();
+
+  // value has the bits of the resolution. previousValue is the one sent
+  // before, so that unchanged parts can be left out, or
+  // CMidiEncoder::sNoValue to send all of it.
+  bool sendController(uint8_t channel, uint8_t controller, MidiResolution resolution, uint16_t value,
+    uint16_t previousValue);
+  bool sendControllerChange(uint8_t controller, uint8_t value, uint8_t channel = 0);
   bool sendRaw(RawMsg);
+  // Sends an encoded stream as one buffer, or as short messages if the
+  // driver doesn't take buffers. beginStream goes first, from the thread or
+  // under the lock that the other calls use. sendStream only uses the
+  // device, so it can run without the lock, as long as nothing else is sent
+  // to the device meanwhile.
+  void beginStream(const CMidiEncoder& encoder);
+  bool sendStream(const CMidiEncoder& encoder) const;
+
+  // Returns the stats since the last call
+  Stats takeStats();
 
   std::wstring mDeviceName;
 
 private:
-  void* mhMidiOut = nullptr;
+  struct PendingValue {
+    uint8_t channel;
+    uint8_t controller;
+    MidiResolution resolution;
+    uint16_t value;
+    uint16_t previousValue;
+  };
+
+  bool flushAsPackets();
+  bool sendEncoded(const CMidiEncoder& encoder, bool isBuffered);
+
+  std::unique_ptr<CMidiBackend> mpBackend;
+  Protocol mProtocol = Protocol::Midi1;
+  size_t mFlushThresholdBytes = 0;
+  std::vector<PendingValue> mPendingValues;
+  // How many bytes the pending values may take at most
+  size_t mPendingSize = 0;
+  // Knows which NRPNs the receiver has selected
+  CMidiEncoder mEncoder;
+  CUmpEncoder mUmpEncoder;
+  CUmpDownConverter mDownConverter;
+  // Of the packets in mUmpEncoder, for leaving out what the receiver has
+  std::vector<uint16_t> mPreviousValues;
+  Stats mStats;
 };
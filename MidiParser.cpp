@@ -0,0 +1,112 @@
+// Copyright (c) v1ne
+
+#include "MidiParser.h"
+
+static constexpr uint8_t sSysExStart = 0xF0;
+static constexpr uint8_t sSysExEnd = 0xF7;
+// F8 to FF may come between any two bytes
+static constexpr uint8_t sFirstRealTime = 0xF8;
+
+
+int CMidiParser::NumDataBytes(uint8_t status) {
+  switch(status & 0xF0) {
+  case 0xC0:
+  case 0xD0:
+    return 1;
+  case 0xF0:
+    break;
+  default:
+    return 2;
+  }
+
+  switch(status) {
+  case sSysExStart: return -1;
+  // MIDI time code quarter frame, song select
+  case 0xF1:
+  case 0xF3:
+    return 1;
+  // Song position
+  case 0xF2:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+
+bool CMidiParser::Parse(uint8_t byte, MidiMessage* pMessage) {
+  if(byte >= sFirstRealTime) {
+    // Leaves the message around it alone
+    *pMessage = {byte, {}, nullptr, 0, false};
+    return true;
+  }
+
+  if(byte & 0x80) {
+    const auto isSysExEnded = mIsInSysEx && EndSysEx(pMessage);
+    mNumData = 0;
+    if(byte == sSysExStart) {
+      mIsInSysEx = true;
+      mSysExSize = 0;
+      mIsSysExTruncated = false;
+      mRunningStatus = 0;
+      return isSysExEnded;
+    }
+    if(byte == sSysExEnd) {
+      mRunningStatus = 0;
+      return isSysExEnded;
+    }
+
+    if(NumDataBytes(byte) > 0) {
+      mRunningStatus = byte;
+      return isSysExEnded;
+    }
+
+    // A tune request that ends SysEx instead of F7 is dropped, since the
+    // byte already completed the SysEx message
+    mRunningStatus = 0;
+    if(isSysExEnded)
+      return true;
+    *pMessage = {byte, {}, nullptr, 0, false};
+    return true;
+  }
+
+  if(mIsInSysEx) {
+    if(mSysExSize < sMaxSysExSize)
+      mSysEx[mSysExSize++] = byte;
+    else
+      mIsSysExTruncated = true;
+    return false;
+  }
+
+  if(!mRunningStatus) {
+    ++mNumDroppedBytes;
+    return false;
+  }
+
+  mData[mNumData++] = byte;
+  if(mNumData < NumDataBytes(mRunningStatus))
+    return false;
+
+  *pMessage = {mRunningStatus, {mData[0], mNumData > 1 ? mData[1] : uint8_t(0)}, nullptr, 0, false};
+  mNumData = 0;
+  // System common messages don't have running status
+  if(mRunningStatus >= 0xF0)
+    mRunningStatus = 0;
+  return true;
+}
+
+
+bool CMidiParser::EndSysEx(MidiMessage* pMessage) {
+  mIsInSysEx = false;
+  *pMessage = {sSysExStart, {}, mSysEx, mSysExSize, mIsSysExTruncated};
+  return true;
+}
+
+
+void CMidiParser::Reset() {
+  mRunningStatus = 0;
+  mNumData = 0;
+  mIsInSysEx = false;
+  mSysExSize = 0;
+  mIsSysExTruncated = false;
+}
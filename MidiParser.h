@@ -0,0 +1,61 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// A MIDI 1.0 message, as the parser put it together
+struct MidiMessage {
+  uint8_t status;
+  // As many as the status takes
+  uint8_t data[2];
+  // For SysEx: the bytes between F0 and F7, which are only valid until the
+  // next byte is parsed
+  const uint8_t* pSysEx;
+  size_t sysExSize;
+  // The SysEx message was longer than the parser keeps
+  bool isSysExTruncated;
+};
+
+// Puts MIDI 1.0 messages together from a byte stream, one byte at a time,
+// without allocating. It handles running status, real-time bytes in the
+// middle of other messages, and SysEx, which ends with F7 or with any other
+// status byte. Data bytes that don't belong to a message are dropped.
+class CMidiParser {
+public:
+  // SysEx messages are cut off after this many bytes
+  static constexpr size_t sMaxSysExSize = 256;
+
+  // Data bytes after the status byte, or -1 for SysEx
+  static int NumDataBytes(uint8_t status);
+
+  // Returns whether the byte completed a message
+  bool Parse(uint8_t byte, MidiMessage* pMessage);
+
+  template<typename OnMessage> void Parse(const uint8_t* pBytes, size_t size, OnMessage&& onMessage) {
+    MidiMessage message;
+    for(size_t i = 0; i < size; ++i)
+      if(Parse(pBytes[i], &message))
+        onMessage(message);
+  }
+
+  // Starts over, e.g. after the stream was interrupted
+  void Reset();
+
+  // Data bytes that came without a status byte to go with them
+  size_t NumDroppedBytes() const { return mNumDroppedBytes; }
+
+private:
+  bool EndSysEx(MidiMessage* pMessage);
+
+  // Channel messages keep it for the next one, other messages clear it
+  uint8_t mRunningStatus = 0;
+  uint8_t mData[2] = {};
+  int mNumData = 0;
+  bool mIsInSysEx = false;
+  uint8_t mSysEx[sMaxSysExSize];
+  size_t mSysExSize = 0;
+  bool mIsSysExTruncated = false;
+  size_t mNumDroppedBytes = 0;
+};
@@ -0,0 +1,97 @@
+// Copyright (c) v1ne
+
+#include "MidiParserCheck.h"
+
+#include "MidiParser.h"
+
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+// "B0 07 40", or "F0 [7D 01]" for SysEx, with a "+" if it was cut off
+std::string Describe(const MidiMessage& message) {
+  char buf[8];
+  snprintf(buf, sizeof(buf), "%02X", message.status);
+  std::string text = buf;
+  if(message.status == 0xF0) {
+    text += " [";
+    for(size_t i = 0; i < message.sysExSize && i < 4; ++i) {
+      snprintf(buf, sizeof(buf), i ? " %02X" : "%02X", message.pSysEx[i]);
+      text += buf;
+    }
+    if(message.sysExSize > 4) {
+      snprintf(buf, sizeof(buf), " ..%u", unsigned(message.sysExSize));
+      text += buf;
+    }
+    text += message.isSysExTruncated ? "+]" : "]";
+    return text;
+  }
+
+  // Real-time messages don't have data bytes
+  const auto numDataBytes = message.status >= 0xF8 ? 0 : CMidiParser::NumDataBytes(message.status);
+  for(int i = 0; i < numDataBytes; ++i) {
+    snprintf(buf, sizeof(buf), " %02X", message.data[i]);
+    text += buf;
+  }
+  return text;
+}
+
+
+// Parses the bytes with a new parser and reports the messages, and the
+// expected ones if they differ
+bool ExpectMessages(const char* pLabel, const std::vector<uint8_t>& bytes, const char* pExpected,
+  size_t numExpectedDropped, std::string* pReport)
+{
+  CMidiParser parser;
+  std::string messages;
+  parser.Parse(bytes.data(), bytes.size(), [&](const MidiMessage& message) {
+    if(!messages.empty())
+      messages += ", ";
+    messages += Describe(message);
+  });
+
+  const auto isGood = messages == pExpected && parser.NumDroppedBytes() == numExpectedDropped;
+  char buf[48];
+  snprintf(buf, sizeof(buf), ", %u dropped", unsigned(parser.NumDroppedBytes()));
+  *pReport += pLabel;
+  *pReport += ": " + messages + (parser.NumDroppedBytes() ? buf : "");
+  if(!isGood) {
+    snprintf(buf, sizeof(buf), ", %u dropped", unsigned(numExpectedDropped));
+    *pReport += std::string(", EXPECTED ") + pExpected + (numExpectedDropped ? buf : "");
+  }
+  *pReport += "\n";
+  return isGood;
+}
+
+}
+
+
+bool CheckMidiParser(std::string* pReport) {
+  auto success = true;
+
+  success &= ExpectMessages("Running status", {0xB0, 0x07, 0x40, 0x08, 0x41, 0xC1, 0x05, 0x06},
+    "B0 07 40, B0 08 41, C1 05, C1 06", 0, pReport);
+  success &= ExpectMessages("Real-time bytes in a message", {0xB0, 0x07, 0xF8, 0x40, 0x08, 0xFE, 0x41},
+    "F8, B0 07 40, FE, B0 08 41", 0, pReport);
+  success &= ExpectMessages("Real-time bytes in SysEx", {0xF0, 0x7D, 0x01, 0xF8, 0x02, 0xF7, 0xB0, 0x07, 0x40},
+    "F8, F0 [7D 01 02], B0 07 40", 0, pReport);
+  success &= ExpectMessages("SysEx ended by a status byte", {0xF0, 0x7D, 0x01, 0xB0, 0x07, 0x40},
+    "F0 [7D 01], B0 07 40", 0, pReport);
+  // Running status doesn't carry over SysEx or system common messages
+  success &= ExpectMessages("No running status after SysEx", {0xB0, 0x07, 0x40, 0xF0, 0x7D, 0xF7, 0x08, 0x41},
+    "B0 07 40, F0 [7D]", 2, pReport);
+  success &= ExpectMessages("System common messages", {0xF2, 0x01, 0x02, 0x03, 0xF6, 0xF1, 0x10},
+    "F2 01 02, F6, F1 10", 1, pReport);
+  success &= ExpectMessages("Data bytes without a status", {0x07, 0x40, 0x90, 0x3C, 0x40}, "90 3C 40", 2, pReport);
+
+  {
+    std::vector<uint8_t> bytes = {0xF0};
+    for(int i = 0; i < 300; ++i)
+      bytes.push_back(uint8_t(i & 0x7F));
+    bytes.push_back(0xF7);
+    success &= ExpectMessages("Long SysEx", bytes, "F0 [00 01 02 03 ..256+]", 0, pReport);
+  }
+
+  return success;
+}
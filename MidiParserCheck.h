@@ -0,0 +1,13 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Feeds byte streams that devices may send to a CMidiParser: running status,
+// real-time bytes in the middle of channel messages and SysEx, SysEx that's
+// ended by another status byte or is too long, and data bytes that belong
+// to nothing. The messages have to come out whole, in the order they ended.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckMidiParser(std::string* pReport);
@@ -0,0 +1,113 @@
+// Copyright (c) v1ne
+
+#include "MidiRouter.h"
+
+// Entries of mControlsByTarget for each device: controllers, then NRPNs
+static constexpr size_t sTargetsPerDevice = 2 * 16 * 128;
+
+static size_t TargetIndex(size_t device, uint8_t channel, uint8_t controller, bool isNrpn) {
+  return device * sTargetsPerDevice + (isNrpn ? 16 * 128 : 0) + (channel & 0x0F) * 128 + (controller & 0x7F);
+}
+
+
+bool CMidiRouter::AddOutput(unsigned int numDevice) {
+  mOutputs.push_back(std::make_unique<MidiOutput>());
+  return mOutputs.back()->open(numDevice);
+}
+
+
+bool CMidiRouter::AddOutput(std::unique_ptr<CMidiBackend> pBackend) {
+  mOutputs.push_back(std::make_unique<MidiOutput>());
+  return mOutputs.back()->open(std::move(pBackend));
+}
+
+
+void CMidiRouter::AddTarget(const Target& target) {
+  const auto index = TargetIndex(target.device, target.channel, target.controller,
+    target.resolution == MidiResolution::Nrpn14Bit);
+  if(index >= mControlsByTarget.size())
+    mControlsByTarget.resize((size_t(target.device) + 1) * sTargetsPerDevice, 0);
+  if(!mControlsByTarget[index])
+    mControlsByTarget[index] = uint32_t(mTargets.size() + 1);
+  mTargets.push_back(target);
+}
+
+
+bool CMidiRouter::FindControl(size_t device, uint8_t channel, uint8_t controller, bool isNrpn,
+  size_t* pControl) const
+{
+  const auto index = TargetIndex(device, channel, controller, isNrpn);
+  if(index >= mControlsByTarget.size() || !mControlsByTarget[index])
+    return false;
+
+  *pControl = mControlsByTarget[index] - 1;
+  return true;
+}
+
+
+bool CMidiRouter::AddInput(unsigned int numDevice, HWND hNotify, UINT notifyMessage) {
+  mInputs.push_back(std::make_unique<CMidiInput>(*this, mInputs.size(), mTargets.size()));
+  return mInputs.back()->Open(numDevice, hNotify, notifyMessage);
+}
+
+
+void CMidiRouter::SetBuffering(size_t flushThresholdBytes) {
+  for(auto& pOutput: mOutputs)
+    pOutput->setBuffering(flushThresholdBytes);
+}
+
+
+void CMidiRouter::SetProtocol(MidiOutput::Protocol protocol) {
+  for(auto& pOutput: mOutputs)
+    pOutput->setProtocol(protocol);
+}
+
+
+bool CMidiRouter::Send(size_t control, uint16_t value, uint16_t previousValue) {
+  const auto& target = mTargets[control];
+  if(target.device >= mOutputs.size()) {
+    ++mNumUnrouted;
+    return false;
+  }
+  return mOutputs[target.device]->sendController(target.channel, target.controller, target.resolution, value,
+    previousValue);
+}
+
+
+bool CMidiRouter::Flush() {
+  auto success = true;
+  for(auto& pOutput: mOutputs)
+    success &= pOutput->flush();
+  return success;
+}
+
+
+MidiOutput::Stats CMidiRouter::TakeStats() {
+  MidiOutput::Stats sum;
+  sum.numValues = mNumUnrouted;
+  mNumUnrouted = 0;
+  for(auto& pOutput: mOutputs) {
+    const auto stats = pOutput->takeStats();
+    sum.numValues += stats.numValues;
+    sum.numCoalesced += stats.numCoalesced;
+    sum.numMessages += stats.numMessages;
+    sum.numCalls += stats.numCalls;
+    sum.numBytes += stats.numBytes;
+    sum.numBytesWithoutRunningStatus += stats.numBytesWithoutRunningStatus;
+    sum.numRefusedBuffers += stats.numRefusedBuffers;
+  }
+  return sum;
+}
+
+
+CMidiInput::Stats CMidiRouter::TakeInputStats() {
+  CMidiInput::Stats sum;
+  for(auto& pInput: mInputs) {
+    const auto stats = pInput->TakeStats();
+    sum.numMessages += stats.numMessages;
+    sum.numSysEx += stats.numSysEx;
+    sum.numValues += stats.numValues;
+    sum.numCoalesced += stats.numCoalesced;
+  }
+  return sum;
+}
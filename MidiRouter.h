@@ -0,0 +1,75 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "MidiInput.h"
+#include "MidiOutput.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Sends the values of controls to where they're mapped to: a device, a
+// channel and a controller or NRPN. The targets are a flat array indexed
+// by control. Each device has an output of its own, which collects values
+// until it's flushed.
+//
+// Devices may also have an input, for the values that they send back. Those
+// are looked up in a flat array indexed by target.
+class CMidiRouter {
+public:
+  struct Target {
+    // Index of the output
+    uint8_t device;
+    uint8_t channel;
+    uint8_t controller;
+    MidiResolution resolution;
+  };
+
+  // Opens WinMM device numDevice as the next output. Outputs that can't be
+  // opened still take their index, and drop what they're sent.
+  bool AddOutput(unsigned int numDevice);
+  // Adds a device that's already open, e.g. a simulated one, as the next output
+  bool AddOutput(std::unique_ptr<CMidiBackend> pBackend);
+  size_t NumOutputs() const { return mOutputs.size(); }
+  MidiOutput& Output(size_t device) { return *mOutputs[device]; }
+
+  void SetBuffering(size_t flushThresholdBytes);
+  void SetProtocol(MidiOutput::Protocol protocol);
+
+  // Controls are added in the order of their index
+  void AddTarget(const Target& target);
+  size_t NumTargets() const { return mTargets.size(); }
+  const Target& TargetOf(size_t control) const { return mTargets[control]; }
+  // The control that a controller or an NRPN of a device is mapped to. If
+  // several are, it's the first one.
+  bool FindControl(size_t device, uint8_t channel, uint8_t controller, bool isNrpn, size_t* pControl) const;
+
+  // Opens WinMM input device numDevice as the input of the next device.
+  // Inputs are added after all targets. hNotify is sent notifyMessage when
+  // an input has values for the controls.
+  bool AddInput(unsigned int numDevice, HWND hNotify, UINT notifyMessage);
+  size_t NumInputs() const { return mInputs.size(); }
+  CMidiInput& Input(size_t device) { return *mInputs[device]; }
+
+  // value has the bits of the resolution of the target. previousValue is
+  // the one sent before, or CMidiEncoder::sNoValue.
+  bool Send(size_t control, uint16_t value, uint16_t previousValue);
+  // Flushes all outputs
+  bool Flush();
+
+  // The stats of all outputs, since the last call
+  MidiOutput::Stats TakeStats();
+  // The stats of all inputs, since the last call
+  CMidiInput::Stats TakeInputStats();
+
+private:
+  std::vector<Target> mTargets;
+  // The control plus one, or 0, for each controller and NRPN of each device
+  std::vector<uint32_t> mControlsByTarget;
+  std::vector<std::unique_ptr<CMidiInput>> mInputs;
+  std::vector<std::unique_ptr<MidiOutput>> mOutputs;
+  // Values for outputs that don't exist
+  unsigned int mNumUnrouted = 0;
+};
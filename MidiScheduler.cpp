@@ -0,0 +1,208 @@
+// Copyright (c) v1ne
+
+#include "MidiScheduler.h"
+
+#include "MidiRouter.h"
+
+#include <algorithm>
+
+// Input reaches the window a little after it happened. The quickest message
+// tells the offset between the clocks best. The offset may still grow this
+// much, since the clocks aren't locked to each other.
+static constexpr int64_t sMaxClockDriftPpm = 100;
+static constexpr int64_t sLateMicroseconds = 1000;
+
+
+CMidiScheduler::CMidiScheduler(CMidiRouter* pRouter)
+  : mpRouter(pRouter)
+{
+  LARGE_INTEGER frequency;
+  ::QueryPerformanceFrequency(&frequency);
+  mTicksPerSecond = frequency.QuadPart;
+  mSourceTicks = Now();
+}
+
+
+CMidiScheduler::~CMidiScheduler() {
+  if(!mThread.joinable())
+    return;
+
+  mIsQuitting = true;
+  ::SetEvent(mhWakeUp);
+  mThread.join();
+  ::CloseHandle(mhWakeUp);
+  ::CloseHandle(mhTimer);
+}
+
+
+int64_t CMidiScheduler::Now() {
+  LARGE_INTEGER ticks;
+  ::QueryPerformanceCounter(&ticks);
+  return ticks.QuadPart;
+}
+
+
+void CMidiScheduler::SetLatency(unsigned int microseconds) {
+  if(mThread.joinable() || !microseconds)
+    return;
+
+  // Without a high-resolution timer, the timer ticks with the system clock
+  mhTimer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+  if(!mhTimer)
+    mhTimer = ::CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+  if(!mhTimer)
+    return;
+
+  mLatencyTicks = int64_t(microseconds) * mTicksPerSecond / 1000000;
+  mhWakeUp = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+  mThread = std::thread(&CMidiScheduler::ThreadMain, this);
+}
+
+
+void CMidiScheduler::SetSourceTime(DWORD milliseconds) {
+  const auto now = Now();
+  mTouchMilliseconds = mTouchMilliseconds < 0
+    ? int64_t(milliseconds)
+    : mTouchMilliseconds + int32_t(milliseconds - DWORD(mTouchMilliseconds));
+  const auto touchTicks = mTouchMilliseconds * mTicksPerSecond / 1000;
+
+  const auto offset = now - touchTicks;
+  const auto drift = (now - mClockOffsetTime) * sMaxClockDriftPpm / 1000000;
+  if(!mClockOffsetTime || offset < mClockOffsetTicks + drift) {
+    mClockOffsetTicks = offset;
+    mClockOffsetTime = now;
+  }
+
+  mSourceTicks = (std::min)(touchTicks + mClockOffsetTicks, now);
+}
+
+
+void CMidiScheduler::SetSourceTimeNow() {
+  mSourceTicks = Now();
+}
+
+
+void CMidiScheduler::Send(size_t control, uint16_t value, uint16_t previousValue) {
+  mLastReleaseTicks = (std::max)(mSourceTicks + mLatencyTicks, mLastReleaseTicks);
+  mBatch.push_back({mLastReleaseTicks, mSourceTicks, uint32_t(control), value, previousValue});
+}
+
+
+void CMidiScheduler::Flush() {
+  if(mBatch.empty())
+    return;
+
+  if(!IsScheduling()) {
+    const auto lock = LockRouter();
+    const auto now = Now();
+    for(const auto& pending: mBatch) {
+      mpRouter->Send(pending.control, pending.value, pending.previousValue);
+      CountSent(pending, now);
+    }
+    mpRouter->Flush();
+    mBatch.clear();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    mQueue.insert(mQueue.end(), mBatch.begin(), mBatch.end());
+  }
+  mBatch.clear();
+  ::SetEvent(mhWakeUp);
+}
+
+
+void CMidiScheduler::Discard() {
+  mBatch.clear();
+  std::lock_guard<std::mutex> lock(mQueueMutex);
+  mQueue.clear();
+}
+
+
+void CMidiScheduler::Discard(size_t control) {
+  const auto isOfControl = [control](const PendingValue& pending) { return pending.control == control; };
+  mBatch.erase(std::remove_if(mBatch.begin(), mBatch.end(), isOfControl), mBatch.end());
+  std::lock_guard<std::mutex> lock(mQueueMutex);
+  mQueue.erase(std::remove_if(mQueue.begin(), mQueue.end(), isOfControl), mQueue.end());
+}
+
+
+void CMidiScheduler::ThreadMain() {
+  ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+  const HANDLE handles[] = {mhWakeUp, mhTimer};
+  for(;;) {
+    ::WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+    if(mIsQuitting)
+      return;
+    SendDue();
+  }
+}
+
+
+// Sends what's due, and sets the timer for what's next
+void CMidiScheduler::SendDue() {
+  const auto lock = LockRouter();
+  auto nextReleaseTicks = int64_t(0);
+  {
+    std::lock_guard<std::mutex> queueLock(mQueueMutex);
+    const auto now = Now();
+    auto iDue = mQueue.begin();
+    while(iDue != mQueue.end() && iDue->releaseTicks <= now)
+      ++iDue;
+    mDue.assign(mQueue.begin(), iDue);
+    mQueue.erase(mQueue.begin(), iDue);
+    if(!mQueue.empty())
+      nextReleaseTicks = mQueue.front().releaseTicks;
+  }
+
+  if(!mDue.empty()) {
+    const auto now = Now();
+    for(const auto& pending: mDue) {
+      mpRouter->Send(pending.control, pending.value, pending.previousValue);
+      CountSent(pending, now);
+    }
+    mpRouter->Flush();
+  }
+
+  if(nextReleaseTicks) {
+    // Relative, in units of 100 ns
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -(std::max)(int64_t(1), (nextReleaseTicks - Now()) * 10000000 / mTicksPerSecond);
+    ::SetWaitableTimer(mhTimer, &dueTime, 0, nullptr, nullptr, FALSE);
+  }
+}
+
+
+void CMidiScheduler::CountSent(const PendingValue& pending, int64_t now) {
+  const auto delayTicks = now - pending.sourceTicks;
+  ++mNumValues;
+  if(IsScheduling() && now - pending.releaseTicks > sLateMicroseconds * mTicksPerSecond / 1000000)
+    ++mNumLate;
+  mMinDelayTicks = (std::min)(mMinDelayTicks, delayTicks);
+  mMaxDelayTicks = (std::max)(mMaxDelayTicks, delayTicks);
+  mSumDelayTicks += delayTicks;
+}
+
+
+CMidiScheduler::Stats CMidiScheduler::TakeStats() {
+  const auto lock = LockRouter();
+  const auto toMicroseconds = [this](int64_t ticks) {
+    return unsigned((std::max)(int64_t(0), ticks) * 1000000 / mTicksPerSecond);
+  };
+  Stats stats;
+  stats.numValues = mNumValues;
+  stats.numLate = mNumLate;
+  if(mNumValues) {
+    stats.minDelayMicroseconds = toMicroseconds(mMinDelayTicks);
+    stats.maxDelayMicroseconds = toMicroseconds(mMaxDelayTicks);
+    stats.averageDelayMicroseconds = toMicroseconds(mSumDelayTicks / mNumValues);
+  }
+
+  mNumValues = 0;
+  mNumLate = 0;
+  mMinDelayTicks = INT64_MAX;
+  mMaxDelayTicks = 0;
+  mSumDelayTicks = 0;
+  return stats;
+}
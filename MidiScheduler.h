@@ -0,0 +1,116 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <windows.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CMidiRouter;
+
+// Sends controller values a constant latency after the input that caused
+// them, instead of whenever the window thread gets to them. How long it
+// takes to handle and paint a message then doesn't show in the timing of
+// the values, as long as it's within the latency.
+//
+// Values are stamped with the time of their input, e.g. the touch time of
+// a contact. A thread with a high-resolution timer sends them at that time
+// plus the latency, in the order they were sent. Values that are already
+// late go out right away.
+//
+// Without a latency, values are sent on the window thread, like without a
+// scheduler. Either way, it tracks the delay from input to sending.
+class CMidiScheduler {
+public:
+  struct Stats {
+    unsigned int numValues = 0;
+    // Values that were sent later than scheduled, by more than a millisecond
+    unsigned int numLate = 0;
+    // From the input to the value being sent
+    unsigned int minDelayMicroseconds = 0;
+    unsigned int maxDelayMicroseconds = 0;
+    unsigned int averageDelayMicroseconds = 0;
+  };
+
+  explicit CMidiScheduler(CMidiRouter* pRouter);
+  ~CMidiScheduler();
+
+  // Starts the thread, unless it's 0. Call once, before values are sent.
+  void SetLatency(unsigned int microseconds);
+  bool IsScheduling() const { return mLatencyTicks > 0; }
+
+  // Window thread. The values that are sent from now on were caused by input
+  // at this time, which is in milliseconds, like TOUCHINPUT::dwTime. Values
+  // are only as even as these times are.
+  void SetSourceTime(DWORD milliseconds);
+  // For values that were caused right now, e.g. by inertia
+  void SetSourceTimeNow();
+
+  // Window thread. Like CMidiRouter::Send.
+  void Send(size_t control, uint16_t value, uint16_t previousValue);
+  // Hands the values since the last call to the thread, or sends them
+  void Flush();
+
+  // Drops the values that wait for their time, e.g. since a resync sends
+  // the latest ones anyway
+  void Discard();
+  // Drops the values of one control that wait for their time, e.g. since the
+  // device sent it a newer one
+  void Discard(size_t control);
+
+  // Keeps the thread from sending while the window thread uses the router
+  std::unique_lock<std::mutex> LockRouter() { return std::unique_lock<std::mutex>(mRouterMutex); }
+
+  // Returns the stats since the last call
+  Stats TakeStats();
+
+private:
+  struct PendingValue {
+    int64_t releaseTicks;
+    int64_t sourceTicks;
+    uint32_t control;
+    uint16_t value;
+    uint16_t previousValue;
+  };
+
+  static int64_t Now();
+  void ThreadMain();
+  void SendDue();
+  // Needs the router lock
+  void CountSent(const PendingValue& pending, int64_t now);
+
+  CMidiRouter* mpRouter;
+  int64_t mTicksPerSecond;
+  int64_t mLatencyTicks = 0;
+
+  // Window thread. Touch times extended to 64 bits, and their offset to the
+  // performance counter.
+  int64_t mTouchMilliseconds = -1;
+  int64_t mClockOffsetTicks = 0;
+  int64_t mClockOffsetTime = 0;
+  int64_t mSourceTicks = 0;
+  // Release times only ever grow, so the values keep their order
+  int64_t mLastReleaseTicks = 0;
+  std::vector<PendingValue> mBatch;
+
+  std::mutex mQueueMutex;
+  std::vector<PendingValue> mQueue;
+
+  std::mutex mRouterMutex;
+  std::vector<PendingValue> mDue;
+  unsigned int mNumValues = 0;
+  unsigned int mNumLate = 0;
+  int64_t mMinDelayTicks = INT64_MAX;
+  int64_t mMaxDelayTicks = 0;
+  int64_t mSumDelayTicks = 0;
+
+  HANDLE mhWakeUp = nullptr;
+  HANDLE mhTimer = nullptr;
+  std::atomic<bool> mIsQuitting{false};
+  std::thread mThread;
+};
@@ -0,0 +1,82 @@
+// Copyright (c) v1ne
+
+#include "OscEncoder.h"
+
+#include <cstring>
+
+// "#bundle" with its terminator, then the time tag
+static constexpr char sBundleTag[8] = "#bundle";
+static constexpr size_t sBundleHeaderSize = sizeof(sBundleTag) + sizeof(uint64_t);
+static constexpr char sAddressPrefix[] = "/control/";
+// A single float argument, padded to 4 bytes
+static constexpr char sTypeTags[4] = ",f";
+// The Unix epoch is 70 years and 17 leap days after the NTP epoch
+static constexpr uint64_t sNtpSecondsBeforeUnixEpoch = (70ull * 365 + 17) * 24 * 60 * 60;
+
+
+uint64_t COscEncoder::NtpTime(std::chrono::system_clock::time_point time) {
+  const auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+  const auto seconds = uint64_t(sinceEpoch / 1000000000) + sNtpSecondsBeforeUnixEpoch;
+  const auto fraction = (uint64_t(sinceEpoch % 1000000000) << 32) / 1000000000;
+  return seconds << 32 | fraction;
+}
+
+
+void COscEncoder::BeginBundle(uint64_t timeTag) {
+  memcpy(mBytes, sBundleTag, sizeof(sBundleTag));
+  PutUint32(sizeof(sBundleTag), uint32_t(timeTag >> 32));
+  PutUint32(sizeof(sBundleTag) + 4, uint32_t(timeTag));
+  mSize = sBundleHeaderSize;
+  mNumMessages = 0;
+}
+
+
+size_t COscEncoder::AddFloat(uint32_t control, float value) {
+  // The address is padded with at least one terminating zero
+  char address[sizeof(sAddressPrefix) + 12];
+  memcpy(address, sAddressPrefix, sizeof(sAddressPrefix) - 1);
+  auto addressSize = sizeof(sAddressPrefix) - 1;
+  char digits[10];
+  auto numDigits = 0;
+  do {
+    digits[numDigits++] = char('0' + control % 10);
+    control /= 10;
+  } while(control);
+  while(numDigits)
+    address[addressSize++] = digits[--numDigits];
+  const auto paddedAddressSize = (addressSize + 4) & ~size_t(3);
+  memset(address + addressSize, 0, paddedAddressSize - addressSize);
+
+  // Each element of a bundle is preceded by its size
+  const auto messageSize = paddedAddressSize + sizeof(sTypeTags) + sizeof(float);
+  if(mSize + 4 + messageSize > sMaxBundleSize)
+    return 0;
+
+  PutUint32(mSize, uint32_t(messageSize));
+  auto offset = mSize + 4;
+  memcpy(mBytes + offset, address, paddedAddressSize);
+  offset += paddedAddressSize;
+  memcpy(mBytes + offset, sTypeTags, sizeof(sTypeTags));
+  offset += sizeof(sTypeTags);
+  ReplaceFloat(offset, value);
+
+  mSize = offset + sizeof(float);
+  ++mNumMessages;
+  return offset;
+}
+
+
+void COscEncoder::ReplaceFloat(size_t offset, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  PutUint32(offset, bits);
+}
+
+
+// OSC is big-endian
+void COscEncoder::PutUint32(size_t offset, uint32_t value) {
+  mBytes[offset] = uint8_t(value >> 24);
+  mBytes[offset + 1] = uint8_t(value >> 16);
+  mBytes[offset + 2] = uint8_t(value >> 8);
+  mBytes[offset + 3] = uint8_t(value);
+}
@@ -0,0 +1,40 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Encodes OSC bundles of float messages, one per control value. Each
+// message goes to /control/<index of the control>. A bundle fits into a
+// single UDP datagram that won't be fragmented on Ethernet.
+class COscEncoder {
+public:
+  // The UDP payload of an Ethernet frame, without IP options
+  static constexpr size_t sMaxBundleSize = 1472;
+
+  // Seconds since 1900 in the upper 32 bits, fractions of a second in the
+  // lower ones
+  static uint64_t NtpTime(std::chrono::system_clock::time_point time);
+
+  // Starts over with an empty bundle
+  void BeginBundle(uint64_t timeTag);
+  // Returns where the value went, to replace it later on, or 0 if the
+  // bundle is full
+  size_t AddFloat(uint32_t control, float value);
+  // offset is what AddFloat returned for the message
+  void ReplaceFloat(size_t offset, float value);
+
+  bool IsEmpty() const { return mNumMessages == 0; }
+  const uint8_t* Data() const { return mBytes; }
+  size_t Size() const { return mSize; }
+  size_t NumMessages() const { return mNumMessages; }
+
+private:
+  void PutUint32(size_t offset, uint32_t value);
+
+  uint8_t mBytes[sMaxBundleSize];
+  size_t mSize = 0;
+  size_t mNumMessages = 0;
+};
@@ -0,0 +1,151 @@
+// Copyright (c) v1ne
+
+#include "OscEncoderCheck.h"
+
+#include "OscEncoder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+// 1970-01-01 in NTP time
+const uint64_t sUnixEpochNtpSeconds = 2208988800ull;
+
+struct Message {
+  uint32_t control;
+  float value;
+
+  bool operator==(const Message& other) const { return control == other.control && value == other.value; }
+};
+
+
+uint32_t GetUint32(const uint8_t* pBytes) {
+  return uint32_t(pBytes[0]) << 24 | uint32_t(pBytes[1]) << 16 | uint32_t(pBytes[2]) << 8 | pBytes[3];
+}
+
+
+// Reads a bundle of /control/<index> messages with a float each, as an OSC
+// receiver would. Returns false if it isn't one.
+bool ParseBundle(const uint8_t* pBytes, size_t size, uint64_t* pTimeTag, std::vector<Message>* pMessages) {
+  if(size < 16 || memcmp(pBytes, "#bundle", 8))
+    return false;
+  *pTimeTag = uint64_t(GetUint32(pBytes + 8)) << 32 | GetUint32(pBytes + 12);
+
+  pMessages->clear();
+  for(size_t offset = 16; offset < size; ) {
+    if(offset + 4 > size)
+      return false;
+    const auto elementSize = GetUint32(pBytes + offset);
+    const auto* pElement = pBytes + offset + 4;
+    offset += 4 + elementSize;
+    if(elementSize % 4 || offset > size)
+      return false;
+
+    // The address and the type tags are zero-terminated and padded to 4 bytes
+    const auto* pAddress = reinterpret_cast<const char*>(pElement);
+    const auto addressSize = strnlen(pAddress, elementSize);
+    const auto paddedAddressSize = (addressSize + 4) & ~size_t(3);
+    if(paddedAddressSize + 8 != elementSize || strncmp(pAddress, "/control/", 9) || addressSize == 9)
+      return false;
+    for(auto i = addressSize; i < paddedAddressSize; ++i)
+      if(pAddress[i])
+        return false;
+    if(memcmp(pElement + paddedAddressSize, ",f\0\0", 4))
+      return false;
+
+    Message message = {0, 0.f};
+    for(size_t i = 9; i < addressSize; ++i) {
+      if(pAddress[i] < '0' || pAddress[i] > '9')
+        return false;
+      message.control = message.control * 10 + uint32_t(pAddress[i] - '0');
+    }
+    const auto bits = GetUint32(pElement + paddedAddressSize + 4);
+    memcpy(&message.value, &bits, sizeof(float));
+    pMessages->push_back(message);
+  }
+  return true;
+}
+
+}
+
+
+bool CheckOscEncoder(std::string* pReport) {
+  auto success = true;
+  char buf[192];
+
+  // NTP counts from 1900, with 32 bits of fractions
+  {
+    const auto epoch = std::chrono::system_clock::time_point();
+    const auto unixEpoch = COscEncoder::NtpTime(epoch);
+    const auto later = COscEncoder::NtpTime(epoch + std::chrono::milliseconds(1500));
+    const auto isGood = unixEpoch == sUnixEpochNtpSeconds << 32
+      && later == ((sUnixEpochNtpSeconds + 1) << 32 | 0x8000'0000u);
+    snprintf(buf, sizeof(buf), "NTP time: %08X.%08X at the Unix epoch, %08X.%08X 1.5 s later%s\n",
+      unsigned(unixEpoch >> 32), unsigned(unixEpoch), unsigned(later >> 32), unsigned(later),
+      isGood ? "" : ", EXPECTED 83AA7E80.00000000 and 83AA7E81.80000000");
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  // Addresses of all lengths, up to the largest index, in a bundle
+  {
+    COscEncoder encoder;
+    const uint64_t timeTag = 0x0123'4567'89AB'CDEFull;
+    const std::vector<Message> messages = {{7, 0.5f}, {12, -1.f}, {123, 0.f}, {1234, 1.f}, {4294967295u, 0.25f}};
+    encoder.BeginBundle(timeTag);
+    for(const auto& message: messages)
+      encoder.AddFloat(message.control, message.value);
+    uint64_t parsedTimeTag = 0;
+    std::vector<Message> parsed;
+    const auto isParsed = ParseBundle(encoder.Data(), encoder.Size(), &parsedTimeTag, &parsed);
+    const auto isGood = isParsed && parsedTimeTag == timeTag && parsed == messages
+      && encoder.NumMessages() == messages.size() && encoder.Size() % 4 == 0;
+    snprintf(buf, sizeof(buf), "Bundle: %u messages in %u bytes, %s\n", unsigned(encoder.NumMessages()),
+      unsigned(encoder.Size()), !isParsed ? "NOT valid OSC" : isGood ? "read back as sent" : "read back DIFFERENTLY");
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  // The first message, byte by byte
+  {
+    COscEncoder encoder;
+    encoder.BeginBundle(1);
+    encoder.AddFloat(7, 1.f);
+    const uint8_t expected[] = {'#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 20,
+      '/', 'c', 'o', 'n', 't', 'r', 'o', 'l', '/', '7', 0, 0, ',', 'f', 0, 0, 0x3F, 0x80, 0, 0};
+    const auto isGood = encoder.Size() == sizeof(expected) && !memcmp(encoder.Data(), expected, sizeof(expected));
+    *pReport += isGood ? "Bytes: as OSC specifies\n" : "Bytes: NOT as OSC specifies\n";
+    success &= isGood;
+  }
+
+  // A full bundle takes no more messages, and replacing a value only changes it
+  {
+    COscEncoder encoder;
+    encoder.BeginBundle(0);
+    std::vector<Message> messages;
+    size_t firstOffset = 0;
+    for(uint32_t control = 0; ; ++control) {
+      const auto offset = encoder.AddFloat(control, float(control));
+      if(!offset)
+        break;
+      if(!control)
+        firstOffset = offset;
+      messages.push_back({control, float(control)});
+    }
+    encoder.ReplaceFloat(firstOffset, 42.f);
+    messages[0].value = 42.f;
+
+    uint64_t timeTag;
+    std::vector<Message> parsed;
+    const auto isGood = encoder.Size() <= COscEncoder::sMaxBundleSize && !encoder.AddFloat(0, 0.f)
+      && ParseBundle(encoder.Data(), encoder.Size(), &timeTag, &parsed) && parsed == messages;
+    snprintf(buf, sizeof(buf), "Full bundle: %u messages in %u of %u bytes, %s\n", unsigned(encoder.NumMessages()),
+      unsigned(encoder.Size()), unsigned(COscEncoder::sMaxBundleSize), isGood ? "intact" : "DAMAGED or too large");
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  return success;
+}
@@ -0,0 +1,14 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Encodes OSC bundles with a COscEncoder and reads them back like an OSC
+// receiver would: the time tag has to be NTP time, each message has to have
+// a padded /control/<index> address and a big-endian float, a full bundle
+// has to refuse further messages and still fit a datagram, and replacing a
+// value must not touch the others.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckOscEncoder(std::string* pReport);
@@ -0,0 +1,164 @@
+// Copyright (c) v1ne
+
+#include "OscOutput.h"
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <Windows.h>
+
+// Bundles that may wait for the sender thread. Beyond that, it can't keep up
+// anyway.
+static constexpr size_t sMaxQueuedBytes = 256 * 1024;
+// How long the sender thread waits for the socket to take a datagram
+static constexpr long sSendTimeoutMicroseconds = 10000;
+
+
+COscOutput::~COscOutput() {
+  if(!IsOpen())
+    return;
+
+  Flush();
+  mIsQuitting = true;
+  ::SetEvent(mhWakeUp);
+  mThread.join();
+  ::CloseHandle(mhWakeUp);
+  ::closesocket(SOCKET(mSocket));
+  ::WSACleanup();
+}
+
+
+bool COscOutput::Open(const wchar_t* pHost, uint16_t port) {
+  WSADATA wsaData;
+  if(::WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    return false;
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = ::htons(port);
+  auto udpSocket = INVALID_SOCKET;
+  u_long isNonBlocking = 1;
+  if(::InetPtonW(AF_INET, pHost, &address.sin_addr) != 1
+    || (udpSocket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET
+    || ::ioctlsocket(udpSocket, FIONBIO, &isNonBlocking) != 0
+    || ::connect(udpSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+  {
+    if(udpSocket != INVALID_SOCKET)
+      ::closesocket(udpSocket);
+    ::WSACleanup();
+    return false;
+  }
+
+  mSocket = uintptr_t(udpSocket);
+  mhWakeUp = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+  mThread = std::thread(&COscOutput::ThreadMain, this);
+  return true;
+}
+
+
+void COscOutput::Send(size_t control, float value) {
+  if(!IsOpen())
+    return;
+
+  ++mStats.numValues;
+  if(control >= mValueOffsets.size())
+    mValueOffsets.resize(control + 1, 0);
+  auto& offset = mValueOffsets[control];
+  if(offset) {
+    mEncoder.ReplaceFloat(offset, value);
+    ++mStats.numCoalesced;
+    return;
+  }
+
+  if(mControlsInBundle.empty()) {
+    mTimeTag = COscEncoder::NtpTime(std::chrono::system_clock::now());
+    mEncoder.BeginBundle(mTimeTag);
+  }
+  offset = uint16_t(mEncoder.AddFloat(uint32_t(control), value));
+  if(!offset) {
+    // The rest goes into another bundle for the same time
+    const auto timeTag = mTimeTag;
+    Flush();
+    mTimeTag = timeTag;
+    mEncoder.BeginBundle(mTimeTag);
+    offset = uint16_t(mEncoder.AddFloat(uint32_t(control), value));
+  }
+  mControlsInBundle.push_back(uint32_t(control));
+}
+
+
+void COscOutput::Flush() {
+  if(mControlsInBundle.empty())
+    return;
+
+  for(const auto control: mControlsInBundle)
+    mValueOffsets[control] = 0;
+  mControlsInBundle.clear();
+
+  ++mStats.numBundles;
+  mStats.numMessages += unsigned(mEncoder.NumMessages());
+  mStats.numBytes += unsigned(mEncoder.Size());
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mQueuedBytes.size() + mEncoder.Size() > sMaxQueuedBytes) {
+      ++mStats.numDroppedBundles;
+      return;
+    }
+    mQueuedBytes.insert(mQueuedBytes.end(), mEncoder.Data(), mEncoder.Data() + mEncoder.Size());
+    mQueuedSizes.push_back(uint16_t(mEncoder.Size()));
+  }
+  ::SetEvent(mhWakeUp);
+}
+
+
+COscOutput::Stats COscOutput::TakeStats() {
+  auto stats = mStats;
+  stats.numDroppedBundles += mNumDroppedBundles.exchange(0);
+  stats.fillPercent = stats.numBundles
+    ? unsigned(uint64_t(stats.numBytes) * 100 / (uint64_t(stats.numBundles) * COscEncoder::sMaxBundleSize))
+    : 0;
+  mStats = {};
+  return stats;
+}
+
+
+void COscOutput::ThreadMain() {
+  std::vector<uint8_t> bytes;
+  std::vector<uint16_t> sizes;
+  for(;;) {
+    ::WaitForSingleObject(mhWakeUp, INFINITE);
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      bytes.swap(mQueuedBytes);
+      sizes.swap(mQueuedSizes);
+    }
+    SendQueued(bytes, sizes);
+    bytes.clear();
+    sizes.clear();
+
+    // Whatever was queued before is sent by now
+    if(mIsQuitting)
+      return;
+  }
+}
+
+
+void COscOutput::SendQueued(const std::vector<uint8_t>& bytes, const std::vector<uint16_t>& sizes) {
+  const auto udpSocket = SOCKET(mSocket);
+  auto pDatagram = reinterpret_cast<const char*>(bytes.data());
+  for(const auto size: sizes) {
+    auto result = ::send(udpSocket, pDatagram, int(size), 0);
+    if(result == SOCKET_ERROR && ::WSAGetLastError() == WSAEWOULDBLOCK) {
+      // The socket's buffer is full. Give it a moment to drain.
+      fd_set writable;
+      FD_ZERO(&writable);
+      FD_SET(udpSocket, &writable);
+      timeval timeout = {0, sSendTimeoutMicroseconds};
+      if(::select(0, nullptr, &writable, nullptr, &timeout) == 1)
+        result = ::send(udpSocket, pDatagram, int(size), 0);
+    }
+    // Also if nobody listens, which a connected socket may learn of
+    if(result != int(size))
+      ++mNumDroppedBundles;
+    pDatagram += size;
+  }
+}
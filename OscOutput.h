@@ -0,0 +1,76 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "OscEncoder.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Sends control values as OSC floats over UDP, e.g. to software on the same
+// machine, without MIDI's resolution and bandwidth. The values that change
+// during one input message go out as one bundle, time-tagged with when
+// they changed. If a control changes again in between, only its last value
+// is sent.
+//
+// Bundles are queued for a sender thread, so that the input thread never
+// waits for the socket. Bundles that don't fit into the queue are dropped.
+class COscOutput {
+public:
+  struct Stats {
+    // Values handed to Send
+    unsigned int numValues = 0;
+    // Values that were replaced by a newer one before they were sent
+    unsigned int numCoalesced = 0;
+    unsigned int numMessages = 0;
+    unsigned int numBundles = 0;
+    unsigned int numBytes = 0;
+    unsigned int numDroppedBundles = 0;
+    // How full the bundles were, compared to the largest datagram
+    unsigned int fillPercent = 0;
+  };
+
+  ~COscOutput();
+
+  // Sends to an IPv4 address, e.g. 127.0.0.1
+  bool Open(const wchar_t* pHost, uint16_t port);
+  bool IsOpen() const { return mThread.joinable(); }
+
+  // Input thread
+  void Send(size_t control, float value);
+  // Queues the bundle of the values so far
+  void Flush();
+
+  // Returns the stats since the last call
+  Stats TakeStats();
+
+private:
+  void ThreadMain();
+  void SendQueued(const std::vector<uint8_t>& bytes, const std::vector<uint16_t>& sizes);
+
+  uintptr_t mSocket = ~uintptr_t(0);
+  void* mhWakeUp = nullptr;
+  std::thread mThread;
+  std::atomic<bool> mIsQuitting{false};
+
+  COscEncoder mEncoder;
+  // Of the bundle being filled
+  uint64_t mTimeTag = 0;
+  // Where the value of each control is in the bundle, or 0 if it's not
+  std::vector<uint16_t> mValueOffsets;
+  std::vector<uint32_t> mControlsInBundle;
+
+  // Datagrams back to back, along with their sizes. The sender thread swaps
+  // them for its own, which keeps the memory of both.
+  std::mutex mMutex;
+  std::vector<uint8_t> mQueuedBytes;
+  std::vector<uint16_t> mQueuedSizes;
+
+  Stats mStats;
+  // Written by the sender thread
+  std::atomic<unsigned int> mNumDroppedBundles{0};
+};
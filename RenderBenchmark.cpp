@@ -0,0 +1,315 @@
+// Copyright (c) v1ne
+
+#include "RenderBenchmark.h"
+
+#include "Benchmark.h"
+#include "CpuRenderer.h"
+#include "HeadlessScene.h"
+#include "TiledCpuRenderer.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+namespace {
+
+const auto sFrameSize = Point2F{1920.f, 1080.f};
+const int sNumFrames = 30;
+const int sNumScalingFrames = 10;
+
+const auto sDiffFrameSize = Point2F{800.f, 600.f};
+// The values change for this many frames, then they stay for as many
+const int sNumMovingFrames = 60;
+
+// Like sViewsPerRecordChunk of CComTouchDriver
+const size_t sViewsPerRecordChunk = 8;
+const int sNumRecordingFrames = 50;
+
+const auto sCullingFrameSize = Point2F{800.f, 600.f};
+// The knobs are wider than the window
+const auto sNumCullingKnobs = Point2I{40, 25};
+const auto sCullingKnobSize = Point2F{24.f};
+
+
+// Copies of the first bank of the layout, side by side, as a single bank
+std::vector<LayoutControl> RepeatedLayout(const std::vector<LayoutControl>& controls, Point2I numCopies) {
+  auto size = Point2F{};
+  for(const auto& control: controls)
+    size = Point2F{std::max(size.x, control.rect.right), std::max(size.y, control.rect.bottom)};
+
+  std::vector<LayoutControl> copies;
+  for(int y = 0; y < numCopies.y; ++y) {
+    for(int x = 0; x < numCopies.x; ++x) {
+      for(auto control: controls) {
+        if(control.bank != 0)
+          break;
+        const auto offset = size.mulByComponent(Point2I{x, y});
+        control.rect = Rect2F::FromPoints(control.rect.TopLeft() + offset, control.rect.BottomRight() + offset);
+        copies.push_back(control);
+      }
+    }
+  }
+  return copies;
+}
+
+}
+
+
+bool BenchmarkDefaultLayout(const SelfCheckOptions&, std::string* pReport) {
+  const auto width = int(sFrameSize.x);
+  const auto height = int(sFrameSize.y);
+  CHeadlessScene scene(BuiltInLayout(), sFrameSize);
+  CWorkStealingPool pool(std::thread::hardware_concurrency());
+  CCpuRenderer single(width, height);
+  CTiledCpuRenderer tiled(width, height, pool);
+
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%zu views in %dx%d, %u workers for the tiled renderer\n",
+    scene.NumViews(), width, height, pool.NumWorkers());
+  *pReport += buf;
+
+  CBenchmarkTimes record, singleFull, tiledFull, singlePartial, tiledPartial;
+  CRenderList lists[2];
+  for(int frame = 0; frame < sNumFrames; ++frame) {
+    auto& list = lists[frame % 2];
+    const auto& previous = lists[(frame + 1) % 2];
+    scene.Animate(frame);
+
+    auto begin = CBenchmarkTimes::Clock::now();
+    scene.Record(list);
+    record.Add(CBenchmarkTimes::Clock::now() - begin);
+
+    begin = CBenchmarkTimes::Clock::now();
+    single.Render(list, nullptr);
+    singleFull.Add(CBenchmarkTimes::Clock::now() - begin);
+
+    begin = CBenchmarkTimes::Clock::now();
+    tiled.Render(list, nullptr);
+    tiledFull.Add(CBenchmarkTimes::Clock::now() - begin);
+
+    // Partial frames start from the one before, which both renderers just rendered in full
+    Rect2F dirty;
+    if(!frame || !list.Diff(previous, &dirty))
+      continue;
+    single.Render(previous, nullptr);
+    tiled.Render(previous, nullptr);
+
+    begin = CBenchmarkTimes::Clock::now();
+    single.Render(list, &dirty);
+    singlePartial.Add(CBenchmarkTimes::Clock::now() - begin);
+
+    begin = CBenchmarkTimes::Clock::now();
+    tiled.Render(list, &dirty);
+    tiledPartial.Add(CBenchmarkTimes::Clock::now() - begin);
+  }
+
+  *pReport += record.Summary("Recording");
+  *pReport += singleFull.Summary("Full frame, CCpuRenderer");
+  *pReport += tiledFull.Summary("Full frame, CTiledCpuRenderer");
+  *pReport += singlePartial.Summary("Partial frame, CCpuRenderer");
+  *pReport += tiledPartial.Summary("Partial frame, CTiledCpuRenderer");
+  return true;
+}
+
+
+bool BenchmarkTileScaling(const SelfCheckOptions&, std::string* pReport) {
+  const auto width = int(sFrameSize.x);
+  const auto height = int(sFrameSize.y);
+  CHeadlessScene scene(RepeatedLayout(BuiltInLayout(), {5, 2}), sFrameSize);
+  CRenderList list;
+  scene.Record(list);
+
+  char buf[160];
+  snprintf(buf, sizeof(buf), "%zu views in %dx%d, %u hardware threads\n",
+    scene.NumViews(), width, height, std::thread::hardware_concurrency());
+  *pReport += buf;
+
+  uint64_t singleWorkerNanoseconds = 0;
+  for(const auto numWorkers: {1u, 2u, 4u, 8u}) {
+    CWorkStealingPool pool(numWorkers);
+    CTiledCpuRenderer tiled(width, height, pool);
+    CBenchmarkTimes times;
+    // The first frame also faults in the pixels
+    tiled.Render(list, nullptr);
+    for(int frame = 0; frame < sNumScalingFrames; ++frame) {
+      const auto begin = CBenchmarkTimes::Clock::now();
+      tiled.Render(list, nullptr);
+      times.Add(CBenchmarkTimes::Clock::now() - begin);
+    }
+
+    if(numWorkers == 1)
+      singleWorkerNanoseconds = times.MedianNanoseconds();
+    snprintf(buf, sizeof(buf), "%u workers", numWorkers);
+    auto summary = times.Summary(buf);
+    snprintf(buf, sizeof(buf), ", %.2fx\n", double(singleWorkerNanoseconds) / double(times.MedianNanoseconds()));
+    summary.replace(summary.size() - 1, 1, buf);
+    *pReport += summary;
+  }
+  return true;
+}
+
+
+bool BenchmarkFrameDiff(const SelfCheckOptions&, std::string* pReport) {
+  const auto width = int(sDiffFrameSize.x);
+  const auto height = int(sDiffFrameSize.y);
+  CHeadlessScene scene(BuiltInLayout(), sDiffFrameSize);
+  CCpuRenderer renderer(width, height);
+
+  // Like CComTouchDriver::RequestFrame, which diffs against the published frame
+  CBenchmarkTimes diff, full, partial;
+  CRenderList recorded, published;
+  unsigned int numSkipped = 0;
+  for(int step = 0; step < 2 * sNumMovingFrames; ++step) {
+    scene.Animate(std::min(step, sNumMovingFrames));
+    scene.Record(recorded);
+
+    Rect2F dirty;
+    auto begin = CBenchmarkTimes::Clock::now();
+    const auto isChanged = published.IsEmpty() || recorded.Diff(published, &dirty);
+    diff.Add(CBenchmarkTimes::Clock::now() - begin);
+    if(!isChanged) {
+      ++numSkipped;
+      continue;
+    }
+
+    const auto isPartial = !published.IsEmpty();
+    begin = CBenchmarkTimes::Clock::now();
+    renderer.Render(recorded, isPartial ? &dirty : nullptr);
+    (isPartial ? partial : full).Add(CBenchmarkTimes::Clock::now() - begin);
+    std::swap(recorded, published);
+  }
+
+  // What the same frames take without diffing
+  for(int frame = 0; frame < sNumScalingFrames; ++frame) {
+    const auto begin = CBenchmarkTimes::Clock::now();
+    renderer.Render(published, nullptr);
+    full.Add(CBenchmarkTimes::Clock::now() - begin);
+  }
+
+  char buf[192];
+  snprintf(buf, sizeof(buf), "%d frames in %dx%d: %u unchanged and skipped, %u partial\n",
+    2 * sNumMovingFrames, width, height, numSkipped, unsigned(partial.NumRuns()));
+  *pReport += buf;
+  *pReport += diff.Summary("Diff");
+  *pReport += full.Summary("Full frame");
+  *pReport += partial.Summary("Partial frame");
+  const auto renderedNanoseconds = double(partial.MedianNanoseconds()) * partial.NumRuns();
+  const auto undiffedNanoseconds = double(full.MedianNanoseconds()) * 2 * sNumMovingFrames;
+  snprintf(buf, sizeof(buf), "Rendering took %.0f%% of the time it takes without diffing\n",
+    undiffedNanoseconds ? 100.0 * renderedNanoseconds / undiffedNanoseconds : 0.0);
+  *pReport += buf;
+  return true;
+}
+
+
+bool BenchmarkParallelRecording(const SelfCheckOptions&, std::string* pReport) {
+  // Nothing is rendered, so the window shows all views, at full detail
+  const auto controls = RepeatedLayout(BuiltInLayout(), {8, 5});
+  auto clientArea = Point2F{};
+  for(const auto& control: controls)
+    clientArea = Point2F{std::max(clientArea.x, control.rect.right), std::max(clientArea.y, control.rect.bottom)};
+  CHeadlessScene scene(controls, clientArea);
+
+  CBenchmarkTimes serialTimes;
+  CRenderList serial;
+  for(int frame = 0; frame < sNumRecordingFrames; ++frame) {
+    scene.Animate(frame);
+    const auto begin = CBenchmarkTimes::Clock::now();
+    scene.Record(serial);
+    serialTimes.Add(CBenchmarkTimes::Clock::now() - begin);
+  }
+
+  char buf[160];
+  snprintf(buf, sizeof(buf), "%zu views, %u hardware threads\n", scene.NumViews(), std::thread::hardware_concurrency());
+  *pReport += buf;
+  *pReport += serialTimes.Summary("Serial");
+
+  auto isIdentical = true;
+  const auto numChunks = (scene.NumViews() + sViewsPerRecordChunk - 1) / sViewsPerRecordChunk;
+  std::vector<CRenderList> chunkLists(numChunks);
+  for(const auto numWorkers: {1u, 2u, 4u, 8u}) {
+    CWorkStealingPool pool(numWorkers);
+    CBenchmarkTimes times;
+    CRenderList list;
+    for(int frame = 0; frame < sNumRecordingFrames; ++frame) {
+      scene.Animate(frame);
+      const auto begin = CBenchmarkTimes::Clock::now();
+      // The background, then the chunks in paint order
+      list.Reset();
+      scene.RecordBackground(list);
+      pool.Run(numChunks, [&](size_t chunk, unsigned int) {
+        chunkLists[chunk].Reset();
+        scene.RecordViews(chunkLists[chunk], chunk * sViewsPerRecordChunk,
+          std::min((chunk + 1) * sViewsPerRecordChunk, scene.NumViews()));
+      });
+      for(const auto& chunkList: chunkLists)
+        list.AppendViews(chunkList);
+      times.Add(CBenchmarkTimes::Clock::now() - begin);
+    }
+
+    // Both recorded the last frame
+    Rect2F dirty;
+    const auto isSame = list.Size() == serial.Size() && !list.Diff(serial, &dirty);
+    isIdentical &= isSame;
+
+    snprintf(buf, sizeof(buf), "%u workers", numWorkers);
+    auto summary = times.Summary(buf);
+    snprintf(buf, sizeof(buf), ", %.2fx%s\n", double(serialTimes.MedianNanoseconds()) / double(times.MedianNanoseconds()),
+      isSame ? "" : ", DIFFERS from the serial frame");
+    summary.replace(summary.size() - 1, 1, buf);
+    *pReport += summary;
+  }
+  return isIdentical;
+}
+
+
+bool BenchmarkCulling(const SelfCheckOptions&, std::string* pReport) {
+  const auto width = int(sCullingFrameSize.x);
+  const auto height = int(sCullingFrameSize.y);
+  std::vector<LayoutControl> controls;
+  for(int i = 0; i < sNumCullingKnobs.x * sNumCullingKnobs.y; ++i) {
+    LayoutControl control = {};
+    const auto pos = sCullingKnobSize.mulByComponent(Point2I{i % sNumCullingKnobs.x, i / sNumCullingKnobs.x});
+    control.rect = Rect2F::FromPoints(pos, pos + sCullingKnobSize);
+    control.type = CControlModel::ControlType::Knob;
+    control.controller = uint8_t(i % 128);
+    controls.push_back(control);
+  }
+  CHeadlessScene scene(controls, sCullingFrameSize);
+  scene.BringSquaresToFront();
+  CRenderList list;
+  scene.Record(list);
+
+  CCpuRenderer renderer(width, height);
+  CBenchmarkTimes culled, all;
+  for(int frame = 0; frame < sNumScalingFrames; ++frame) {
+    const auto begin = CBenchmarkTimes::Clock::now();
+    renderer.Render(list, nullptr);
+    culled.Add(CBenchmarkTimes::Clock::now() - begin);
+  }
+  const auto cullStats = renderer.TakeCullStats();
+  const std::vector<uint32_t> culledPixels(renderer.Pixels(), renderer.Pixels() + size_t(width) * height);
+
+  std::vector<uint32_t> spanIndices(list.Spans().size());
+  for(size_t i = 0; i < spanIndices.size(); ++i)
+    spanIndices[i] = uint32_t(i);
+  for(int frame = 0; frame < sNumScalingFrames; ++frame) {
+    const auto begin = CBenchmarkTimes::Clock::now();
+    renderer.RenderSpans(list, spanIndices.data(), spanIndices.size(), Rect2F::FromPoints({}, sCullingFrameSize));
+    all.Add(CBenchmarkTimes::Clock::now() - begin);
+  }
+  const auto isSame = !memcmp(culledPixels.data(), renderer.Pixels(), culledPixels.size() * sizeof(uint32_t));
+
+  char buf[192];
+  snprintf(buf, sizeof(buf), "%zu views in %dx%d, %u recorded and the others off the window, %u drawn and %u culled per frame\n",
+    scene.NumViews(), width, height, unsigned(list.Spans().size() - 1), cullStats.numDrawn / sNumScalingFrames - 1,
+    cullStats.numCulled / sNumScalingFrames);
+  *pReport += buf;
+  *pReport += culled.Summary("With culling");
+  *pReport += all.Summary("Without culling");
+  if(!isSame)
+    *pReport += "Culling changed the pixels\n";
+  return isSame;
+}
@@ -0,0 +1,34 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "SelfCheck.h"
+
+#include <string>
+
+// Records the built-in layout in a window of 1920x1080 pixels and renders it
+// with the CPU renderers. Reports the time to record a frame, to render full
+// frames and to render partial frames, in which a quarter of the controls change.
+bool BenchmarkDefaultLayout(const SelfCheckOptions& options, std::string* pReport);
+
+// Renders a large layout, copies of the built-in one that fill 1920x1080
+// pixels, with CTiledCpuRenderer on 1, 2, 4 and 8 workers. Reports the
+// full-frame times and how much faster they are than with 1 worker.
+bool BenchmarkTileScaling(const SelfCheckOptions& options, std::string* pReport);
+
+// Records frames of the built-in layout in a window of 800x600 pixels, as
+// inertia would: values change for a while, then stay. Reports how many
+// frames Diff found unchanged and could skip, how many it rendered as partial
+// frames, and how long diffing and rendering took.
+bool BenchmarkFrameDiff(const SelfCheckOptions& options, std::string* pReport);
+
+// Records 1200 views, copies of the built-in layout, once on a single thread
+// and once in chunks on 1, 2, 4 and 8 workers, like CComTouchDriver::RecordFrame.
+// Reports the times and fails if a chunked frame differs from the serial one.
+bool BenchmarkParallelRecording(const SelfCheckOptions& options, std::string* pReport);
+
+// Renders 1000 small knobs in a window of 800x600 pixels, some of them off
+// the window and some below the squares, which are in front. Reports how
+// many views were culled and the frame times with culling and without, i.e.
+// with all views replayed. Fails if culling changes the pixels.
+bool BenchmarkCulling(const SelfCheckOptions& options, std::string* pReport);
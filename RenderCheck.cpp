@@ -0,0 +1,131 @@
+// Copyright (c) v1ne
+
+#include "RenderCheck.h"
+
+#include "CpuRenderer.h"
+#include "TiledCpuRenderer.h"
+#include "WorkStealingPool.h"
+
+#include <stdio.h>
+
+namespace {
+
+const int sNumColumns = 7;
+const int sNumRows = 5;
+const int sNumFrames = 6;
+
+// Views that look like the sliders and knobs, with all kinds of commands.
+// Each frame turns a few of them, so that frames after the first one are partial.
+void RecordScene(CRenderList& list, Point2F frameSize, int frame) {
+  list.Reset();
+
+  list.BeginView(nullptr);
+  list.FillRect(Rect2F::FromPoints({}, frameSize),
+    Brush(BrushId::GradientBackground, {}, {0.f, frameSize.y}));
+  list.EndView();
+
+  // Some views are scaled and cut off by the frame edges, like on a zoomed canvas
+  const auto cellSize = Point2F{frameSize.x / (sNumColumns - 1), frameSize.y / (sNumRows - 1)};
+  const auto canvasTransform = Transform2F::Scale({1.15f, 1.15f}) * Transform2F::Translation({-13.3f, -7.7f});
+
+  for(int i = 0; i < sNumColumns * sNumRows; ++i) {
+    const auto* pView = reinterpret_cast<const void*>(uintptr_t(i + 1));
+    const auto turns = frame ? (i % 3 == frame % 3 ? frame : frame - 1) : 0;
+    const auto degAngle = float(i * 37 + turns * 23 % 360);
+    const auto origin = Point2F{float(i % sNumColumns) * cellSize.x, float(i / sNumColumns) * cellSize.y};
+    const auto size = cellSize * 0.8f;
+    const auto center = origin + size / 2.f;
+
+    list.BeginView(pView, canvasTransform);
+    list.SetTransform(Transform2F::Identity());
+    list.FillRoundedRect(Rect2F::FromPoints(origin, origin + size), {6.f, 6.f},
+      Brush(i % 2 ? BrushId::GradientBlue : BrushId::GradientOrange, origin, origin + Point2F{0.f, size.y}));
+
+    // The face is a rotated layer, the scale a stretched one
+    list.BeginLayer(pView, 0, size * 0.6f, degAngle, center);
+    list.FillEllipse(size * 0.3f, size * 0.3f, BrushId::DarkGrey);
+    list.FillRect(Rect2F::FromPoints(size * 0.25f, size * 0.35f), BrushId::SomeGreenish);
+    list.EndLayer();
+
+    list.BeginLayer(pView, 1, {20.f, 40.f}, Rect2F{2.f, 5.f, 17.f, 33.f},
+      Rect2F::FromPoints(origin + Point2F{3.f, 3.f}, origin + Point2F{13.5f, size.y - 3.f}));
+    list.FillRect(Rect2F{0.f, 0.f, 20.f, 40.f}, BrushId::LightGrey);
+    list.FillRect(Rect2F{4.f, 8.f, 16.f, 12.f}, BrushId::SomeReddish);
+    list.EndLayer();
+
+    list.FillTiltedRect(center, size.x * 0.1f, degAngle + 90.f, {size.x * 0.3f, 3.f}, BrushId::White);
+    list.SetTransform(Transform2F::Rotation(float(turns * 3), center));
+    list.FillRect(Rect2F::FromPoints(center - Point2F{4.f, 4.f}, center + Point2F{9.5f, 4.f}),
+      BrushId::SemitransparentDark);
+    list.SetTransform(Transform2F::Identity());
+
+    char text[8];
+    snprintf(text, sizeof(text), "%d%%", (i * 7 + turns) % 100);
+    list.Text(Rect2F::FromPoints(origin + Point2F{0.f, size.y - 14.f}, origin + size), TextStyle::Small,
+      BrushId::Black, text);
+    list.EndView();
+  }
+
+  // A glossy overlay across everything, which hides nothing below it
+  list.BeginView(reinterpret_cast<const void*>(uintptr_t(-1)));
+  list.FillRect(Rect2F{frameSize.x * 0.2f, frameSize.y * 0.3f, frameSize.x * 0.7f, frameSize.y * 0.45f},
+    Brush(BrushId::GradientGlossy, {0.f, frameSize.y * 0.3f}, {0.f, frameSize.y * 0.45f}));
+  list.EndView();
+}
+
+
+size_t CountMismatches(const CCpuRenderer& reference, const CTiledCpuRenderer& tiled, int* pFirstX, int* pFirstY) {
+  size_t numMismatches = 0;
+  for(int y = 0; y < reference.Height(); ++y) {
+    for(int x = 0; x < reference.Width(); ++x) {
+      if(reference.Pixel(x, y) == tiled.Pixel(x, y))
+        continue;
+      if(!numMismatches) {
+        *pFirstX = x;
+        *pFirstY = y;
+      }
+      ++numMismatches;
+    }
+  }
+  return numMismatches;
+}
+
+}
+
+
+bool CompareCpuRenderers(std::string* pReport) {
+  CWorkStealingPool pool(4);
+  auto isEqual = true;
+
+  const Point2F sizes[] = {{640.f, 480.f}, {333.f, 217.f}, {63.f, 130.f}};
+  for(const auto size: sizes) {
+    CCpuRenderer reference(int(size.x), int(size.y));
+    CTiledCpuRenderer tiled(int(size.x), int(size.y), pool);
+
+    CRenderList lists[2];
+    for(int frame = 0; frame < sNumFrames; ++frame) {
+      auto& list = lists[frame % 2];
+      const auto& previous = lists[(frame + 1) % 2];
+      RecordScene(list, size, frame);
+
+      Rect2F dirty;
+      const auto isPartial = frame && list.Diff(previous, &dirty);
+      reference.Render(list, isPartial ? &dirty : nullptr);
+      tiled.Render(list, isPartial ? &dirty : nullptr);
+
+      int firstX = 0, firstY = 0;
+      const auto numMismatches = CountMismatches(reference, tiled, &firstX, &firstY);
+      char buf[160];
+      if(!numMismatches)
+        snprintf(buf, sizeof(buf), "%dx%d, frame %d (%s): identical\n", int(size.x), int(size.y), frame,
+          isPartial ? "partial" : "full");
+      else
+        snprintf(buf, sizeof(buf), "%dx%d, frame %d (%s): %u pixels differ, first at (%d,%d): %08X vs. %08X\n",
+          int(size.x), int(size.y), frame, isPartial ? "partial" : "full", unsigned(numMismatches), firstX, firstY,
+          reference.Pixel(firstX, firstY), tiled.Pixel(firstX, firstY));
+      *pReport += buf;
+      isEqual &= !numMismatches;
+    }
+  }
+  return isEqual;
+}
@@ -0,0 +1,12 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Renders the same frames with a single CCpuRenderer and with a
+// CTiledCpuRenderer and compares the pixels, which have to be identical.
+// Covers full frames and partial ones, at sizes that don't fit the tile grid.
+//
+// Returns whether all frames matched. pReport receives a line per frame.
+bool CompareCpuRenderers(std::string* pReport);
@@ -0,0 +1,305 @@
+// Copyright (c) v1ne
+
+#include "RenderList.h"
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+// Antialiasing may touch pixels just outside of the geometry
+static constexpr auto sBoundsMargin = 1.f;
+// Cells per side of the grid that occluders are binned into
+static constexpr size_t sOccluderGridSize = 16;
+
+
+uint64_t HashBytes(const void* pData, size_t size, uint64_t hash) {
+  // FNV-1a
+  const auto* pBytes = static_cast<const uint8_t*>(pData);
+  for(size_t i = 0; i < size; ++i) {
+    hash ^= pBytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+
+void CRenderList::Reset() {
+  // Keeps the capacity, so that steady-state recording doesn't allocate
+  mBuffer.clear();
+  mSpans.clear();
+  mTransform = Transform2F::Identity();
+  mIsInView = false;
+  mIsInLayer = false;
+}
+
+
+template<typename T> uint32_t CRenderList::Append(Op op, const T& payload) {
+  const auto offset = uint32_t(mBuffer.size());
+  const auto size = uint32_t((sizeof(Header) + sizeof(T) + 7) & ~size_t(7));
+  mBuffer.resize(offset + size, 0);
+
+  const auto header = Header{op, 0, size};
+  memcpy(mBuffer.data() + offset, &header, sizeof(header));
+  memcpy(mBuffer.data() + offset + sizeof(header), &payload, sizeof(payload));
+  return offset;
+}
+
+
+void CRenderList::AddBounds(const Rect2F& localRect) {
+  if(mIsInLayer)
+    return;
+
+  mViewBounds = Union(mViewBounds, (mTransform * mViewTransform).Apply(localRect).Inflated(sBoundsMargin));
+}
+
+
+// Keeps the largest opaque rect only, since the union of two isn't a rect
+void CRenderList::AddOpaqueBounds(const Rect2F& localRect, const Brush& brush) {
+  if(mIsInLayer || !brush.IsOpaque())
+    return;
+
+  // Antialiased edges aren't opaque
+  const auto opaqueRect = (mTransform * mViewTransform).ApplyInner(localRect).Inflated(-sBoundsMargin);
+  if(opaqueRect.Area() > mViewOpaqueBounds.Area())
+    mViewOpaqueBounds = opaqueRect;
+}
+
+
+void CRenderList::BeginView(const void* pView, const Transform2F& viewTransform) {
+  assert(!mIsInView);
+  mIsInView = true;
+  mpView = pView;
+  mViewTransform = viewTransform;
+  mViewBegin = Size();
+  mViewBounds = Rect2F::Empty();
+  mViewOpaqueBounds = Rect2F::Empty();
+  mTransform = Transform2F::Identity();
+}
+
+
+void CRenderList::EndView() {
+  assert(mIsInView && !mIsInLayer);
+  mIsInView = false;
+
+  // The view changes on screen if only its view transform changes
+  const auto end = Size();
+  const auto hash = HashBytes(mBuffer.data() + mViewBegin, end - mViewBegin,
+    HashBytes(&mViewTransform, sizeof(mViewTransform)));
+  mSpans.push_back({mpView, mViewBegin, end, hash, mViewBounds, mViewOpaqueBounds, mViewTransform});
+}
+
+
+void CRenderList::SetTransform(const Transform2F& transform) {
+  if(!mIsInLayer)
+    mTransform = transform;
+  Append(Op::SetTransform, SetTransformCmd{transform});
+}
+
+
+void CRenderList::FillRect(const Rect2F& rect, const Brush& brush) {
+  AddBounds(rect);
+  AddOpaqueBounds(rect, brush);
+  Append(Op::FillRect, FillRectCmd{rect, brush});
+}
+
+
+void CRenderList::FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush) {
+  AddBounds(rect);
+  // The corners of this rect lie on the arcs, at 45 degrees
+  const auto inset = radius * (1.f - 0.70710678f);
+  AddOpaqueBounds(Rect2F::FromPoints(rect.TopLeft() + inset, rect.BottomRight() - inset), brush);
+  Append(Op::FillRoundedRect, FillRoundedRectCmd{rect, radius, brush});
+}
+
+
+void CRenderList::FillEllipse(Point2F center, Point2F radius, const Brush& brush) {
+  AddBounds(Rect2F::FromPoints(center - radius, center + radius));
+  AddOpaqueBounds(Rect2F::FromPoints(center - radius * 0.70710678f, center + radius * 0.70710678f), brush);
+  Append(Op::FillEllipse, FillEllipseCmd{center, radius, brush});
+}
+
+
+void CRenderList::FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush) {
+  Point2F corners[4];
+  TiltedRectCorners(base, distance, degAngle, size, corners);
+  AddBounds(Rect2F::BoundsOf(corners, 4).Inflated(0.5f));
+
+  Append(Op::FillTiltedRect, FillTiltedRectCmd{base, distance, degAngle, size, brush});
+}
+
+
+void CRenderList::Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text) {
+  AddBounds(rect);
+
+  auto cmd = TextCmd{rect, style, brush, {}};
+  strncpy(cmd.text, text, sizeof(cmd.text) - 1);
+  Append(Op::Text, cmd);
+}
+
+
+void CRenderList::BeginLayer(const BeginLayerCmd& cmd) {
+  assert(!mIsInLayer);
+
+  // Layers are placed in view coordinates, regardless of the current transform
+  if(cmd.hasRegion)
+    mViewBounds = Union(mViewBounds, mViewTransform.Apply(cmd.destRect).Inflated(sBoundsMargin));
+  else {
+    const auto layerTransform = Transform2F::Translation(cmd.center - cmd.size / 2.f)
+      * Transform2F::Rotation(cmd.degAngle, cmd.center);
+    mViewBounds = Union(mViewBounds, (layerTransform * mViewTransform).Apply(
+      Rect2F::FromPoints({}, cmd.size)).Inflated(sBoundsMargin));
+  }
+
+  mLayerBegin = Append(Op::BeginLayer, cmd);
+  mIsInLayer = true;
+}
+
+
+void CRenderList::BeginLayer(const void* pOwner, unsigned int slot, Point2F size, float degAngle, Point2F center) {
+  auto cmd = BeginLayerCmd{};
+  cmd.owner = uint64_t(uintptr_t(pOwner));
+  cmd.slot = slot;
+  cmd.size = size;
+  cmd.degAngle = degAngle;
+  cmd.center = center;
+  BeginLayer(cmd);
+}
+
+
+void CRenderList::BeginLayer(const void* pOwner, unsigned int slot, Point2F size,
+    const Rect2F& sourceRect, const Rect2F& destRect) {
+  auto cmd = BeginLayerCmd{};
+  cmd.owner = uint64_t(uintptr_t(pOwner));
+  cmd.slot = slot;
+  cmd.size = size;
+  cmd.hasRegion = 1;
+  cmd.sourceRect = sourceRect;
+  cmd.destRect = destRect;
+  BeginLayer(cmd);
+}
+
+
+void CRenderList::EndLayer() {
+  assert(mIsInLayer);
+  mIsInLayer = false;
+
+  const auto end = Append(Op::EndLayer, EmptyCmd{});
+
+  // Patch the content hash and the end offset into the BeginLayer command.
+  // The offset is relative, so that the hash of the view doesn't depend on
+  // where it is in the buffer.
+  auto* pBegin = reinterpret_cast<BeginLayerCmd*>(mBuffer.data() + mLayerBegin + sizeof(Header));
+  const auto contentBegin = Next(mLayerBegin);
+  pBegin->end = end - mLayerBegin;
+  pBegin->contentHash = HashBytes(mBuffer.data() + contentBegin, end - contentBegin);
+}
+
+
+void CRenderList::BeginProfile(ProfileScope scope) {
+  Append(Op::BeginProfile, ProfileCmd{scope});
+}
+
+
+void CRenderList::EndProfile() {
+  Append(Op::EndProfile, EmptyCmd{});
+}
+
+
+void CRenderList::AppendViews(const CRenderList& other) {
+  assert(!mIsInView && !other.mIsInView);
+
+  // Commands don't contain absolute offsets, so they can be copied as they are
+  const auto base = Size();
+  mBuffer.insert(mBuffer.end(), other.mBuffer.begin(), other.mBuffer.end());
+  for(const auto& span: other.mSpans)
+    mSpans.push_back({span.pView, base + span.begin, base + span.end, span.hash, span.bounds, span.opaqueBounds,
+      span.transform});
+}
+
+
+Rect2F CRenderList::Bounds() const {
+  auto bounds = Rect2F::Empty();
+  for(const auto& span: mSpans)
+    bounds = Union(bounds, span.bounds);
+  return bounds;
+}
+
+
+bool CRenderList::Diff(const CRenderList& previous, Rect2F* pDirty) const {
+  auto dirty = Rect2F::Empty();
+  auto didChange = mSpans.size() != previous.mSpans.size();
+
+  const auto numSpans = mSpans.size() > previous.mSpans.size() ? mSpans.size() : previous.mSpans.size();
+  for(size_t i = 0; i < numSpans; ++i) {
+    const auto* pSpan = i < mSpans.size() ? &mSpans[i] : nullptr;
+    const auto* pPreviousSpan = i < previous.mSpans.size() ? &previous.mSpans[i] : nullptr;
+    if(pSpan && pPreviousSpan && pSpan->pView == pPreviousSpan->pView && pSpan->hash == pPreviousSpan->hash)
+      continue;
+
+    didChange = true;
+    if(pSpan) dirty = Union(dirty, pSpan->bounds);
+    if(pPreviousSpan) dirty = Union(dirty, pPreviousSpan->bounds);
+  }
+
+  *pDirty = dirty;
+  return didChange;
+}
+
+
+void CRenderList::FindVisibleSpans(const Rect2F& viewport, VisibleSpans* pResult) const {
+  auto& indices = pResult->indices;
+  auto& cells = pResult->occluderCells;
+  indices.clear();
+  cells.resize(sOccluderGridSize * sOccluderGridSize);
+  for(auto& cell: cells)
+    cell.clear();
+  pResult->numCulled = 0;
+
+  // Points outside of the viewport fall into the cells at its edges. As this
+  // is monotonic, an occluder that contains a point is always binned into
+  // the cell of the point.
+  const auto viewportSize = viewport.Size();
+  const auto cellsPerPoint = Point2F{viewportSize.x > 0 ? sOccluderGridSize / viewportSize.x : 0.f,
+    viewportSize.y > 0 ? sOccluderGridSize / viewportSize.y : 0.f};
+  const auto cellOf = [](float pos, float begin, float scale) {
+    const auto index = int((pos - begin) * scale);
+    return size_t(index < 0 ? 0 : index < int(sOccluderGridSize) ? index : int(sOccluderGridSize) - 1);
+  };
+
+  // Walk from front to back, collecting the opaque bounds of what's above.
+  // Only spans that are drawn become occluders, but a culled span is covered
+  // by one of them anyway.
+  for(auto i = mSpans.size(); i-- > 0;) {
+    const auto& span = mSpans[i];
+    auto isVisible = span.bounds.Intersects(viewport);
+    if(isVisible) {
+      const auto center = (span.bounds.TopLeft() + span.bounds.BottomRight()) / 2.f;
+      const auto& cell = cells[cellOf(center.y, viewport.top, cellsPerPoint.y) * sOccluderGridSize
+        + cellOf(center.x, viewport.left, cellsPerPoint.x)];
+      for(size_t j = 0; isVisible && j < cell.size(); ++j)
+        isVisible = !cell[j].Contains(span.bounds);
+    }
+
+    if(!isVisible) {
+      ++pResult->numCulled;
+      continue;
+    }
+
+    indices.push_back(uint32_t(i));
+    const auto& opaque = span.opaqueBounds;
+    if(opaque.IsEmpty())
+      continue;
+
+    const auto firstColumn = cellOf(opaque.left, viewport.left, cellsPerPoint.x);
+    const auto lastColumn = cellOf(opaque.right, viewport.left, cellsPerPoint.x);
+    const auto firstRow = cellOf(opaque.top, viewport.top, cellsPerPoint.y);
+    const auto lastRow = cellOf(opaque.bottom, viewport.top, cellsPerPoint.y);
+    for(auto row = firstRow; row <= lastRow; ++row) {
+      for(auto column = firstColumn; column <= lastColumn; ++column)
+        cells[row * sOccluderGridSize + column].push_back(opaque);
+    }
+  }
+
+  std::reverse(indices.begin(), indices.end());
+}
@@ -0,0 +1,218 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "Geometry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Brushes that views can paint with. They're resolved by the renderer.
+enum class BrushId : uint32_t {
+  Black,
+  White,
+  LightGrey,
+  DarkGrey,
+  DimGrey,
+  Cornflower,
+  SomePinkishBlue,
+  SomeGreenish,
+  SomeOrangish,
+  SomeReddish,
+  SemitransparentDark,
+  // Linear gradients, which need start and end points
+  GradientGlossy,
+  GradientBlue,
+  GradientOrange,
+  GradientRed,
+  GradientGreen,
+  GradientBackground,
+};
+
+struct Brush {
+// data members:
+  BrushId id;
+  Point2F start;
+  Point2F end;
+// end data members
+
+  Brush(BrushId id_) : id(id_) {}
+  Brush(BrushId id_, Point2F start_, Point2F end_) : id(id_), start(start_), end(end_) {}
+
+  bool IsGradient() const { return id >= BrushId::GradientGlossy; }
+  bool IsOpaque() const { return id != BrushId::SemitransparentDark && id != BrushId::GradientGlossy; }
+};
+
+enum class TextStyle : uint32_t {Small, Medium};
+
+// Parts of a frame whose replay time is measured by the renderer
+enum class ProfileScope : uint32_t {GhostScaleDirect, GhostScaleStrip, Count};
+
+
+// Records the draw commands of a frame into a flat buffer, so that frames can
+// be compared with each other and replayed later on.
+//
+// The commands of each view are kept in a span, which also tracks the bounds
+// of everything that the view draws and a hash of its commands. Its opaque
+// bounds are a rect that the view is known to cover completely, which lets
+// the renderer skip views hidden below it.
+//
+// Views paint in their own coordinates. The view transform that's given to
+// BeginView maps them into the frame, e.g. to zoom and pan a canvas. Bounds
+// are kept in frame coordinates.
+//
+// A layer is a group of commands which the renderer may cache as a bitmap.
+// Commands within a layer use layer coordinates, with (0,0) being the top-left
+// corner of the unrotated layer. The layer itself is placed in view
+// coordinates, i.e. the current transform doesn't apply to it.
+class CRenderList {
+public:
+  enum class Op : uint16_t {
+    SetTransform,
+    FillRect,
+    FillRoundedRect,
+    FillEllipse,
+    FillTiltedRect,
+    Text,
+    BeginLayer,
+    EndLayer,
+    BeginProfile,
+    EndProfile,
+  };
+
+  // Command payloads. They have no padding, so that they can be hashed as bytes.
+  struct SetTransformCmd { Transform2F transform; };
+  struct FillRectCmd { Rect2F rect; Brush brush; };
+  struct FillRoundedRectCmd { Rect2F rect; Point2F radius; Brush brush; };
+  struct FillEllipseCmd { Point2F center; Point2F radius; Brush brush; };
+  struct FillTiltedRectCmd { Point2F base; float distance; float degAngle; Point2F size; Brush brush; };
+  struct TextCmd { Rect2F rect; TextStyle style; Brush brush; char text[16]; };
+  struct BeginLayerCmd {
+    uint64_t owner;
+    uint32_t slot;
+    // Offset of the matching EndLayer command, relative to this one
+    uint32_t end;
+    // Hash of the commands within the layer
+    uint64_t contentHash;
+    Point2F size;
+    float degAngle;
+    // Either the layer is drawn centered at `center`, or the part of it
+    // within sourceRect is stretched into destRect.
+    uint32_t hasRegion;
+    Point2F center;
+    Rect2F sourceRect;
+    Rect2F destRect;
+  };
+  struct ProfileCmd { ProfileScope scope; };
+  struct EmptyCmd { uint32_t reserved; };
+
+  struct Header {
+    Op op;
+    uint16_t reserved;
+    // Including the header
+    uint32_t size;
+  };
+
+  struct Span {
+    const void* pView;
+    uint32_t begin;
+    uint32_t end;
+    uint64_t hash;
+    Rect2F bounds;
+    Rect2F opaqueBounds;
+    // From view to frame coordinates. The replay starts out with it.
+    Transform2F transform;
+  };
+
+  void Reset();
+
+  // Recording
+  void BeginView(const void* pView, const Transform2F& viewTransform = Transform2F::Identity());
+  void EndView();
+  // The view transform of the view that's being recorded
+  const Transform2F& ViewTransform() const { return mViewTransform; }
+  // Views choose their level of detail as if their size on screen was scaled
+  // by this. It's below 1 to shed load. Kept across Reset.
+  void SetDetailScale(float detailScale) { mDetailScale = detailScale; }
+  float DetailScale() const { return mDetailScale; }
+
+  void SetTransform(const Transform2F& transform);
+  // The transform set last, outside of layers
+  const Transform2F& CurrentTransform() const { return mTransform; }
+  void FillRect(const Rect2F& rect, const Brush& brush);
+  void FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush);
+  void FillEllipse(Point2F center, Point2F radius, const Brush& brush);
+  void FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush);
+  void Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text);
+
+  void BeginLayer(const void* pOwner, unsigned int slot, Point2F size, float degAngle, Point2F center);
+  void BeginLayer(const void* pOwner, unsigned int slot, Point2F size, const Rect2F& sourceRect, const Rect2F& destRect);
+  void EndLayer();
+
+  void BeginProfile(ProfileScope scope);
+  void EndProfile();
+
+  // Appends the views of another list after the views of this one, as if
+  // they had been recorded here
+  void AppendViews(const CRenderList& other);
+
+  // Inspection
+  const std::vector<Span>& Spans() const { return mSpans; }
+  uint32_t Size() const { return uint32_t(mBuffer.size()); }
+  bool IsEmpty() const { return mSpans.empty(); }
+  Rect2F Bounds() const;
+
+  const Header& HeaderAt(uint32_t offset) const {
+    return *reinterpret_cast<const Header*>(mBuffer.data() + offset);
+  }
+
+  template<typename T> const T& PayloadAt(uint32_t offset) const {
+    return *reinterpret_cast<const T*>(mBuffer.data() + offset + sizeof(Header));
+  }
+
+  uint32_t Next(uint32_t offset) const { return offset + HeaderAt(offset).size; }
+
+  // Returns whether this frame differs from `previous`. If so, pDirty
+  // receives the bounds of the views that changed, in both frames.
+  bool Diff(const CRenderList& previous, Rect2F* pDirty) const;
+
+  struct VisibleSpans {
+    // In recording order
+    std::vector<uint32_t> indices;
+    size_t numCulled = 0;
+    // Scratch space, kept so that culling doesn't allocate. The opaque bounds
+    // found so far, binned into a coarse grid over the viewport.
+    std::vector<std::vector<Rect2F>> occluderCells;
+  };
+
+  // Finds the spans that are visible within viewport. A span is culled if it
+  // lies outside of the viewport or if it's covered by the opaque bounds of a
+  // span above it. Only the occluders in the grid cell of a span's center are
+  // tested, which keeps this linear in the number of spans.
+  void FindVisibleSpans(const Rect2F& viewport, VisibleSpans* pResult) const;
+
+private:
+  template<typename T> uint32_t Append(Op op, const T& payload);
+  void AddBounds(const Rect2F& localRect);
+  void AddOpaqueBounds(const Rect2F& localRect, const Brush& brush);
+  void BeginLayer(const BeginLayerCmd& cmd);
+
+  // Commands are 8-byte aligned, so that payloads can be read in place
+  std::vector<uint8_t> mBuffer;
+  std::vector<Span> mSpans;
+
+  Transform2F mTransform = Transform2F::Identity();
+  bool mIsInView = false;
+  const void* mpView = nullptr;
+  Transform2F mViewTransform = Transform2F::Identity();
+  float mDetailScale = 1.f;
+  Rect2F mViewBounds = Rect2F::Empty();
+  Rect2F mViewOpaqueBounds = Rect2F::Empty();
+  uint32_t mViewBegin = 0;
+  // Offset of the current BeginLayer command, if any
+  uint32_t mLayerBegin = 0;
+  bool mIsInLayer = false;
+};
+
+uint64_t HashBytes(const void* pData, size_t size, uint64_t hash = 14695981039346656037ull);
@@ -0,0 +1,224 @@
+// Copyright (c) v1ne
+
+#include "RenderThread.h"
+
+#include "StartupTimeline.h"
+
+// How often the counters are logged
+static constexpr ULONGLONG sStatsIntervalMs = 1000;
+
+CRenderThread::CRenderThread(HWND hWnd, CD2DDriver* pD2dDriver, CRenderer* pRenderer,
+    CFrameGovernor* pFrameGovernor)
+  : mhWnd(hWnd)
+  , mD2dDriver(pD2dDriver)
+  , mpRenderer(pRenderer)
+  , mpFrameGovernor(pFrameGovernor)
+  , mhWakeUp(::CreateEventW(nullptr, FALSE, FALSE, nullptr))
+{
+  mStats.startTime = ::GetTickCount64();
+  mThread = std::thread(&CRenderThread::ThreadMain, this);
+}
+
+
+CRenderThread::~CRenderThread() {
+  mIsQuitting = true;
+  ::SetEvent(mhWakeUp);
+  mThread.join();
+  ::CloseHandle(mhWakeUp);
+}
+
+
+void CRenderThread::Publish() {
+  if(!mSnapshots.Publish())
+    ++mStats.numDropped;
+  ++mStats.numPublished;
+  ::SetEvent(mhWakeUp);
+}
+
+
+void CRenderThread::RequestRedraw() {
+  mIsRedrawRequested = true;
+  ::SetEvent(mhWakeUp);
+}
+
+
+void CRenderThread::RequestProfileReport() {
+  mIsProfileReportRequested = true;
+  ::SetEvent(mhWakeUp);
+}
+
+
+void CRenderThread::SimulateDeviceLoss() {
+  mIsDeviceLossSimulated = true;
+  ::SetEvent(mhWakeUp);
+}
+
+
+void CRenderThread::ThreadMain() {
+  // Be ready by the time the first snapshot arrives
+  const auto begin = CStartupTimeline::Clock::now();
+  if(SUCCEEDED(mD2dDriver->CreateDeviceResources()))
+    gStartupTimeline.Record("Device resources", begin);
+
+  for(;;) {
+    ::WaitForSingleObject(mhWakeUp, INFINITE);
+    if(mIsQuitting)
+      return;
+
+    const auto hasNewSnapshot = mSnapshots.TakeLatest();
+    auto isRedrawRequested = mIsRedrawRequested.exchange(false);
+    if(mIsDeviceLossSimulated.exchange(false)) {
+      mD2dDriver->DiscardDeviceResources();
+      OnFrameFailed();
+      isRedrawRequested = true;
+    }
+    if(isRedrawRequested)
+      mPresentedList.Reset();
+    if(hasNewSnapshot || isRedrawRequested)
+      RenderLatest();
+
+    if(mIsProfileReportRequested.exchange(false))
+      ReportProfileStats();
+    LogStats();
+  }
+}
+
+
+void CRenderThread::RenderLatest() {
+  const auto& snapshot = mSnapshots.Front();
+  if(snapshot.physicalClientArea.x <= 0 || snapshot.physicalClientArea.y <= 0)
+    return;
+
+  if(FAILED(mD2dDriver->CreateDeviceResources()))
+    return;
+
+  auto pTarget = mD2dDriver->GetRenderTarget();
+  const auto size = D2D1::SizeU(UINT32(snapshot.physicalClientArea.x), UINT32(snapshot.physicalClientArea.y));
+  const auto targetSize = pTarget->GetPixelSize();
+  if(targetSize.width != size.width || targetSize.height != size.height) {
+    mPresentedList.Reset();
+    if(FAILED(pTarget->Resize(size))) {
+      // Try again with new device resources once the window is painted
+      mD2dDriver->DiscardDeviceResources();
+      OnFrameFailed();
+      ::InvalidateRect(mhWnd, NULL, FALSE);
+      return;
+    }
+  }
+
+  if(pTarget->CheckWindowState() & D2D1_WINDOW_STATE_OCCLUDED) {
+    // Whatever is on screen now, it's not the presented frame anymore
+    mPresentedList.Reset();
+    return;
+  }
+
+  auto isFullFrame = mPresentedList.IsEmpty();
+  Rect2F dirty;
+  if(!isFullFrame) {
+    if(!snapshot.list.Diff(mPresentedList, &dirty) || dirty.IsEmpty()) {
+      ++mStats.numUnchanged;
+      return;
+    }
+
+    const auto clientRect = Rect2F::FromPoints({},
+      Point2F(snapshot.physicalClientArea) / snapshot.physicalPointsPerLogicalPoint);
+    isFullFrame = dirty.Contains(clientRect);
+  }
+
+  const auto success = mpRenderer->Render(snapshot.list, isFullFrame ? nullptr : &dirty);
+  ++(isFullFrame ? mStats.numFull : mStats.numPartial);
+  const auto layerStats = mD2dDriver->LayerCache().CurrentFrameStats();
+  mStats.layers.hits += layerStats.hits;
+  mStats.layers.misses += layerStats.misses;
+  mStats.layers.evictions += layerStats.evictions;
+  mStats.layers.bytesInUse = layerStats.bytesInUse;
+  mpFrameGovernor->OnFrameRendered(std::chrono::nanoseconds(mpRenderer->LastReplayNanoseconds()));
+
+  if(!success) {
+    // The device may have been lost, so draw everything again
+    mPresentedList.Reset();
+    ::InvalidateRect(mhWnd, NULL, FALSE);
+    OnFrameFailed();
+  } else {
+    mPresentedList = snapshot.list;
+    OnFramePresented();
+    if(!mHasPresentedFrame) {
+      mHasPresentedFrame = true;
+      gStartupTimeline.Log();
+    }
+  }
+}
+
+
+void CRenderThread::OnFrameFailed() {
+  if(mIsRecovering)
+    return;
+
+  mIsRecovering = true;
+  mFailureTime = std::chrono::steady_clock::now();
+}
+
+
+// Logs the time to the first frame after a device loss, which includes
+// creating the render target and all registered resources
+void CRenderThread::OnFramePresented() {
+  if(!mIsRecovering)
+    return;
+
+  mIsRecovering = false;
+  const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - mFailureTime).count();
+  const auto& resources = mD2dDriver->Resources();
+  char buf[160];
+  wsprintfA(buf, "Recovered after %d us, with %u resources rebuilt for device generation %u\n",
+    int(microseconds), unsigned(resources.NumResources()), resources.DeviceGeneration());
+  ::OutputDebugStringA(buf);
+}
+
+
+void CRenderThread::ReportProfileStats() {
+  for(const auto scope: {ProfileScope::GhostScaleDirect, ProfileScope::GhostScaleStrip}) {
+    const auto stats = mpRenderer->TakeProfileStats(scope);
+    if(!stats.numFrames)
+      continue;
+
+    const auto averageMicroseconds = int(stats.nanoseconds / 1000 / stats.numFrames);
+    char buf[128];
+    wsprintfA(buf, "Ghost scale (%s): %u frames, %d us on average\n",
+      scope == ProfileScope::GhostScaleDirect ? "direct" : "strip", stats.numFrames, averageMicroseconds);
+    ::OutputDebugStringA(buf);
+  }
+}
+
+
+void CRenderThread::LogStats() {
+  const auto now = ::GetTickCount64();
+  const auto elapsedMs = now - mStats.startTime;
+  if(elapsedMs < sStatsIntervalMs)
+    return;
+
+  const auto numPublished = mStats.numPublished.exchange(0);
+  const auto numDropped = mStats.numDropped.exchange(0);
+  const auto numRendered = mStats.numPartial + mStats.numFull;
+  const auto cullStats = mpRenderer->TakeCullStats();
+  if(numPublished || numRendered) {
+    char buf[256];
+    wsprintfA(buf, "Snapshots: %u published, %u dropped; frames: %u rendered (%u partial, %u full), "
+      "%u unchanged; views: %u drawn, %u culled; in %u ms\n", numPublished, numDropped, numRendered,
+      mStats.numPartial, mStats.numFull, mStats.numUnchanged, cullStats.numDrawn, cullStats.numCulled,
+      unsigned(elapsedMs));
+    ::OutputDebugStringA(buf);
+  }
+  if(mStats.layers.hits || mStats.layers.misses) {
+    char buf[128];
+    wsprintfA(buf, "Layers: %u hits, %u misses, %u evicted; %u KB in use\n", mStats.layers.hits,
+      mStats.layers.misses, mStats.layers.evictions, unsigned(mStats.layers.bytesInUse / 1024));
+    ::OutputDebugStringA(buf);
+  }
+
+  mStats.numPartial = 0;
+  mStats.numFull = 0;
+  mStats.numUnchanged = 0;
+  mStats.layers = CLayerCache::FrameStats();
+  mStats.startTime = now;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "D2DDriver.h"
+#include "FrameGovernor.h"
+#include "RenderList.h"
+#include "Renderer.h"
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// A recorded frame, along with what's needed to put it into the window
+struct FrameSnapshot {
+  CRenderList list;
+  Point2I physicalClientArea;
+  float physicalPointsPerLogicalPoint = 1.f;
+};
+
+// Draws frames into the window on a thread of its own, so that a slow frame
+// doesn't hold up input handling and MIDI output. The input thread publishes
+// snapshots, and the render thread draws the latest one whenever it's idle.
+// Snapshots that are replaced before they're drawn are dropped.
+//
+// Once started, only the render thread touches the render target and the
+// renderer.
+class CRenderThread {
+public:
+  // The governor is told how long frames take to replay
+  CRenderThread(HWND hWnd, CD2DDriver* pD2dDriver, CRenderer* pRenderer, CFrameGovernor* pFrameGovernor);
+  ~CRenderThread();
+
+  // Input thread. Fill in BackSnapshot(), then publish it. Doesn't block.
+  FrameSnapshot& BackSnapshot() { return mSnapshots.Back(); }
+  void Publish();
+
+  // Draws the whole window again, e.g. after it was uncovered
+  void RequestRedraw();
+  // Logs the time spent in the profiled parts of the frames so far
+  void RequestProfileReport();
+  // Releases all device resources, as if the device was lost, to measure
+  // how long it takes until a frame is on screen again
+  void SimulateDeviceLoss();
+
+private:
+  void ThreadMain();
+  void RenderLatest();
+  void OnFrameFailed();
+  void OnFramePresented();
+  void ReportProfileStats();
+  void LogStats();
+
+  HWND mhWnd;
+  CD2DDriver* mD2dDriver;
+  CRenderer* mpRenderer;
+  CFrameGovernor* mpFrameGovernor;
+
+  CTripleBuffer<FrameSnapshot> mSnapshots;
+  // Render thread. What's in the window now, if it's known.
+  CRenderList mPresentedList;
+
+  HANDLE mhWakeUp;
+  std::atomic<bool> mIsRedrawRequested{false};
+  std::atomic<bool> mIsProfileReportRequested{false};
+  std::atomic<bool> mIsDeviceLossSimulated{false};
+  std::atomic<bool> mIsQuitting{false};
+
+  // Set from the first frame that couldn't be presented until one is
+  bool mIsRecovering = false;
+  bool mHasPresentedFrame = false;
+  std::chrono::steady_clock::time_point mFailureTime;
+
+  struct Stats {
+    // Written by the input thread
+    std::atomic<unsigned int> numPublished{0};
+    std::atomic<unsigned int> numDropped{0};
+    // Written by the render thread
+    unsigned int numPartial = 0;
+    unsigned int numFull = 0;
+    unsigned int numUnchanged = 0;
+    CLayerCache::FrameStats layers;
+    ULONGLONG startTime = 0;
+  } mStats;
+
+  std::thread mThread;
+};
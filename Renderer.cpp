@@ -0,0 +1,176 @@
+// Copyright (c) v1ne
+
+#include "Renderer.h"
+
+#include <chrono>
+
+static uint64_t NowNanoseconds() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+bool CRenderer::Render(const CRenderList& list, const Rect2F* pDirty) {
+  if(!BeginDraw())
+    return false;
+
+  const auto replayStart = NowNanoseconds();
+
+  SetTransform(Transform2F::Identity());
+  if(pDirty)
+    PushClip(*pDirty);
+  Clear();
+
+  list.FindVisibleSpans(pDirty ? Intersection(*pDirty, Viewport()) : Viewport(), &mVisibleSpans);
+  mCullStats.numDrawn += unsigned(mVisibleSpans.indices.size());
+  mCullStats.numCulled += unsigned(mVisibleSpans.numCulled);
+
+  const auto& spans = list.Spans();
+  for(const auto index: mVisibleSpans.indices) {
+    // Each view starts out with its view transform
+    Replay(list, spans[index].begin, spans[index].end, spans[index].transform);
+  }
+
+  SetTransform(Transform2F::Identity());
+  if(pDirty)
+    PopClip();
+  mLastReplayNanoseconds = NowNanoseconds() - replayStart;
+  return EndDraw();
+}
+
+
+bool CRenderer::RenderSpans(const CRenderList& list, const uint32_t* pSpanIndices, size_t numSpans,
+    const Rect2F& clip) {
+  if(!BeginDraw())
+    return false;
+
+  const auto replayStart = NowNanoseconds();
+
+  SetTransform(Transform2F::Identity());
+  PushClip(clip);
+  Clear();
+
+  const auto& spans = list.Spans();
+  for(size_t i = 0; i < numSpans; ++i) {
+    const auto& span = spans[pSpanIndices[i]];
+    Replay(list, span.begin, span.end, span.transform);
+  }
+
+  SetTransform(Transform2F::Identity());
+  PopClip();
+  mLastReplayNanoseconds = NowNanoseconds() - replayStart;
+  return EndDraw();
+}
+
+
+void CRenderer::Replay(const CRenderList& list, uint32_t begin, uint32_t end, const Transform2F& base) {
+  using Op = CRenderList::Op;
+
+  // The transform of the commands, which layers leave as it was
+  auto transform = base;
+  SetTransform(transform);
+  for(auto offset = begin; offset < end; offset = list.Next(offset)) {
+    switch(list.HeaderAt(offset).op) {
+    case Op::SetTransform: {
+      const auto& cmd = list.PayloadAt<CRenderList::SetTransformCmd>(offset);
+      transform = cmd.transform * base;
+      SetTransform(transform);
+      break; }
+
+    case Op::FillRect: {
+      const auto& cmd = list.PayloadAt<CRenderList::FillRectCmd>(offset);
+      FillRect(cmd.rect, cmd.brush);
+      break; }
+
+    case Op::FillRoundedRect: {
+      const auto& cmd = list.PayloadAt<CRenderList::FillRoundedRectCmd>(offset);
+      FillRoundedRect(cmd.rect, cmd.radius, cmd.brush);
+      break; }
+
+    case Op::FillEllipse: {
+      const auto& cmd = list.PayloadAt<CRenderList::FillEllipseCmd>(offset);
+      FillEllipse(cmd.center, cmd.radius, cmd.brush);
+      break; }
+
+    case Op::FillTiltedRect: {
+      const auto& cmd = list.PayloadAt<CRenderList::FillTiltedRectCmd>(offset);
+      FillTiltedRect(cmd.base, cmd.distance, cmd.degAngle, cmd.size, cmd.brush);
+      break; }
+
+    case Op::Text: {
+      const auto& cmd = list.PayloadAt<CRenderList::TextCmd>(offset);
+      Text(cmd.rect, cmd.style, cmd.brush, cmd.text);
+      break; }
+
+    case Op::BeginLayer: {
+      ReplayLayer(list, offset, base);
+      // Like CRenderList, which tracks the bounds of the commands after the
+      // layer with the transform from before it
+      SetTransform(transform);
+      // Continue after the matching EndLayer
+      offset += list.PayloadAt<CRenderList::BeginLayerCmd>(offset).end;
+      break; }
+
+    case Op::EndLayer:
+      break;
+
+    case Op::BeginProfile:
+      mActiveProfile = list.PayloadAt<CRenderList::ProfileCmd>(offset).scope;
+      mProfileStart = NowNanoseconds();
+      break;
+
+    case Op::EndProfile:
+      if(mActiveProfile != ProfileScope::Count) {
+        auto& stats = mProfileStats[size_t(mActiveProfile)];
+        stats.numFrames++;
+        stats.nanoseconds += NowNanoseconds() - mProfileStart;
+        mActiveProfile = ProfileScope::Count;
+      }
+      break;
+    }
+  }
+}
+
+
+// Composites a layer from the backend's cache. If it can't be cached, its
+// content is replayed directly.
+void CRenderer::ReplayLayer(const CRenderList& list, uint32_t offset, const Transform2F& base) {
+  if(!DrawCachedLayer(list, offset, base)) {
+    const auto& cmd = list.PayloadAt<CRenderList::BeginLayerCmd>(offset);
+    const auto contentBegin = list.Next(offset);
+    const auto contentEnd = offset + cmd.end;
+
+    if(!cmd.hasRegion) {
+      const auto layerTransform = Transform2F::Translation(cmd.center - cmd.size / 2.f)
+        * Transform2F::Rotation(cmd.degAngle, cmd.center);
+      Replay(list, contentBegin, contentEnd, layerTransform * base);
+    } else {
+      // Stretch the part within sourceRect into destRect, like a bitmap would be
+      const auto sourceSize = cmd.sourceRect.Size();
+      const auto destSize = cmd.destRect.Size();
+      const auto layerTransform = Transform2F::Translation(Point2F{} - cmd.sourceRect.TopLeft())
+        * Transform2F::Scale({destSize.x / sourceSize.x, destSize.y / sourceSize.y})
+        * Transform2F::Translation(cmd.destRect.TopLeft());
+
+      SetTransform(base);
+      PushClip(cmd.destRect);
+      Replay(list, contentBegin, contentEnd, layerTransform * base);
+      SetTransform(base);
+      PopClip();
+    }
+  }
+}
+
+
+CRenderer::CullStats CRenderer::TakeCullStats() {
+  const auto stats = mCullStats;
+  mCullStats = {};
+  return stats;
+}
+
+
+CRenderer::ProfileStats CRenderer::TakeProfileStats(ProfileScope scope) {
+  const auto stats = mProfileStats[size_t(scope)];
+  mProfileStats[size_t(scope)] = {};
+  return stats;
+}
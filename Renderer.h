@@ -0,0 +1,86 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "Geometry.h"
+#include "RenderList.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Replays recorded frames. Backends implement the drawing primitives, this
+// class walks the command list and takes care of layers, clipping and profiling.
+//
+// It doesn't depend on Windows, so that frames can be rendered headless.
+class CRenderer {
+public:
+  struct ProfileStats {
+    unsigned int numFrames = 0;
+    uint64_t nanoseconds = 0;
+  };
+
+  struct CullStats {
+    unsigned int numDrawn = 0;
+    unsigned int numCulled = 0;
+  };
+
+  virtual ~CRenderer() {}
+
+  // Replays a recorded frame. If pDirty is given, only the views that touch
+  // it are replayed and everything outside of it is left as it is. Views that
+  // are off-screen or hidden below opaque views aren't replayed at all.
+  // Returns false if the frame couldn't be presented.
+  bool Render(const CRenderList& list, const Rect2F* pDirty);
+
+  // Replays only the given spans, in the given order, clipped to `clip`
+  bool RenderSpans(const CRenderList& list, const uint32_t* pSpanIndices, size_t numSpans, const Rect2F& clip);
+
+  // Returns the time spent replaying the scope since the last call
+  ProfileStats TakeProfileStats(ProfileScope scope);
+  // Returns how many views were drawn and culled since the last call
+  CullStats TakeCullStats();
+  // How long the last frame took to replay, without waiting for it to be presented
+  uint64_t LastReplayNanoseconds() const { return mLastReplayNanoseconds; }
+
+protected:
+  virtual bool BeginDraw() = 0;
+  virtual bool EndDraw() = 0;
+
+  // Clears everything within the current clip to white
+  virtual void Clear() = 0;
+
+  // The area of the target, in frame coordinates. Only valid while drawing.
+  virtual Rect2F Viewport() const = 0;
+
+  virtual void SetTransform(const Transform2F& transform) = 0;
+  virtual void FillRect(const Rect2F& rect, const Brush& brush) = 0;
+  virtual void FillRoundedRect(const Rect2F& rect, Point2F radius, const Brush& brush) = 0;
+  virtual void FillEllipse(Point2F center, Point2F radius, const Brush& brush) = 0;
+  virtual void FillTiltedRect(Point2F base, float distance, float degAngle, Point2F size, const Brush& brush) = 0;
+  virtual void Text(const Rect2F& rect, TextStyle style, const Brush& brush, const char* text) = 0;
+
+  // Clips to the axis-aligned bounds of rect under the current transform
+  virtual void PushClip(const Rect2F& rect) = 0;
+  virtual void PopClip() = 0;
+
+  // Composites a cached bitmap of the layer at `offset`. If this returns
+  // false, the commands of the layer are replayed instead.
+  virtual bool DrawCachedLayer(const CRenderList& /*list*/, uint32_t /*offset*/, const Transform2F& /*base*/) {
+    return false;
+  }
+
+  // Replays the commands in [begin, end), with all transforms applied on top of `base`
+  void Replay(const CRenderList& list, uint32_t begin, uint32_t end, const Transform2F& base);
+
+private:
+  // Leaves the transform of the backend undefined
+  void ReplayLayer(const CRenderList& list, uint32_t offset, const Transform2F& base);
+
+  CRenderList::VisibleSpans mVisibleSpans;
+  CullStats mCullStats;
+  uint64_t mLastReplayNanoseconds = 0;
+
+  ProfileStats mProfileStats[size_t(ProfileScope::Count)];
+  ProfileScope mActiveProfile = ProfileScope::Count;
+  uint64_t mProfileStart = 0;
+};
@@ -0,0 +1,56 @@
+// Copyright (c) v1ne
+
+#include "SelfCheck.h"
+
+#include "ControlMailboxCheck.h"
+#include "FrameArenaCheck.h"
+#include "FrameGovernorCheck.h"
+#include "GoldenImageCheck.h"
+#include "LayoutBenchmark.h"
+#include "MidiEncoderCheck.h"
+#include "MidiParserCheck.h"
+#include "OscEncoderCheck.h"
+#include "RenderBenchmark.h"
+#include "RenderCheck.h"
+#include "UmpEncoderCheck.h"
+
+#include <string.h>
+
+const SelfCheck gSelfChecks[] = {
+  {"compare-renderers", "The tiled CPU renderer paints the same pixels as the plain one", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CompareCpuRenderers(pReport); }},
+  {"control-mailbox", "The control mailbox passes the latest value of each control between threads", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckControlMailbox(pReport); }},
+  {"frame-arena", "The frame arena aligns, grows to fit a frame and reuses its memory", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckFrameArena(pReport); }},
+  {"frame-governor", "The frame governor sheds load when frames are expensive and restores it", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckFrameGovernor(pReport); }},
+  {"golden-images", "The built-in layout renders like the golden images", false, CheckGoldenImages},
+  {"midi-encoder", "The MIDI encoder uses running status and leaves out unchanged MSBs", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckMidiEncoder(pReport); }},
+  {"midi-parser", "The MIDI parser takes running status, real-time bytes and SysEx apart", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckMidiParser(pReport); }},
+  {"osc-encoder", "OSC bundles read back as sent and fit into a datagram", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckOscEncoder(pReport); }},
+  {"ump-encoder", "MIDI 2.0 values scale up and back, and down-convert like MIDI 1.0 values encode", false,
+    [](const SelfCheckOptions&, std::string* pReport) { return CheckUmpEncoder(pReport); }},
+  {"render-benchmark", "Frame times of the built-in layout on the CPU renderers", true, BenchmarkDefaultLayout},
+  {"frame-diff-benchmark", "Skipped and partial frames of the built-in layout while values settle", true,
+    BenchmarkFrameDiff},
+  {"culling-benchmark", "Frame times of 1000 knobs, partly off the window and below the squares, with and without culling",
+    true, BenchmarkCulling},
+  {"layout-benchmark", "Compiling and loading layouts of 1000 to 100000 controls", true, BenchmarkLayoutLoad},
+  {"recording-benchmark", "Recording 1200 views on 1, 2, 4 and 8 workers, which must match recording them serially",
+    true, BenchmarkParallelRecording},
+  {"tile-scaling-benchmark", "Frame times of a large layout on 1, 2, 4 and 8 render workers", true, BenchmarkTileScaling},
+};
+
+const size_t gNumSelfChecks = sizeof(gSelfChecks) / sizeof(gSelfChecks[0]);
+
+
+const SelfCheck* FindSelfCheck(const char* pName) {
+  for(size_t i = 0; i < gNumSelfChecks; ++i)
+    if(!strcmp(gSelfChecks[i].pName, pName))
+      return &gSelfChecks[i];
+  return nullptr;
+}
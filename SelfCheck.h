@@ -0,0 +1,30 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+struct SelfCheckOptions {
+  // Where GoldenImageCheck finds the golden images
+  const char* pGoldenDir = "Headless/Golden";
+  // Rewrites the golden images instead of comparing against them
+  bool updateGoldenImages = false;
+};
+
+// The checks and benchmarks that don't need Windows. The app runs them with
+// /self-check, the build in Headless/ runs them on any system.
+struct SelfCheck {
+  const char* pName;
+  const char* pDescription;
+  // Benchmarks report numbers and only fail if they can't run
+  bool isBenchmark;
+  // Returns whether the check passed. pReport receives what it found.
+  bool (*pRun)(const SelfCheckOptions& options, std::string* pReport);
+};
+
+extern const SelfCheck gSelfChecks[];
+extern const size_t gNumSelfChecks;
+
+// Returns nullptr if there's no check of that name
+const SelfCheck* FindSelfCheck(const char* pName);
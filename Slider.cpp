@@ -7,15 +7,38 @@
 // Copyright (c) v1ne
 
 #include "Geometry.h"
-#include "MidiOutput.h"
+#include "ControlRing.h"
+#include "MidiRouter.h"
+#include "MidiScheduler.h"
+#include "OscOutput.h"
 #include "Slider.h"
+#include "ViewPainter.h"
 
 #include <manipulations.h>
 #include <math.h>
+#include <stdio.h>
 #include <unordered_map>
 
 
-extern MidiOutput gMidiOutput;
+extern CMidiRouter gMidiRouter;
+extern CMidiScheduler gMidiScheduler;
+extern COscOutput gOscOutput;
+extern CControlRing gControlRing;
+
+bool gUseGhostScaleStrip = true;
+
+static constexpr auto sGhostRange = 0.5f;
+static constexpr auto sGhostScaleWidth = 250.f;
+static constexpr auto sPercentPerTick = 1.f;
+static constexpr auto sTicksPerLabel = 10;
+static constexpr auto sHalfWurstfingerWidth = 40.f;
+static const auto sGhostTriangleStrokeSize = Point2F{16.f, 4.f};
+
+// Ghost scale strips are rendered for scaling factors that are powers of this
+static constexpr auto sGhostScaleBucketRatio = 1.05f;
+
+// Only its address is used, to identify ghost scale strips in the layer cache
+static const int sGhostScaleStripTag = 0;
 
 
 class DialOnALeash: public CTransformableDrawingObject {
@@ -30,7 +53,6 @@ public:
       MANIPULATION_PROCESSOR_MANIPULATIONS::MANIPULATION_ROTATE);
 
     //mpManipulationProc->put_MinimumScaleRotateRadius(100'000.f);
-    m_lastMatrix = D2D1::Matrix3x2F::Identity();
 
     mSize = Point2F{2.f * sInnerRadius + 100.f};
     ResetState(center - mSize/2.f, mClientArea, mSize);
@@ -143,66 +165,60 @@ public:
       mIsShown = false;
   }
 
-  void Paint() override {
+  void Paint(CRenderList& list, CFrameArena&) override {
     if (!mIsShown)
       return;
 
-    if((mpRenderTarget->CheckWindowState() & D2D1_WINDOW_STATE_OCCLUDED))
-      return;
-
-    const auto identityMatrix = D2D1::Matrix3x2F::Identity();
-    mpRenderTarget->SetTransform(&identityMatrix);
+    list.SetTransform(Transform2F::Identity());
 
     const auto pos = Center();
     const auto innerRadius = sInnerRadius;
     const auto outerRadius = mSize.x/2;
-    D2D1_ELLIPSE background = {pos.to<D2D1_POINT_2F>(), outerRadius, outerRadius};
-    mD2dDriver->m_spD2DFactory->CreateEllipseGeometry(background, &mBackground);
-    mpRenderTarget->FillGeometry(mBackground, mD2dDriver->m_spSemitransparentDarkBrush);
+    list.FillEllipse(pos, Point2F{outerRadius}, BrushId::SemitransparentDark);
 
-    mpRenderTarget->FillEllipse({pos.to<D2D1_POINT_2F>(), innerRadius, innerRadius}, mD2dDriver->m_spWhiteBrush);
-    mpRenderTarget->FillEllipse({pos.to<D2D1_POINT_2F>(), 30.f, 30.f}, mD2dDriver->m_spDarkGreyBrush);
+    list.FillEllipse(pos, Point2F{innerRadius}, BrushId::White);
+    list.FillEllipse(pos, Point2F{30.f}, BrushId::DarkGrey);
 
     const auto triangleAngle = 180.f;
     const auto triangleStrokeSize = Point2F{16.f, 4.f};
     const auto vecToTriangle = rotateDeg(Vec2Right(innerRadius + 2.f), triangleAngle);
-    mD2dDriver->RenderTiltedRect(pos + vecToTriangle, 0, triangleAngle + 45, triangleStrokeSize, mD2dDriver->m_spWhiteBrush);
-    mD2dDriver->RenderTiltedRect(pos + vecToTriangle, 0, triangleAngle - 45, triangleStrokeSize, mD2dDriver->m_spWhiteBrush);
+    list.FillTiltedRect(pos + vecToTriangle, 0, triangleAngle + 45, triangleStrokeSize, BrushId::White);
+    list.FillTiltedRect(pos + vecToTriangle, 0, triangleAngle - 45, triangleStrokeSize, BrushId::White);
+
+    // The scale is too fine to be read on a small dial
+    if (DetailOnScreen(list) != Detail::Full)
+      return;
 
     const auto angleStep = sAngleRange/100;
     const auto bigMarksEvery = 10;
     const auto shortMarkSize = Point2F{10.f, 1.f};
     const auto longMarkSize = Point2F{15.f, 3.f};
     const auto angularOffset = -(mpSlider->mRawTouchValue - 0.005f) * sAngleRange + triangleAngle;
-    wchar_t buf[16];
+    char buf[16];
     int stepCount = 0;
-    const auto translateMatrix = D2D1::Matrix3x2F::Translation({0.f, -(innerRadius + 15.f)});
+    const auto translateTransform = Transform2F::Translation({0.f, -(innerRadius + 15.f)});
     for(float i = 0; i < (sAngleRange < 360.f ? sAngleRange + angleStep : sAngleRange - angleStep); i += angleStep, ++stepCount) {
       auto finalAngle = angularOffset + i;
       auto markSize = i == 0
         ? Point2F{innerRadius, longMarkSize.y}
         : stepCount % bigMarksEvery == 0 ? longMarkSize : shortMarkSize;
       markSize.x += i / 30.f;
-      mD2dDriver->RenderTiltedRect(pos, innerRadius - markSize.x, finalAngle, markSize,
-        (i == 0 || i >= sAngleRange) ? mD2dDriver->m_spBlackBrush : mD2dDriver->m_spDarkGreyBrush);
+      list.FillTiltedRect(pos, innerRadius - markSize.x, finalAngle, markSize,
+        (i == 0 || i >= sAngleRange) ? BrushId::Black : BrushId::DarkGrey);
 
       if (!(stepCount % bigMarksEvery)) {
-        wsprintf(buf, L"%d%%", int(::roundf(100 * i / sAngleRange)));
-        const auto finalTransform = translateMatrix * D2D1::Matrix3x2F::Rotation(-finalAngle + 90.f, Center().to<D2D1_POINT_2F>());
-        mpRenderTarget->SetTransform(&finalTransform);
-        mD2dDriver->RenderMediumText({pos.x-25.f, pos.y-20.f, pos.x + 25.f, pos.y + 20.f}, buf, wcslen(buf), mD2dDriver->m_spWhiteBrush);
-        mpRenderTarget->SetTransform(&identityMatrix);
+        snprintf(buf, sizeof(buf), "%d%%", int(::roundf(100 * i / sAngleRange)));
+        list.SetTransform(translateTransform * Transform2F::Rotation(-finalAngle + 90.f, Center()));
+        list.Text({pos.x-25.f, pos.y-20.f, pos.x + 25.f, pos.y + 20.f}, TextStyle::Medium, BrushId::White, buf);
+        list.SetTransform(Transform2F::Identity());
       }
     }
 
   }
 
+  // The background is a circle that isn't rotated
   bool InRegion(Point2F pos) override {
-    if (!mIsShown || !mBackground) return false;
-
-    BOOL b = FALSE;
-    mBackground->FillContainsPoint(pos.to<D2D1_POINT_2F>(), &m_lastMatrix, &b);
-    return b;
+    return mIsShown && (pos - Center()).mag() <= mSize.x/2;
   }
 
   float PivotRadius() override {
@@ -217,17 +233,13 @@ public:
   std::unordered_map<DWORD, ContactTypes> mContactsToTypeMap;
 
   bool mIsShown = false;
-  ID2D1EllipseGeometryPtr mBackground;
   CSlider* mpSlider;
 };
 
 
 
-CSlider::CSlider(HWND hWnd, CD2DDriver* d2dDriver, SliderType type, uint8_t numController)
+CSlider::CSlider(HWND hWnd, CD2DDriver* d2dDriver)
   : CTransformableDrawingObject(hWnd, d2dDriver)
-  , mType(type)
-  , mValue(::rand() / float(RAND_MAX))
-  , mNumController(numController)
 {
   mpManipulationProc->put_SupportedManipulations(MANIPULATION_PROCESSOR_MANIPULATIONS::MANIPULATION_ALL
       & ~MANIPULATION_PROCESSOR_MANIPULATIONS::MANIPULATION_SCALE);
@@ -236,6 +248,36 @@ CSlider::CSlider(HWND hWnd, CD2DDriver* d2dDriver, SliderType type, uint8_t numC
 
 CSlider::~CSlider() {
   HideDial();
+  mD2dDriver->LayerCache().Invalidate(this);
+}
+
+
+void CSlider::Bind(CControlModel* pModel, CControlModel::Control* pControl) {
+  mpModel = pModel;
+  mpControl = pControl;
+  mControlIndex = pModel->IndexOf(*pControl);
+  mType = pControl->type == CControlModel::ControlType::Knob ? TYPE_KNOB : TYPE_SLIDER;
+  mValue = pControl->value;
+  mRawTouchValue = mValue;
+}
+
+
+void CSlider::Unbind() {
+  // Lets the manipulation complete while the control is still bound
+  if(!mTouchPoints.empty())
+    mpManipulationProc->CompleteManipulation();
+  if(mIsInertiaActive)
+    mpInertiaProc->Complete();
+
+  mTouchPoints.clear();
+  HideDial();
+  mpModel = nullptr;
+  mpControl = nullptr;
+}
+
+void CSlider::ShowValue(float value) {
+  mValue = value;
+  mRawTouchValue = value;
 }
 
 bool CSlider::HandleTouchEvent(TouchEventType type, Point2F pos, const TOUCHINPUT* pData) {
@@ -336,13 +378,13 @@ void CSlider::HandleTouch(float cumultiveTranslationX, float deltaY) {
 
 void CSlider::HandleTouchInAbsoluteInteractionMode(float y) {
   mDidSetAbsoluteValue = true;
-  mValue = ::fmaxf(0, ::fminf(1, (mBottomPos - y) / mSliderHeight));
+  mValue = ::fmaxf(0, ::fminf(1, (BottomPos() - y) / SliderHeight()));
   HandleValueChange();
 }
 
 
 void CSlider::HandleTouchInRelativeInteractionMode(float cumulativeTranslationX, float deltaY) {
-  const auto dragScalingFactor = (1 + ::fabsf(mCurrentTouchPoint.x - mFirstTouchPoint.x) / (2 * mSize.x)) * mSliderHeight;
+  const auto dragScalingFactor = (1 + ::fabsf(mCurrentTouchPoint.x - mFirstTouchPoint.x) / (2 * mSize.x)) * SliderHeight();
   mDragScalingFactor = dragScalingFactor;
 
   mRawTouchValue -= deltaY / dragScalingFactor;
@@ -352,146 +394,155 @@ void CSlider::HandleTouchInRelativeInteractionMode(float cumulativeTranslationX,
 }
 
 
-void CSlider::Paint() {
-  const auto rotateMatrix = D2D1::Matrix3x2F::Rotation(
-    m_fAngleCumulative,
-    (mRenderPos + mSize / 2.f).to<D2D1_POINT_2F>());
-
-  mpRenderTarget->SetTransform(&rotateMatrix);
+void CSlider::Paint(CRenderList& list, CFrameArena& arena) {
+  const auto detail = DetailOnScreen(list);
+  const auto look = SliderLook{mRenderPos, mSize, m_fAngleCumulative, mType == TYPE_KNOB, mValue, BrushForMode()};
+  PaintSliderLook(list, this, look, detail);
+
+  if(mType == TYPE_SLIDER && detail == Detail::Full && !mpDial && !mTouchPoints.empty() && !mIsInertiaActive
+      && mCurrentTouchPoint.x != 0.f && mCurrentTouchPoint.y != 0.f) {
+    // The renderer measures how long the ghost scale takes to replay
+    const auto bucket = gUseGhostScaleStrip ? GhostScaleStripBucket() : 0;
+    list.BeginProfile(bucket ? ProfileScope::GhostScaleStrip : ProfileScope::GhostScaleDirect);
+    if (bucket)
+      PaintGhostScaleFromStrip(list, bucket);
+    else
+      PaintGhostScale(list);
+    list.EndProfile();
+  }
 
-  // Store the rotate matrix to be used in hit testing
-  m_lastMatrix = rotateMatrix;
+  if(mpDial) mpDial->Paint(list, arena);
+}
 
-  const auto bgRect = D2D1::RectF(mRenderPos.x, mRenderPos.y, mRenderPos.x+mSize.x, mRenderPos.y+mSize.y);
-  mD2dDriver->m_spD2DFactory->CreateRectangleGeometry(bgRect, &mpOutlineGeometry);
-  mpRenderTarget->FillGeometry(mpOutlineGeometry, mD2dDriver->m_spLightGreyBrush);
 
-  switch(mType) {
-  case TYPE_SLIDER:
-    PaintSlider();
-    break;
-  case TYPE_KNOB:
-    PaintKnob();
-    break;
-  }
+// The ghost scale shows the values around the current one while dragging,
+// scaled by mDragScalingFactor, so that the user can fine-adjust the value.
+void CSlider::GhostScaleRange(float* pMinValue, float* pMaxValue) {
+  *pMinValue = ::roundf(100*::fminf(1.f, ::fmaxf(0.f, mRawTouchValue - sGhostRange/2.f)))/100.f;
+  *pMaxValue = ::roundf(100*::fminf(1.f, ::fmaxf(0.f, mRawTouchValue + sGhostRange/2.f)))/100.f;
+}
 
-  // Restore our transform to nothing
-  const auto identityMatrix = D2D1::Matrix3x2F::Identity();
-  mpRenderTarget->SetTransform(&identityMatrix);
 
-  if(mpDial) mpDial->Paint();
+void CSlider::PaintGhostScaleArrows(CRenderList& list) {
+  const auto sliderTriangleOffset = Point2F{sGhostScaleWidth/2 - sGhostTriangleStrokeSize.x, 0};
+  list.FillTiltedRect(mCurrentTouchPoint - sliderTriangleOffset, 0, 180+45, sGhostTriangleStrokeSize, BrushId::White);
+  list.FillTiltedRect(mCurrentTouchPoint - sliderTriangleOffset, 0, 180-45, sGhostTriangleStrokeSize, BrushId::White);
+  list.FillTiltedRect(mCurrentTouchPoint + sliderTriangleOffset, 0,  45, sGhostTriangleStrokeSize, BrushId::White);
+  list.FillTiltedRect(mCurrentTouchPoint + sliderTriangleOffset, 0, -45, sGhostTriangleStrokeSize, BrushId::White);
 }
 
 
-void CSlider::PaintSlider()
-{
-  const auto borderWidth = mSize.x / 4;
-  const auto topBorder = mSize.y * 10 / 100;
-  const auto topEnd = mRenderPos.y + topBorder;
-  const auto bottomPos = mRenderPos.y+mSize.y;
-  const auto sliderHeight = bottomPos - topEnd;
-  const auto topPos = bottomPos - mValue * sliderHeight;
-
-  mBottomPos = bottomPos;
-  mSliderHeight = sliderHeight;
-
-  const auto fgRect = D2D1::RectF(mRenderPos.x + borderWidth, topPos, mRenderPos.x+mSize.x - borderWidth, bottomPos);
-  ID2D1RectangleGeometryPtr fgGeometry;
-  mD2dDriver->m_spD2DFactory->CreateRectangleGeometry(fgRect, &fgGeometry);
-  mpRenderTarget->FillGeometry(fgGeometry, BrushForMode());
-
-  wchar_t buf[16];
-  wsprintf(buf, L"%d%%", int(mValue*100));
-  mD2dDriver->RenderText({mRenderPos.x, mRenderPos.y, mRenderPos.x + mSize.x, mRenderPos.y + topBorder}, buf, wcslen(buf), mD2dDriver->m_spDimGreyBrush);
-
-  if (!mpDial && !mTouchPoints.empty() && !mIsInertiaActive && mCurrentTouchPoint.x != 0.f && mCurrentTouchPoint.y != 0.f) {
-    D2D1_MATRIX_3X2_F oldTransform;
-    mpRenderTarget->GetTransform(&oldTransform);
-    const auto identityMatrix = D2D1::Matrix3x2F::Identity();
-    mpRenderTarget->SetTransform(&identityMatrix);
-
-    const auto ghostRange = 0.5f;
-    const auto ghostScaleFactor = mDragScalingFactor / 100.f;
-    const auto percentPerTick = 1.f;
-    const auto ticksPerLabel = 10;
-
-    const auto minValue = ::roundf(100*::fminf(1.f, ::fmaxf(0.f, mRawTouchValue - ghostRange/2.f)))/100.f;
-    const auto maxValue = ::roundf(100*::fminf(1.f, ::fmaxf(0.f, mRawTouchValue + ghostRange/2.f)))/100.f;
-    const auto ghostValueRange = maxValue - minValue;
-
-    const auto ghostSliderSize = Point2F{250.f, ghostValueRange * 100 * ghostScaleFactor * percentPerTick};
-    const auto triangleStrokeSize = Point2F{16.f, 4.f};
-    
-    {//if ((mCurrentTouchPoint - Center()).mag()> ghostSliderSize.x / 2.f) {
-      const auto dashDelta = ghostScaleFactor * percentPerTick;
-      const auto initialOffset = mCurrentTouchPoint.y + mRawTouchValue * 100 * ghostScaleFactor * percentPerTick;
-      auto dashY = initialOffset - (minValue + 0.005f) * 100 * ghostScaleFactor * percentPerTick;
-
-      const auto topLeft = Point2F{mCurrentTouchPoint.x - ghostSliderSize.x/2.f, dashY - dashDelta * ghostValueRange * 100};
-      const auto bottomRight = Point2F{mCurrentTouchPoint.x + ghostSliderSize.x/2.f, dashY};
-      mpRenderTarget->FillRectangle({topLeft.x, topLeft.y, bottomRight.x, bottomRight.y}, mD2dDriver->m_spSemitransparentDarkBrush);
-
-
-      const auto sliderTriangleOffset = Point2F{ghostSliderSize.x/2 - triangleStrokeSize.x, 0};
-      mD2dDriver->RenderTiltedRect(mCurrentTouchPoint - sliderTriangleOffset, 0, 180+45, triangleStrokeSize, mD2dDriver->m_spWhiteBrush);
-      mD2dDriver->RenderTiltedRect(mCurrentTouchPoint - sliderTriangleOffset, 0, 180-45, triangleStrokeSize, mD2dDriver->m_spWhiteBrush);
-      mD2dDriver->RenderTiltedRect(mCurrentTouchPoint + sliderTriangleOffset, 0,  45, triangleStrokeSize, mD2dDriver->m_spWhiteBrush);
-      mD2dDriver->RenderTiltedRect(mCurrentTouchPoint + sliderTriangleOffset, 0, -45, triangleStrokeSize, mD2dDriver->m_spWhiteBrush);
-
-      auto tickCount = int(::roundf(100*minValue));
-      for(auto currentValue = minValue; currentValue <= maxValue; currentValue += (percentPerTick / 100.f), ++tickCount) {
-        const auto halfWurstfingerWidth = 40.f;
-        const auto dashWidth = ghostSliderSize.x/2.f - triangleStrokeSize.x - halfWurstfingerWidth - 2.f;
-        const auto isLongTick = !(tickCount % ticksPerLabel);
-
-        mD2dDriver->RenderTiltedRect({mCurrentTouchPoint.x, dashY}, halfWurstfingerWidth, 180, {isLongTick?dashWidth : dashWidth/2, 1.f}, mD2dDriver->m_spWhiteBrush);
-        mD2dDriver->RenderTiltedRect({mCurrentTouchPoint.x, dashY}, halfWurstfingerWidth,   0, {isLongTick?dashWidth : dashWidth/2, 1.f}, mD2dDriver->m_spWhiteBrush);
-
-        if (isLongTick && tickCount < 100) {
-          const auto middleLeft = Point2F{mCurrentTouchPoint.x - halfWurstfingerWidth - dashWidth, dashY - 25.f};
-          wsprintf(buf, L"%d%%", tickCount);
-          mD2dDriver->RenderMediumText({middleLeft.x, middleLeft.y, middleLeft.x + dashWidth/2, middleLeft.y + 100.f}, buf, wcslen(buf), mD2dDriver->m_spWhiteBrush);
-        }
-        dashY -= dashDelta;
-      }
-    }
+void CSlider::PaintGhostScaleTick(CRenderList& list, Point2F center, int tickCount) {
+  const auto dashWidth = sGhostScaleWidth/2.f - sGhostTriangleStrokeSize.x - sHalfWurstfingerWidth - 2.f;
+  const auto isLongTick = !(tickCount % sTicksPerLabel);
 
-    mpRenderTarget->SetTransform(&oldTransform);
+  list.FillTiltedRect(center, sHalfWurstfingerWidth, 180, {isLongTick?dashWidth : dashWidth/2, 1.f}, BrushId::White);
+  list.FillTiltedRect(center, sHalfWurstfingerWidth,   0, {isLongTick?dashWidth : dashWidth/2, 1.f}, BrushId::White);
+
+  if (isLongTick && tickCount < 100) {
+    const auto middleLeft = Point2F{center.x - sHalfWurstfingerWidth - dashWidth, center.y - 25.f};
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d%%", tickCount);
+    list.Text({middleLeft.x, middleLeft.y, middleLeft.x + dashWidth/2, middleLeft.y + 100.f}, TextStyle::Medium, BrushId::White, buf);
   }
 }
 
 
-void CSlider::PaintKnob() {
-  const auto border = POINTF{mSize.x / 8, mSize.y / 8};
-  const auto center = Center().to<D2D1_POINT_2F>();
-  const auto knobRadius = ::fminf((mSize.x - border.x)/2, (mSize.y - border.y)/2);
+void CSlider::PaintGhostScale(CRenderList& list) {
+  const auto ghostScaleFactor = mDragScalingFactor / 100.f;
+
+  float minValue, maxValue;
+  GhostScaleRange(&minValue, &maxValue);
+  const auto ghostValueRange = maxValue - minValue;
 
-  mSliderHeight = mSize.y * 3;
-  mBottomPos = mRenderPos.y + mSize.y / 2;
+  const auto dashDelta = ghostScaleFactor * sPercentPerTick;
+  const auto initialOffset = mCurrentTouchPoint.y + mRawTouchValue * 100 * ghostScaleFactor * sPercentPerTick;
+  auto dashY = initialOffset - (minValue + 0.005f) * 100 * ghostScaleFactor * sPercentPerTick;
 
-  D2D1_ELLIPSE knobOutlineParams = {center, knobRadius, knobRadius};
-  ID2D1EllipseGeometryPtr knobOutline;
-  mD2dDriver->m_spD2DFactory->CreateEllipseGeometry(knobOutlineParams, &knobOutline);
-  mpRenderTarget->FillGeometry(knobOutline, mD2dDriver->m_spDarkGreyBrush);
+  const auto topLeft = Point2F{mCurrentTouchPoint.x - sGhostScaleWidth/2.f, dashY - dashDelta * ghostValueRange * 100};
+  const auto bottomRight = Point2F{mCurrentTouchPoint.x + sGhostScaleWidth/2.f, dashY};
+  list.FillRect(Rect2F::FromPoints(topLeft, bottomRight), BrushId::SemitransparentDark);
 
-  const auto knobMarkAngle = -135.f - mValue * 270;
-  const auto markSize = Point2F{10.f, 5.f};
-  mD2dDriver->RenderTiltedRect(Center(), knobRadius - markSize.x, knobMarkAngle, markSize, BrushForMode());
+  PaintGhostScaleArrows(list);
 
-  for(int i = 0; i <= 270; i += 30) {
-    mD2dDriver->RenderTiltedRect(Center(), knobRadius, float(-135 - i), {3.f, 1.f}, mD2dDriver->m_spBlackBrush);
+  auto tickCount = int(::roundf(100*minValue));
+  for(auto currentValue = minValue; currentValue <= maxValue; currentValue += (sPercentPerTick / 100.f), ++tickCount) {
+    PaintGhostScaleTick(list, {mCurrentTouchPoint.x, dashY}, tickCount);
+    dashY -= dashDelta;
   }
+}
+
+
+// Paints the whole 0-100% scale into a strip, where 100% is at the top.
+void CSlider::PaintGhostScaleStrip(CRenderList& list, float dashDelta) {
+  const auto stripHeight = 100 * dashDelta;
+  list.FillRect({0, 0, sGhostScaleWidth, stripHeight}, BrushId::SemitransparentDark);
+
+  for(int tickCount = 0; tickCount <= 100; ++tickCount)
+    PaintGhostScaleTick(list, {sGhostScaleWidth/2.f, (100 - tickCount) * dashDelta}, tickCount);
+}
+
+
+// Strips are cached for buckets of mDragScalingFactor. Returns 0 if the
+// scaling factor is too small for a strip.
+int CSlider::GhostScaleStripBucket() {
+  const auto bucket = int(::roundf(::logf(mDragScalingFactor) / ::logf(sGhostScaleBucketRatio)));
+  return bucket > 0 ? bucket : 0;
+}
 
-  wchar_t buf[16];
-  wsprintf(buf, L"%d%%", int(mValue*100));
-  mD2dDriver->RenderText({center.x - mSize.x/3, center.y - border.y, center.x + mSize.x/3, center.y + border.y}, buf, wcslen(buf), mD2dDriver->m_spDimGreyBrush);
+
+// Same as PaintGhostScale, but shows the visible part of a strip with the
+// whole scale, stretched to the exact scaling factor. The strip is recorded
+// as a layer, so that the renderer can blit it from the layer cache.
+void CSlider::PaintGhostScaleFromStrip(CRenderList& list, int bucket) {
+  const auto bucketDashDelta = ::powf(sGhostScaleBucketRatio, float(bucket)) / 100.f * sPercentPerTick;
+  const auto stripSize = Point2F{sGhostScaleWidth, 100 * bucketDashDelta + 1.f};
+
+  float minValue, maxValue;
+  GhostScaleRange(&minValue, &maxValue);
+
+  // Tick t is at y = touch.y + (100*raw - t - 0.5) * dashDelta on screen,
+  // and at y = (100 - t) * bucketDashDelta in the strip.
+  const auto dashDelta = mDragScalingFactor / 100.f * sPercentPerTick;
+  const auto stretch = dashDelta / bucketDashDelta;
+  const auto minTick = ::roundf(100 * minValue);
+  const auto maxTick = ::roundf(100 * maxValue);
+  const auto margin = 0.5f;
+
+  const auto destTop = mCurrentTouchPoint.y + (100 * mRawTouchValue - maxTick - 0.5f) * dashDelta - margin;
+  const auto destBottom = mCurrentTouchPoint.y + (100 * mRawTouchValue - minTick - 0.5f) * dashDelta + margin;
+  const auto destRect = Rect2F{mCurrentTouchPoint.x - sGhostScaleWidth/2.f, destTop,
+    mCurrentTouchPoint.x + sGhostScaleWidth/2.f, destBottom};
+
+  const auto sourceTop = (100 - maxTick) * bucketDashDelta - margin / stretch;
+  const auto sourceBottom = (100 - minTick) * bucketDashDelta + margin / stretch;
+  const auto sourceRect = Rect2F{0, sourceTop, sGhostScaleWidth, sourceBottom};
+
+  list.BeginLayer(&sGhostScaleStripTag, unsigned(bucket), stripSize, sourceRect, destRect);
+  PaintGhostScaleStrip(list, bucketDashDelta);
+  list.EndLayer();
+
+  PaintGhostScaleArrows(list);
+}
+
+
+// Where a touch sets the value to 0. Derived from the current state rather
+// than from the last frame, since views are recycled between banks.
+float CSlider::BottomPos() {
+  return mType == TYPE_KNOB ? mRenderPos.y + mSize.y / 2 : mRenderPos.y + mSize.y;
+}
+
+
+// How far a touch moves between the values 0 and 1. Knobs are dragged over
+// three times their height.
+float CSlider::SliderHeight() {
+  const auto topBorder = mSize.y * 10 / 100;
+  return mType == TYPE_KNOB ? mSize.y * 3 : mSize.y - topBorder;
 }
 
 
 bool CSlider::InMyRegion(Point2F pos) {
-  BOOL b = FALSE;
-  mpOutlineGeometry->FillContainsPoint(pos.to<D2D1_POINT_2F>(), &m_lastMatrix, &b);
-  return b;
+  return IsInPaintedRect(pos);
 }
 
 
@@ -514,21 +565,27 @@ void CSlider::HideDial()
   mpDial = nullptr;
 }
 
-ID2D1SolidColorBrush* CSlider::BrushForMode() {
-  switch(mNumController % 3) {
-  case 0: return mD2dDriver->m_spSomePinkishBlueBrush;
-  case 1: return mD2dDriver->m_spCornflowerBrush;
-  case 2: return mD2dDriver->m_spSomeGreenishBrush;
+BrushId CSlider::BrushForMode() {
+  switch(gMidiRouter.TargetOf(mControlIndex).controller % 3) {
+  case 0: return BrushId::SomePinkishBlue;
+  case 1: return BrushId::Cornflower;
+  case 2: return BrushId::SomeGreenish;
   }
-  return nullptr;
+  return BrushId::Black;
 }
 
 
 void CSlider::HandleValueChange() {
-  auto currentValue = uint8_t(::roundf(127.f * mValue));
-  if (currentValue != mLastMidiValue) {
-    mLastMidiValue = currentValue;
-    gMidiOutput.sendControllerChange(mNumController, currentValue);
+  if (!mpControl)
+    return;
+
+  mpModel->SetValue(*mpControl, mValue);
+  gOscOutput.Send(mControlIndex, mValue);
+  gControlRing.Publish(mControlIndex, mValue);
+  auto currentValue = CControlModel::MidiValue(mValue, gMidiRouter.TargetOf(mControlIndex).resolution);
+  if (currentValue != mpControl->lastMidiValue) {
+    gMidiScheduler.Send(mControlIndex, currentValue, mpControl->lastMidiValue);
+    mpControl->lastMidiValue = currentValue;
   }
 }
 
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include "ControlModel.h"
 #include "D2DDriver.h"
 #include "ViewBase.h"
 
@@ -17,24 +18,47 @@
 
 class DialOnALeash;
 
+// Toggles between blitting the ghost scale from a pre-rendered strip and painting it tick by tick
+extern bool gUseGhostScaleStrip;
+
 class CSlider : public CTransformableDrawingObject {
 public:
   enum SliderType {TYPE_SLIDER, TYPE_KNOB};
 
-  CSlider(HWND hwnd, CD2DDriver* d2dDriver, SliderType type, uint8_t numController);
+  CSlider(HWND hwnd, CD2DDriver* d2dDriver);
   ~CSlider() override;
 
+  // Sliders are recycled when another bank is shown. A bound slider shows
+  // the control and writes changes of the value back to it.
+  void Bind(CControlModel* pModel, CControlModel::Control* pControl);
+  // Stops any manipulation and inertia. The slider doesn't touch the control afterwards.
+  void Unbind();
+
+  // Whether a contact or inertia is changing the value
+  bool IsMoving() const { return !mTouchPoints.empty() || mIsInertiaActive; }
+  // Shows a value that the control took on elsewhere, without sending it
+  void ShowValue(float value);
+
   void ManipulationStarted(Point2F Po) override;
   void ManipulationDelta(ViewBase::ManipDeltaParams) override;
   void ManipulationCompleted(ViewBase::ManipCompletedParams) override;
 
-  void Paint() override;
+  void Paint(CRenderList& list, CFrameArena& arena) override;
   bool InRegion(Point2F pos) override;
 
 private:
-  ID2D1SolidColorBrush* BrushForMode();
-  void PaintSlider();
-  void PaintKnob();
+  BrushId BrushForMode();
+  float BottomPos();
+  float SliderHeight();
+
+  void GhostScaleRange(float* pMinValue, float* pMaxValue);
+  void PaintGhostScale(CRenderList& list);
+  int GhostScaleStripBucket();
+  void PaintGhostScaleFromStrip(CRenderList& list, int bucket);
+  void PaintGhostScaleStrip(CRenderList& list, float dashDelta);
+  void PaintGhostScaleArrows(CRenderList& list);
+  void PaintGhostScaleTick(CRenderList& list, Point2F center, int tickCount);
+
   bool InMyRegion(Point2F pos);
 
   bool HandleTouchEvent(TouchEventType type, Point2F pos, const TOUCHINPUT* pData) override;
@@ -49,9 +73,6 @@ private:
 
   Point2F PointProjectedToOutline(Point2F);
 
-  ID2D1RectangleGeometryPtr mpOutlineGeometry;
-  float mBottomPos;
-  float mSliderHeight;
   
   Point2F mFirstTouchPoint;
   Point2F mCurrentTouchPoint;
@@ -64,10 +85,11 @@ private:
   float mFirstTouchValue = 0.0f;
   float mDragScalingFactor = 1.0f;
 
-  uint8_t mNumController = 0;
-  uint8_t mLastMidiValue = 0;
+  CControlModel* mpModel = nullptr;
+  CControlModel::Control* mpControl = nullptr;
+  size_t mControlIndex = 0;
 
-  SliderType mType;
+  SliderType mType = TYPE_SLIDER;
   DialOnALeash* mpDial = nullptr;
   friend class DialOnALeash;
 };
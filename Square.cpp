@@ -18,24 +18,28 @@ CSquare::CSquare(HWND hWnd, CD2DDriver* d2dDriver,  const DrawingColor colorChoi
 {
   mpManipulationProc->put_SupportedManipulations(MANIPULATION_PROCESSOR_MANIPULATIONS::MANIPULATION_ALL);
 
-  // Determines what brush to use for drawing this object and
-  // gets the brush from the D2DDriver class
+  // Determines what brush to use for drawing this object
 
   switch (colorChoice){
       case Blue:
-          m_currBrush = mD2dDriver->get_GradBrush(CD2DDriver::GRB_Blue);
+          m_currBrush = BrushId::GradientBlue;
+          m_flatBrush = BrushId::Cornflower;
           break;
       case Orange:
-          m_currBrush = mD2dDriver->get_GradBrush(CD2DDriver::GRB_Orange);
+          m_currBrush = BrushId::GradientOrange;
+          m_flatBrush = BrushId::SomeOrangish;
           break;
       case Green:
-          m_currBrush = mD2dDriver->get_GradBrush(CD2DDriver::GRB_Green);
+          m_currBrush = BrushId::GradientGreen;
+          m_flatBrush = BrushId::SomeGreenish;
           break;
       case Red:
-          m_currBrush = mD2dDriver->get_GradBrush(CD2DDriver::GRB_Red);
+          m_currBrush = BrushId::GradientRed;
+          m_flatBrush = BrushId::SomeReddish;
           break;
       default:
-          m_currBrush = mD2dDriver->get_GradBrush(CD2DDriver::GRB_Blue);
+          m_currBrush = BrushId::GradientBlue;
+          m_flatBrush = BrushId::Cornflower;
   }
 
 }
@@ -66,96 +70,13 @@ void CSquare::ManipulationCompleted(ViewBase::ManipCompletedParams)
 {
 }
 
-void CSquare::Paint()
+void CSquare::Paint(CRenderList& list, CFrameArena&)
 {
-    float fGlOffset = 2.5f;
-
-    // Setup our matrices for performing transforms
-
-    D2D_MATRIX_3X2_F rotateMatrix;
-    D2D_MATRIX_3X2_F identityMatrix;
-    identityMatrix = D2D1::Matrix3x2F::Identity();
-
-    // Apply rotate transform
-
-    rotateMatrix = D2D1::Matrix3x2F::Rotation(
-        m_fAngleCumulative,
-        (mRenderPos + mSize / 2.f).to<D2D1_POINT_2F>());
-
-    mpRenderTarget->SetTransform(&rotateMatrix);
-
-    // Store the rotate matrix to be used in hit testing
-    m_lastMatrix = rotateMatrix;
-
-    // Get glossy brush
-    m_pGlBrush = mD2dDriver->get_GradBrush(CD2DDriver::GRB_Glossy);
-
-    // Set positions of gradients based on the new coordinates of the objecs
-    m_currBrush->SetStartPoint(mRenderPos.to<D2D1_POINT_2F>());
-    m_currBrush->SetEndPoint(D2D1::Point2F(
-        mRenderPos.x,
-        mRenderPos.y + mSize.y));
-
-    m_pGlBrush->SetStartPoint(mRenderPos.to<D2D1_POINT_2F>());  
-    m_pGlBrush->SetEndPoint(D2D1::Point2F(
-        mRenderPos.x + mSize.x/15.0f,
-        mRenderPos.y + mSize.y/2.0f));
-
-    // Create rectangle to draw
-
-    D2D1_RECT_F rectangle = D2D1::RectF(
-        mRenderPos.x,
-        mRenderPos.y,
-        mRenderPos.x+mSize.x,
-        mRenderPos.y+mSize.y
-    );
-
-    D2D1_ROUNDED_RECT roundedRect = D2D1::RoundedRect(
-        rectangle,
-        10.0f, 10.0f
-    );
-
-    // Create glossy effect
-
-    D2D1_RECT_F glossyRect = D2D1::RectF(
-        mRenderPos.x+fGlOffset,
-        mRenderPos.y+fGlOffset,
-        mRenderPos.x+mSize.x-fGlOffset,
-        mRenderPos.y+mSize.y/2.0f
-    );
-
-    D2D1_ROUNDED_RECT glossyRoundedRect = D2D1::RoundedRect(
-        glossyRect,
-        10.0f,
-        10.0f
-    );
-
-    // D2D requires that a geometry is created for the rectangle
-    mD2dDriver->m_spD2DFactory->CreateRoundedRectangleGeometry(
-        roundedRect,
-        &m_spRoundedRectGeometry
-    );
-
-    // Fill the geometry that was created
-    mpRenderTarget->FillGeometry(
-        m_spRoundedRectGeometry,
-        m_currBrush
-    );
-
-    // Draw glossy effect
-    mpRenderTarget->FillRoundedRectangle(
-        &glossyRoundedRect,
-        m_pGlBrush
-    );
-
-    // Restore our transform to nothing
-    mpRenderTarget->SetTransform(&identityMatrix);
+    PaintSquareLook(list, {mRenderPos, mSize, m_fAngleCumulative, m_currBrush, m_flatBrush}, DetailOnScreen(list));
 }
 
-// Hit testing method handled with Direct2D
+// Hit testing follows the rounded corners
 bool CSquare::InRegion(Point2F pos)
 {
-    BOOL b = FALSE;
-    m_spRoundedRectGeometry->FillContainsPoint(pos.to<D2D1_POINT_2F>(), &m_lastMatrix, &b);
-    return b;
+    return IsInPaintedRect(pos, 10.0f);
 }
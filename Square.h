@@ -22,11 +22,11 @@ public:
     void ManipulationDelta(ViewBase::ManipDeltaParams) override;
     void ManipulationCompleted(ViewBase::ManipCompletedParams) override;
 
-    void Paint() override;
+    void Paint(CRenderList& list, CFrameArena& arena) override;
     bool InRegion(Point2F pos) override;
 
 private:
-    ID2D1LinearGradientBrushPtr m_pGlBrush;
-    ID2D1LinearGradientBrushPtr m_currBrush;
-    ID2D1RoundedRectangleGeometryPtr m_spRoundedRectGeometry;
+    BrushId m_currBrush;
+    // Solid color, for when the gradient can't be made out
+    BrushId m_flatBrush;
 };
@@ -0,0 +1,43 @@
+// Copyright (c) v1ne
+
+#include "StartupTimeline.h"
+
+#include <windows.h>
+
+#include <algorithm>
+
+CStartupTimeline gStartupTimeline;
+
+void CStartupTimeline::Record(const char* phase, Clock::time_point begin) {
+  const auto end = Clock::now();
+  std::lock_guard<std::mutex> lock(mMutex);
+  if(!mIsLogged)
+    mPhases.push_back({phase, begin, end});
+}
+
+
+void CStartupTimeline::Log() {
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(mMutex);
+  if(mIsLogged)
+    return;
+  mIsLogged = true;
+
+  std::sort(mPhases.begin(), mPhases.end(), [](const Phase& a, const Phase& b) { return a.begin < b.begin; });
+
+  const auto toMicroseconds = [](Clock::duration duration) {
+    return int(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+  };
+
+  char buf[160];
+  for(const auto& phase: mPhases) {
+    wsprintfA(buf, "Startup: %s took %d us, from %d us\n", phase.name,
+      toMicroseconds(phase.end - phase.begin), toMicroseconds(phase.begin - mStart));
+    ::OutputDebugStringA(buf);
+  }
+  wsprintfA(buf, "Startup: first frame after %d us\n", toMicroseconds(now - mStart));
+  ::OutputDebugStringA(buf);
+
+  mPhases.clear();
+  mPhases.shrink_to_fit();
+}
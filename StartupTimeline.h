@@ -0,0 +1,37 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+// Collects how long the phases of the startup take, on whichever thread they
+// run, and logs them once the first frame is on screen.
+class CStartupTimeline {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  CStartupTimeline() : mStart(Clock::now()) {}
+
+  // Records a phase that began at `begin` and ends now. phase must be a literal.
+  void Record(const char* phase, Clock::time_point begin);
+
+  // Logs all phases, in the order they began, and the total time so far.
+  // Only the first call does anything.
+  void Log();
+
+private:
+  struct Phase {
+    const char* name;
+    Clock::time_point begin;
+    Clock::time_point end;
+  };
+
+  const Clock::time_point mStart;
+  std::mutex mMutex;
+  std::vector<Phase> mPhases;
+  bool mIsLogged = false;
+};
+
+extern CStartupTimeline gStartupTimeline;
@@ -0,0 +1,87 @@
+// Copyright (c) v1ne
+
+#include "TiledCpuRenderer.h"
+
+#include <atomic>
+
+#include <math.h>
+
+CTiledCpuRenderer::CTiledCpuRenderer(int width, int height, CWorkStealingPool& pool)
+  : mPool(pool)
+{
+  Resize(width, height);
+}
+
+
+void CTiledCpuRenderer::Resize(int width, int height) {
+  mWidth = width;
+  mHeight = height;
+  mPixels.assign(size_t(width) * height, 0xFFFFFFFF);
+
+  mNumTileColumns = (width + sTileSize - 1) / sTileSize;
+  mNumTileRows = (height + sTileSize - 1) / sTileSize;
+  mTiles.resize(size_t(mNumTileColumns) * mNumTileRows);
+  for(int row = 0; row < mNumTileRows; ++row) {
+    for(int column = 0; column < mNumTileColumns; ++column) {
+      auto& tile = mTiles[size_t(row) * mNumTileColumns + column];
+      tile.rect = Rect2F{float(column * sTileSize), float(row * sTileSize),
+        float(column + 1 < mNumTileColumns ? (column + 1) * sTileSize : width),
+        float(row + 1 < mNumTileRows ? (row + 1) * sTileSize : height)};
+    }
+  }
+
+  mRenderers.clear();
+  for(unsigned int i = 0; i < mPool.NumWorkers(); ++i)
+    mRenderers.emplace_back(new CCpuRenderer(mPixels.data(), width, height));
+}
+
+
+void CTiledCpuRenderer::BinSpans(const CRenderList& list, const Rect2F* pDirty) {
+  for(auto& tile: mTiles)
+    tile.spans.clear();
+
+  const auto viewport = Rect2F{0.f, 0.f, float(mWidth), float(mHeight)};
+  list.FindVisibleSpans(pDirty ? Intersection(*pDirty, viewport) : viewport, &mVisibleSpans);
+  mCullStats.numDrawn += unsigned(mVisibleSpans.indices.size());
+  mCullStats.numCulled += unsigned(mVisibleSpans.numCulled);
+
+  const auto& spans = list.Spans();
+  for(const auto i: mVisibleSpans.indices) {
+    const auto& bounds = spans[i].bounds;
+
+    const auto firstColumn = int(::fmaxf(0.f, ::floorf(bounds.left / sTileSize)));
+    const auto lastColumn = int(::fminf(float(mNumTileColumns - 1), ::floorf(bounds.right / sTileSize)));
+    const auto firstRow = int(::fmaxf(0.f, ::floorf(bounds.top / sTileSize)));
+    const auto lastRow = int(::fminf(float(mNumTileRows - 1), ::floorf(bounds.bottom / sTileSize)));
+    for(auto row = firstRow; row <= lastRow; ++row)
+      for(auto column = firstColumn; column <= lastColumn; ++column)
+        mTiles[size_t(row) * mNumTileColumns + column].spans.push_back(i);
+  }
+
+  // Tiles without spans are still cleared
+  mDirtyTiles.clear();
+  for(size_t i = 0; i < mTiles.size(); ++i)
+    if(!pDirty || mTiles[i].rect.Intersects(*pDirty))
+      mDirtyTiles.push_back(i);
+}
+
+
+bool CTiledCpuRenderer::Render(const CRenderList& list, const Rect2F* pDirty) {
+  BinSpans(list, pDirty);
+
+  std::atomic<bool> success(true);
+  mPool.Run(mDirtyTiles.size(), [&](size_t task, unsigned int worker) {
+    const auto& tile = mTiles[mDirtyTiles[task]];
+    const auto clip = pDirty ? Intersection(tile.rect, *pDirty) : tile.rect;
+    if(!mRenderers[worker]->RenderSpans(list, tile.spans.data(), tile.spans.size(), clip))
+      success = false;
+  });
+  return success;
+}
+
+
+CRenderer::CullStats CTiledCpuRenderer::TakeCullStats() {
+  const auto stats = mCullStats;
+  mCullStats = {};
+  return stats;
+}
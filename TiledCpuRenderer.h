@@ -0,0 +1,59 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "CpuRenderer.h"
+#include "WorkStealingPool.h"
+
+#include <memory>
+#include <vector>
+
+// Rasterizes frames on all workers of a pool. The spans of a frame are binned
+// into screen tiles by their bounds, then the tiles are rendered in parallel.
+// Within a tile, the spans are replayed in recording order, so the z-order is
+// the same as with a single CCpuRenderer, and so are the pixels.
+class CTiledCpuRenderer {
+public:
+  static constexpr int sTileSize = 64;
+
+  CTiledCpuRenderer(int width, int height, CWorkStealingPool& pool);
+
+  void Resize(int width, int height);
+
+  // See CRenderer::Render
+  bool Render(const CRenderList& list, const Rect2F* pDirty);
+  // See CRenderer::TakeCullStats
+  CRenderer::CullStats TakeCullStats();
+
+  int Width() const { return mWidth; }
+  int Height() const { return mHeight; }
+  const uint32_t* Pixels() const { return mPixels.data(); }
+  uint32_t Pixel(int x, int y) const { return mPixels[size_t(y) * mWidth + x]; }
+
+private:
+  struct Tile {
+    Rect2F rect;
+    // Indices of the spans that touch the tile, in recording order
+    std::vector<uint32_t> spans;
+  };
+
+  void BinSpans(const CRenderList& list, const Rect2F* pDirty);
+
+  CWorkStealingPool& mPool;
+
+  int mWidth = 0;
+  int mHeight = 0;
+  int mNumTileColumns = 0;
+  int mNumTileRows = 0;
+  std::vector<uint32_t> mPixels;
+
+  CRenderList::VisibleSpans mVisibleSpans;
+  CRenderer::CullStats mCullStats;
+
+  std::vector<Tile> mTiles;
+  // Tiles that need to be rendered this frame
+  std::vector<size_t> mDirtyTiles;
+
+  // One per worker, all rendering into mPixels
+  std::vector<std::unique_ptr<CCpuRenderer>> mRenderers;
+};
@@ -0,0 +1,44 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Passes values from one writer thread to one reader thread without locks.
+// The writer fills the back slot and publishes it, the reader takes the
+// latest published slot. Neither waits for the other: if the writer
+// publishes twice before the reader looks, the older value is dropped.
+template<typename T> class CTripleBuffer {
+public:
+  // Writer
+  T& Back() { return mSlots[mBack]; }
+
+  // Returns false if this replaced a value that the reader never took
+  bool Publish() {
+    const auto previous = mShared.exchange(mBack | sIsFresh, std::memory_order_acq_rel);
+    mBack = previous & sSlotMask;
+    return !(previous & sIsFresh);
+  }
+
+  // Reader. Returns whether Front() changed.
+  bool TakeLatest() {
+    if(!(mShared.load(std::memory_order_relaxed) & sIsFresh))
+      return false;
+
+    mFront = mShared.exchange(mFront, std::memory_order_acq_rel) & sSlotMask;
+    return true;
+  }
+
+  const T& Front() const { return mSlots[mFront]; }
+
+private:
+  static constexpr uint32_t sSlotMask = 3;
+  static constexpr uint32_t sIsFresh = 4;
+
+  T mSlots[3];
+  // Each slot is owned by exactly one of these at any time
+  uint32_t mBack = 0;
+  std::atomic<uint32_t> mShared{1};
+  uint32_t mFront = 2;
+};
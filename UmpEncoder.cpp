@@ -0,0 +1,87 @@
+// Copyright (c) v1ne
+
+#include "UmpEncoder.h"
+
+// Message type and status of MIDI 2.0 channel voice messages
+static constexpr uint32_t sChannelVoiceMessageType = 0x4;
+static constexpr uint32_t sAssignableControllerStatus = 0x3;
+static constexpr uint32_t sControlChangeStatus = 0xB;
+
+// The number of words of a packet, by message type
+static constexpr size_t sWordsPerPacket[16] = {1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4};
+
+static constexpr unsigned int sNumFineControllers = 32;
+
+
+uint32_t CUmpEncoder::UpscaleValue(uint32_t value, unsigned int numBits) {
+  const auto scaleBits = 32 - numBits;
+  auto shiftedValue = value << scaleBits;
+  // Values up to the center are only shifted
+  const auto center = 1u << (numBits - 1);
+  if(value <= center)
+    return shiftedValue;
+
+  // Above, the bits below the top one are repeated down to the last bit, so
+  // that the maximum becomes the maximum
+  const auto repeatBits = numBits - 1;
+  auto repeatValue = value & ((1u << repeatBits) - 1);
+  repeatValue = scaleBits > repeatBits ? repeatValue << (scaleBits - repeatBits) : repeatValue >> (repeatBits - scaleBits);
+  while(repeatValue) {
+    shiftedValue |= repeatValue;
+    repeatValue >>= repeatBits;
+  }
+  return shiftedValue;
+}
+
+
+void CUmpEncoder::ControlChange(uint8_t group, uint8_t channel, uint8_t index, uint32_t value) {
+  mWords.push_back(sChannelVoiceMessageType << 28 | uint32_t(group & 0xF) << 24 | sControlChangeStatus << 20
+    | uint32_t(channel & 0xF) << 16 | uint32_t(index & 0x7F) << 8);
+  mWords.push_back(value);
+}
+
+
+void CUmpEncoder::AssignableController(uint8_t group, uint8_t channel, uint8_t bank, uint8_t index, uint32_t value) {
+  mWords.push_back(sChannelVoiceMessageType << 28 | uint32_t(group & 0xF) << 24 | sAssignableControllerStatus << 20
+    | uint32_t(channel & 0xF) << 16 | uint32_t(bank & 0x7F) << 8 | (index & 0x7F));
+  mWords.push_back(value);
+}
+
+
+void CUmpDownConverter::SetFineController(uint8_t channel, uint8_t controller, bool isFine) {
+  if(controller >= sNumFineControllers)
+    return;
+  if(isFine)
+    mFineControllers[channel & 0xF] |= 1u << controller;
+  else
+    mFineControllers[channel & 0xF] &= ~(1u << controller);
+}
+
+
+void CUmpDownConverter::Translate(const uint32_t* pWords, size_t numWords, const uint16_t* pPreviousValues,
+    CMidiEncoder* pEncoder) {
+  size_t numPacket = 0;
+  for(size_t i = 0; i < numWords; i += sWordsPerPacket[pWords[i] >> 28], ++numPacket) {
+    const auto word = pWords[i];
+    if(word >> 28 != sChannelVoiceMessageType || i + 1 >= numWords)
+      continue;
+
+    const auto status = word >> 20 & 0xF;
+    const auto channel = uint8_t(word >> 16 & 0xF);
+    const auto value = pWords[i + 1];
+    const auto previousValue = pPreviousValues ? pPreviousValues[numPacket] : CMidiEncoder::sNoValue;
+    if(status == sControlChangeStatus) {
+      const auto controller = uint8_t(word >> 8 & 0x7F);
+      if(controller < sNumFineControllers && mFineControllers[channel] >> controller & 1)
+        pEncoder->Controller(channel, controller, MidiResolution::Cc14Bit, uint16_t(value >> 18), previousValue);
+      else
+        pEncoder->ControllerChange(channel, controller, uint8_t(value >> 25));
+    } else if(status == sAssignableControllerStatus) {
+      // CMidiEncoder only sends NRPNs with an MSB of 0
+      if(word >> 8 & 0x7F)
+        continue;
+      pEncoder->Controller(channel, uint8_t(word & 0x7F), MidiResolution::Nrpn14Bit, uint16_t(value >> 18),
+        previousValue);
+    }
+  }
+}
@@ -0,0 +1,51 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "MidiEncoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encodes MIDI 2.0 channel voice messages as Universal MIDI Packets. Each
+// packet takes two 32-bit words, and they're kept back to back, so that a
+// whole batch goes to the device at once.
+class CUmpEncoder {
+public:
+  // Scales a value with numBits bits to 32 bits, keeping the minimum, the
+  // center and the maximum, like MIDI 2.0 specifies
+  static uint32_t UpscaleValue(uint32_t value, unsigned int numBits);
+
+  void ControlChange(uint8_t group, uint8_t channel, uint8_t index, uint32_t value);
+  // What NRPNs are in MIDI 1.0
+  void AssignableController(uint8_t group, uint8_t channel, uint8_t bank, uint8_t index, uint32_t value);
+
+  void Clear() { mWords.clear(); }
+  const uint32_t* Data() const { return mWords.data(); }
+  size_t NumWords() const { return mWords.size(); }
+  size_t NumPackets() const { return mWords.size() / 2; }
+
+private:
+  std::vector<uint32_t> mWords;
+};
+
+// Translates MIDI 2.0 channel voice packets to a MIDI 1.0 byte stream, for
+// devices that only take MIDI 1.0. Control changes become 7-bit controller
+// changes, or MSB/LSB pairs if the controller is marked as fine, and
+// assignable controllers become NRPNs.
+class CUmpDownConverter {
+public:
+  // Whether controller 0-31 on the channel is sent as an MSB/LSB pair
+  void SetFineController(uint8_t channel, uint8_t controller, bool isFine);
+  // Appends the translation of the packets. Other packets are left out.
+  // pPreviousValues has a value per packet, which is the one the receiver
+  // has, in the resolution of the MIDI 1.0 message. With it, unchanged MSBs
+  // are left out like CMidiEncoder::Controller does. If it's null, every
+  // value is sent in full.
+  void Translate(const uint32_t* pWords, size_t numWords, const uint16_t* pPreviousValues, CMidiEncoder* pEncoder);
+
+private:
+  // A bit per fine controller, per channel
+  uint32_t mFineControllers[16] = {};
+};
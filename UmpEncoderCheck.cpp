@@ -0,0 +1,112 @@
+// Copyright (c) v1ne
+
+#include "UmpEncoderCheck.h"
+
+#include "UmpEncoder.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+const unsigned int sResolutions[] = {7, 14};
+const int sNumValues = 90;
+
+
+// Whether every value of the resolution scales up and back down to itself,
+// with the minimum, the center and the maximum in place, and larger values
+// staying larger
+bool CheckRoundTrip(unsigned int numBits, std::string* pReport) {
+  const auto maxValue = (1u << numBits) - 1;
+  const auto center = 1u << (numBits - 1);
+  unsigned int numChanged = 0, numOutOfOrder = 0;
+  uint32_t lastUpscaled = 0;
+  for(uint32_t value = 0; value <= maxValue; ++value) {
+    const auto upscaled = CUmpEncoder::UpscaleValue(value, numBits);
+    if(upscaled >> (32 - numBits) != value)
+      ++numChanged;
+    if(value && upscaled <= lastUpscaled)
+      ++numOutOfOrder;
+    lastUpscaled = upscaled;
+  }
+  const auto isAnchored = CUmpEncoder::UpscaleValue(0, numBits) == 0
+    && CUmpEncoder::UpscaleValue(center, numBits) == 0x8000'0000u
+    && CUmpEncoder::UpscaleValue(maxValue, numBits) == 0xFFFF'FFFFu;
+
+  char buf[160];
+  snprintf(buf, sizeof(buf), "%u-bit round trip: %u values, %u changed, %u out of order, %s\n", numBits,
+    maxValue + 1, numChanged, numOutOfOrder,
+    isAnchored ? "minimum, center and maximum in place" : "minimum, center or maximum MOVED");
+  *pReport += buf;
+  return !numChanged && !numOutOfOrder && isAnchored;
+}
+
+}
+
+
+bool CheckUmpEncoder(std::string* pReport) {
+  auto success = true;
+  char buf[160];
+
+  for(const auto numBits: sResolutions)
+    success &= CheckRoundTrip(numBits, pReport);
+
+  // Message type 4, group, status, channel, then the index
+  {
+    CUmpEncoder encoder;
+    encoder.ControlChange(1, 3, 7, 0x1234'5678u);
+    encoder.AssignableController(2, 4, 5, 6, 0x9ABC'DEF0u);
+    const uint32_t expected[] = {0x41B3'0700u, 0x1234'5678u, 0x4234'0506u, 0x9ABC'DEF0u};
+    const auto isGood = encoder.NumWords() == 4 && encoder.NumPackets() == 2
+      && std::equal(expected, expected + 4, encoder.Data());
+    snprintf(buf, sizeof(buf), "Packets: %08X %08X %08X %08X%s\n", encoder.Data()[0], encoder.Data()[1],
+      encoder.Data()[2], encoder.Data()[3], isGood ? "" : ", EXPECTED 41B30700 12345678 42340506 9ABCDEF0");
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  // Values of all resolutions, like MidiOutput sends them as MIDI 2.0, and
+  // the same values encoded for MIDI 1.0. Some of them keep the MSB of the
+  // value before.
+  {
+    CUmpEncoder encoder;
+    CUmpDownConverter downConverter;
+    CMidiEncoder direct;
+    std::vector<uint16_t> previousValues;
+    for(int i = 0; i < sNumValues; ++i) {
+      const auto resolution = MidiResolution(i % 3);
+      const auto channel = uint8_t(i / 30);
+      const auto controller = uint8_t(resolution == MidiResolution::Cc14Bit ? i % 32 : i);
+      const auto value = uint16_t(i * 1237 % (CMidiEncoder::MaxValue(resolution) + 1));
+      const auto previousValue = i % 4 == 1 ? uint16_t(CMidiEncoder::sNoValue) : uint16_t(value ^ (i % 2 ? 0x80 : 1));
+
+      const auto upscaled = CUmpEncoder::UpscaleValue(value, resolution == MidiResolution::Cc7Bit ? 7 : 14);
+      if(resolution == MidiResolution::Nrpn14Bit)
+        encoder.AssignableController(0, channel, 0, controller, upscaled);
+      else {
+        encoder.ControlChange(0, channel, controller, upscaled);
+        downConverter.SetFineController(channel, controller, resolution == MidiResolution::Cc14Bit);
+      }
+      previousValues.push_back(previousValue);
+      direct.Controller(channel, controller, resolution, value, previousValue);
+    }
+
+    // A NOOP utility message, which takes a word and has nothing to translate to
+    std::vector<uint32_t> words(encoder.Data(), encoder.Data() + encoder.NumWords());
+    words.insert(words.begin() + sNumValues, 0);
+    previousValues.insert(previousValues.begin() + sNumValues / 2, uint16_t(CMidiEncoder::sNoValue));
+
+    CMidiEncoder downConverted;
+    downConverter.Translate(words.data(), words.size(), previousValues.data(), &downConverted);
+    const auto isGood = downConverted.Size() == direct.Size()
+      && std::equal(direct.Data(), direct.Data() + direct.Size(), downConverted.Data());
+    snprintf(buf, sizeof(buf), "Down-conversion: %u packets into %u bytes, %s %u bytes of MIDI 1.0\n",
+      unsigned(encoder.NumPackets()), unsigned(downConverted.Size()), isGood ? "same as the" : "DIFFERENT from the",
+      unsigned(direct.Size()));
+    *pReport += buf;
+    success &= isGood;
+  }
+
+  return success;
+}
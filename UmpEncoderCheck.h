@@ -0,0 +1,14 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <string>
+
+// Checks the MIDI 2.0 path: 7-bit and 14-bit values have to scale up to 32
+// bits keeping the minimum, the center and the maximum, and scale back down
+// to what they were. Packets have to have the layout of MIDI 2.0 control
+// changes and assignable controllers, and down-converting them has to give
+// the same bytes as encoding the values for MIDI 1.0 right away.
+//
+// Returns whether all checks passed. pReport receives a line per check.
+bool CheckUmpEncoder(std::string* pReport);
@@ -20,7 +20,6 @@ bool gShiftPressed = false;
 
 ViewBase::ViewBase(HWND hWnd, CD2DDriver* pD2dDriver)
   : mhWnd(hWnd)
-  , mpRenderTarget(pD2dDriver->GetRenderTarget())
   , mD2dDriver(pD2dDriver)
 { InitializeBase(); }
 
@@ -38,6 +37,17 @@ ViewBase::~ViewBase() {
 }
 
 
+Rect2F ViewBase::Bounds() {
+  const auto radius = Point2F{Size().mag() / 2.f};
+  return Rect2F::FromPoints(Center() - radius, Center() + radius);
+}
+
+
+ViewBase::Detail ViewBase::DetailOnScreen(const CRenderList& list) {
+  return ::DetailOnScreen(list, mSize);
+}
+
+
 bool ViewBase::InitializeBase() {
   if(FAILED(CoCreateInstance(CLSID_ManipulationProcessor, NULL,
       CLSCTX_INPROC_SERVER, IID_IUnknown, (VOID**)(&mpManipulationProc))))
@@ -100,6 +110,7 @@ void CTransformableDrawingObject::ResetState(Point2F start, Point2F clientArea,
 
   m_fFactor = 1.0f;
   m_fAngleCumulative = 0.0f;
+  m_fAngleApplied = 0.0f;
 }
 
 
@@ -240,3 +251,29 @@ float CTransformableDrawingObject::PivotRadius()
   const auto halfSize = Size() / 2.f;
   return ::sqrtf(::powf(halfSize.x, 2) + ::powf(halfSize.y, 2)) * 0.4f;
 }
+
+
+bool CTransformableDrawingObject::IsInPaintedRect(Point2F pos, float cornerRadius)
+{
+  // In the coordinates of the unrotated rect, relative to its center
+  const auto center = mRenderPos + Size() / 2.f;
+  const auto local = Transform2F::Rotation(-m_fAngleCumulative, center).Apply(pos) - center;
+  const auto halfSize = Size() / 2.f;
+  const auto distance = Point2F{::fabsf(local.x), ::fabsf(local.y)};
+  if(distance.x > halfSize.x || distance.y > halfSize.y)
+    return false;
+
+  // Within the square of a corner, the point has to be on its arc
+  const auto radius = ::fminf(cornerRadius, ::fminf(halfSize.x, halfSize.y));
+  const auto corner = distance - (halfSize - Point2F{radius});
+  return corner.x <= 0.f || corner.y <= 0.f || corner.mag() <= radius;
+}
+
+
+// Views are painted at their render position, which lags behind while they bounce
+Rect2F CTransformableDrawingObject::Bounds()
+{
+  const auto center = mRenderPos + Size() / 2.f;
+  const auto radius = Point2F{Size().mag() / 2.f};
+  return Rect2F::FromPoints(center - radius, center + radius);
+}
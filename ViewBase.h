@@ -9,8 +9,11 @@
 #pragma once
 
 #include "D2DDriver.h"
+#include "FrameArena.h"
 #include "Geometry.h"
 #include "ManipulationCallbacks.h"
+#include "RenderList.h"
+#include "ViewPainter.h"
 
 extern bool gShiftPressed;
 
@@ -22,19 +25,27 @@ public:
   enum TouchEventType {DOWN, MOVE, UP, INERTIA};
   virtual bool HandleTouchEvent(TouchEventType type, Point2F pos, const TOUCHINPUT* pData);
 
-  virtual void Paint() = 0;
+  // Records the draw commands of the view. The arena is for transient data,
+  // which is valid until the frame has been recorded.
+  virtual void Paint(CRenderList& list, CFrameArena& arena) = 0;
   virtual bool InRegion(Point2F pos) = 0;
 
   inline Point2F Pos() { return mPos; }
   inline Point2F Size() { return mSize; }
   Point2F Center() { return Pos() + Size() / 2.f; }
+  // Encloses what the view paints while it isn't touched, at any rotation
+  virtual Rect2F Bounds();
   virtual Point2F PivotPoint() = 0;
   virtual float PivotRadius() = 0;
 
+  using Detail = ViewDetail;
+
 protected:
+  // The detail for the view that's being recorded into list
+  Detail DetailOnScreen(const CRenderList& list);
+
   HWND mhWnd;
   CD2DDriver* mD2dDriver;
-  ID2D1HwndRenderTargetPtr mpRenderTarget;
 
   // Real top-left coordinate of object
   Point2F mPos;
@@ -61,8 +72,14 @@ public:
 
   Point2F PivotPoint() override;
   float PivotRadius() override;
+  Rect2F Bounds() override;
 
 protected:
+  // Whether pos is on the rect that the view is painted in, which is rotated
+  // about its center. Computed from the current state, so that it holds for
+  // views that haven't been painted yet.
+  bool IsInPaintedRect(Point2F pos, float cornerRadius = 0.f);
+
   void RestoreRealPosition();
   void SetManipulationOrigin(Point2F origin);
   void Translate(Point2F delta, bool bInertia);
@@ -78,8 +95,7 @@ protected:
   Point2F mRightBottomBorders; // Right and bottom borders relative to the object's size
   Point2F mClientArea; // Client width and height
 
-  D2D_MATRIX_3X2_F m_lastMatrix = {}; // Keeps the last matrix used to perform the rotate transform
-  float m_fFactor; // Scaling factor applied to the object
-  float m_fAngleCumulative; // Cumulative angular rotation applied to the object
-  float m_fAngleApplied; // Current angular rotation applied to object
+  float m_fFactor = 1.0f; // Scaling factor applied to the object
+  float m_fAngleCumulative = 0.0f; // Cumulative angular rotation applied to the object
+  float m_fAngleApplied = 0.0f; // Current angular rotation applied to object
 };
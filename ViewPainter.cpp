@@ -0,0 +1,143 @@
+// Copyright (c) v1ne
+
+#include "ViewPainter.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Shorter side of a view on screen, in logical points, below which its
+// labels and then everything but its shape can't be made out any more
+static constexpr auto sMinSizeForFullDetail = 30.f;
+static constexpr auto sMinSizeForReducedDetail = 10.f;
+
+static constexpr auto sSquareCornerRadius = 10.f;
+
+
+ViewDetail DetailOnScreen(const CRenderList& list, Point2F size) {
+  const auto sizeOnScreen = ::fminf(size.x, size.y) * list.ViewTransform().ScaleFactor() * list.DetailScale();
+  if(sizeOnScreen < sMinSizeForReducedDetail)
+    return ViewDetail::Flat;
+  return sizeOnScreen < sMinSizeForFullDetail ? ViewDetail::Reduced : ViewDetail::Full;
+}
+
+
+float KnobRadius(Point2F size) {
+  const auto border = Point2F{size.x / 8, size.y / 8};
+  return ::fminf((size.x - border.x)/2, (size.y - border.y)/2);
+}
+
+
+// Paints the parts that only change with size and rotation, in layer coordinates
+static void PaintFace(CRenderList& list, const SliderLook& look, ViewDetail detail) {
+  list.FillRect({0, 0, look.size.x, look.size.y}, BrushId::LightGrey);
+
+  if(!look.isKnob)
+    return;
+
+  const auto center = look.size / 2.f;
+  const auto knobRadius = KnobRadius(look.size);
+  list.FillEllipse(center, Point2F{knobRadius}, BrushId::DarkGrey);
+
+  if(detail != ViewDetail::Full)
+    return;
+
+  for(int i = 0; i <= 270; i += 30) {
+    list.FillTiltedRect(center, knobRadius, float(-135 - i), {3.f, 1.f}, BrushId::Black);
+  }
+}
+
+
+static void PaintSliderValue(CRenderList& list, const SliderLook& look, ViewDetail detail) {
+  const auto& pos = look.pos;
+  const auto& size = look.size;
+  const auto borderWidth = size.x / 4;
+  const auto topBorder = size.y * 10 / 100;
+  const auto bottomPos = pos.y + size.y;
+  const auto topPos = bottomPos - look.value * (size.y - topBorder);
+
+  list.FillRect({pos.x + borderWidth, topPos, pos.x + size.x - borderWidth, bottomPos}, look.valueBrush);
+
+  // The label is too small to be read
+  if(detail != ViewDetail::Full)
+    return;
+
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%d%%", int(look.value*100));
+  list.Text({pos.x, pos.y, pos.x + size.x, pos.y + topBorder}, TextStyle::Small, BrushId::DimGrey, buf);
+}
+
+
+static void PaintKnobValue(CRenderList& list, const SliderLook& look, ViewDetail detail) {
+  const auto& size = look.size;
+  const auto border = Point2F{size.x / 8, size.y / 8};
+  const auto center = look.pos + size / 2.f;
+  const auto knobRadius = KnobRadius(size);
+
+  const auto knobMarkAngle = -135.f - look.value * 270;
+  const auto markSize = Point2F{10.f, 5.f};
+  list.FillTiltedRect(center, knobRadius - markSize.x, knobMarkAngle, markSize, look.valueBrush);
+
+  if(detail != ViewDetail::Full)
+    return;
+
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%d%%", int(look.value*100));
+  list.Text({center.x - size.x/3, center.y - border.y, center.x + size.x/3, center.y + border.y}, TextStyle::Small, BrushId::DimGrey, buf);
+}
+
+
+void PaintSliderLook(CRenderList& list, const void* pOwner, const SliderLook& look, ViewDetail detail) {
+  const auto center = look.pos + look.size / 2.f;
+
+  // The face doesn't depend on the value, so it's recorded as a layer, which
+  // the renderer composites from the layer cache. A flat slider has none.
+  list.SetTransform(Transform2F::Identity());
+  if(detail != ViewDetail::Flat) {
+    list.BeginLayer(pOwner, 0, look.size, look.degAngle, center);
+    PaintFace(list, look, detail);
+    list.EndLayer();
+  }
+
+  list.SetTransform(Transform2F::Rotation(look.degAngle, center));
+  if(detail == ViewDetail::Flat)
+    list.FillRect(Rect2F::FromPoints(look.pos, look.pos + look.size), look.valueBrush);
+  else if(look.isKnob)
+    PaintKnobValue(list, look, detail);
+  else
+    PaintSliderValue(list, look, detail);
+
+  list.SetTransform(Transform2F::Identity());
+}
+
+
+void PaintSquareLook(CRenderList& list, const SquareLook& look, ViewDetail detail) {
+  const auto fGlOffset = 2.5f;
+  const auto& pos = look.pos;
+  const auto& size = look.size;
+
+  list.SetTransform(Transform2F::Rotation(look.degAngle, pos + size / 2.f));
+
+  // Set positions of gradients based on the new coordinates of the objecs
+  const auto brush = Brush(look.gradientBrush, pos, {pos.x, pos.y + size.y});
+  const auto glossyBrush = Brush(BrushId::GradientGlossy, pos, {pos.x + size.x/15.0f, pos.y + size.y/2.0f});
+
+  const auto rectangle = Rect2F{pos.x, pos.y, pos.x + size.x, pos.y + size.y};
+  const auto glossyRect = Rect2F{pos.x + fGlOffset, pos.y + fGlOffset, pos.x + size.x - fGlOffset, pos.y + size.y/2.0f};
+  const auto cornerRadii = Point2F{sSquareCornerRadius};
+
+  // Small squares drop the gradient and the glossy effect, tiny ones are plain rects
+  switch(detail) {
+  case ViewDetail::Full:
+    list.FillRoundedRect(rectangle, cornerRadii, brush);
+    list.FillRoundedRect(glossyRect, cornerRadii, glossyBrush);
+    break;
+  case ViewDetail::Reduced:
+    list.FillRoundedRect(rectangle, cornerRadii, look.flatBrush);
+    break;
+  case ViewDetail::Flat:
+    list.FillRect(rectangle, look.flatBrush);
+    break;
+  }
+
+  list.SetTransform(Transform2F::Identity());
+}
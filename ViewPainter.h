@@ -0,0 +1,49 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "Geometry.h"
+#include "RenderList.h"
+
+// How much of a view is painted, depending on its size on screen
+enum class ViewDetail {
+  Full,
+  // Without labels, tick marks and gradients
+  Reduced,
+  // A flat rect in the color of the view
+  Flat,
+};
+
+// The detail for a view of this size that's being recorded into list
+ViewDetail DetailOnScreen(const CRenderList& list, Point2F size);
+
+// What a slider or a knob shows while it isn't dragged. The views paint
+// themselves from it, and so do the headless checks, which have no views.
+struct SliderLook {
+  // Top-left corner and size, rotated by degAngle about the center
+  Point2F pos;
+  Point2F size;
+  float degAngle;
+  bool isKnob;
+  float value;
+  // For the value and the flat rect
+  BrushId valueBrush;
+};
+
+// Records the face layer, which pOwner identifies in the layer cache, the
+// value and the label. Leaves the transform at identity.
+void PaintSliderLook(CRenderList& list, const void* pOwner, const SliderLook& look, ViewDetail detail);
+// The radius of the knob of a knob this size
+float KnobRadius(Point2F size);
+
+struct SquareLook {
+  Point2F pos;
+  Point2F size;
+  float degAngle;
+  BrushId gradientBrush;
+  // For small squares, which drop the gradient
+  BrushId flatBrush;
+};
+
+// Leaves the transform at identity
+void PaintSquareLook(CRenderList& list, const SquareLook& look, ViewDetail detail);
@@ -12,28 +12,166 @@
 #endif
 
 #include "ComTouchDriver.h"
-#include "MidiOutput.h"
-
+#include "ControlRing.h"
+#include "ControlRingCheck.h"
+#include "ControlStateCheck.h"
+#include "Layout.h"
+#include "MidiBenchmark.h"
+#include "MidiRouter.h"
+#include "MidiScheduler.h"
+#include "OscOutput.h"
+#include "RenderCheck.h"
+#include "SelfCheck.h"
+#include "Slider.h"
+#include "StartupTimeline.h"
+
+#include <math.h>
 #include <memory>
+#include <shellapi.h>
+#include <string>
 #include <tchar.h>
 #include <tpcshrd.h>
+#include <vector>
 #include <windows.h>
+#include <windowsx.h>
 
 
 HWND ghWnd;
 std::unique_ptr<CComTouchDriver> gpTouchDriver;
-MidiOutput gMidiOutput;
+CMidiRouter gMidiRouter;
+// Stops sending before the router goes away
+CMidiScheduler gMidiScheduler(&gMidiRouter);
+COscOutput gOscOutput;
+CControlRing gControlRing;
+// The compiled layout to use, if any
+std::wstring gLayoutPath;
+// Where the values of the controls are kept between runs
+const wchar_t* const gpStatePath = L"ControlState.bin";
+// Controller changes are sent once an input message is handled, or once this
+// many bytes have collected
+size_t gMidiFlushThresholdBytes = 256;
+// From input to sending. 0 sends right away.
+unsigned int gMidiLatencyMs = 0;
+auto gMidiProtocol = MidiOutput::Protocol::Midi1;
+// The WinMM devices that layouts refer to as device 1, 2, ...
+std::vector<unsigned int> gMidiDevices;
+// The WinMM input devices of device 1, 2, ...
+std::vector<unsigned int> gMidiInputDevices;
+// Tells the window that an input has values. wParam is the device.
+constexpr UINT WM_MIDI_INPUT = WM_APP + 1;
+// OSC is off without a port
+uint16_t gOscPort = 0;
+std::wstring gOscHost = L"127.0.0.1";
+// The shared ring is off without a name
+std::wstring gRingName;
 
 ATOM MyRegisterClass(HINSTANCE hInst);
 BOOL InitInstance(HINSTANCE hinst, int nCmdShow, ATOM hClass);
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 void SetTabletInputServiceProperties();
 void FillInputData(TOUCHINPUT* inData, DWORD cursor, DWORD eType, DWORD time, int x, int y);
-
+int CompileLayoutCommand(const wchar_t* textPath, const wchar_t* binaryPath);
+int CompareRenderersCommand();
+int CheckStateFileCommand();
+int CheckRingCommand();
+int ReadRingCommand(const wchar_t* name);
+int SelfCheckCommand(const wchar_t* name);
+
+// Usage:
+//   Win32TouchSliders [/layout <compiled layout>]
+//     Uses the layout, or Layout.bin in the working directory, or the built-in one.
+//     The values of the controls are kept in ControlState.bin in the working directory.
+//   Win32TouchSliders [/midi-out <WinMM device>]...
+//     Opens MIDI outputs, in the order that layouts number them. Device 1 by default.
+//   Win32TouchSliders [/midi-in <WinMM input device>]...
+//     Takes values back from the devices, in the order of /midi-out. None by default.
+//   Win32TouchSliders [/midi-buffer <bytes>]
+//     Flushes MIDI messages once this many bytes have collected. 0 sends each on its own.
+//   Win32TouchSliders [/midi-latency <ms>]
+//     Sends values this long after their input, evenly. 0 sends right away.
+//   Win32TouchSliders [/midi2]
+//     Sends MIDI 2.0 control changes, down-converted for MIDI 1.0 devices
+//   Win32TouchSliders [/osc <UDP port>] [/osc-host <IPv4 address>]
+//     Also sends the values as OSC bundles, to the local host by default
+//   Win32TouchSliders [/shared-ring <name>]
+//     Also publishes the values in shared memory, e.g. Local\Win32TouchSliders,
+//     for CControlRingReader in other processes
+//   Win32TouchSliders /compile-layout <text layout> <compiled layout>
+//     Compiles a layout and exits
+//   Win32TouchSliders /compare-renderers
+//     Checks that the tiled CPU renderer paints the same pixels as the plain one and exits
+//   Win32TouchSliders /check-state-file
+//     Checks that the state file survives killing the process while it's written and exits
+//   Win32TouchSliders /check-ring
+//     Checks that readers of the shared ring get every value or count it as lost and exits
+//   Win32TouchSliders /read-ring <name>
+//     Prints the values of another instance's /shared-ring as they come, until Ctrl+C
+//   Win32TouchSliders /self-check [<name>]
+//     Runs a check or benchmark of SelfCheck.h or MidiBenchmark.h, or all checks,
+//     and exits. Golden images are in Headless\Golden below the working directory.
 int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR pCmdLine, int nCmdShow) {
   UNREFERENCED_PARAMETER(pCmdLine);
   UNREFERENCED_PARAMETER(nCmdShow);
 
+  int numArgs = 0;
+  auto* pArgs = ::CommandLineToArgvW(::GetCommandLineW(), &numArgs);
+  for(int i = 1; pArgs && i < numArgs; ++i) {
+    if(!wcscmp(pArgs[i], L"/compile-layout") && i + 2 < numArgs) {
+      const auto result = CompileLayoutCommand(pArgs[i + 1], pArgs[i + 2]);
+      ::LocalFree(pArgs);
+      return result;
+    }
+    if(!wcscmp(pArgs[i], L"/compare-renderers")) {
+      ::LocalFree(pArgs);
+      return CompareRenderersCommand();
+    }
+    if(!wcscmp(pArgs[i], L"/check-state-file")) {
+      ::LocalFree(pArgs);
+      return CheckStateFileCommand();
+    }
+    if(!wcscmp(pArgs[i], L"/check-ring")) {
+      ::LocalFree(pArgs);
+      return CheckRingCommand();
+    }
+    if(!wcscmp(pArgs[i], L"/read-ring") && i + 1 < numArgs) {
+      const auto result = ReadRingCommand(pArgs[i + 1]);
+      ::LocalFree(pArgs);
+      return result;
+    }
+    if(!wcscmp(pArgs[i], L"/self-check")) {
+      const auto result = SelfCheckCommand(i + 1 < numArgs ? pArgs[i + 1] : nullptr);
+      ::LocalFree(pArgs);
+      return result;
+    }
+    if(!wcscmp(pArgs[i], L"/state-writer") && i + 2 < numArgs) {
+      // The child process of /check-state-file
+      const auto result = RunControlStateWriter(pArgs[i + 1], pArgs[i + 2]);
+      ::LocalFree(pArgs);
+      return result;
+    }
+    if(!wcscmp(pArgs[i], L"/layout") && i + 1 < numArgs)
+      gLayoutPath = pArgs[++i];
+    else if(!wcscmp(pArgs[i], L"/midi-out") && i + 1 < numArgs)
+      gMidiDevices.push_back(unsigned(wcstoul(pArgs[++i], nullptr, 10)));
+    else if(!wcscmp(pArgs[i], L"/midi-in") && i + 1 < numArgs)
+      gMidiInputDevices.push_back(unsigned(wcstoul(pArgs[++i], nullptr, 10)));
+    else if(!wcscmp(pArgs[i], L"/midi-buffer") && i + 1 < numArgs)
+      gMidiFlushThresholdBytes = size_t(wcstoul(pArgs[++i], nullptr, 10));
+    else if(!wcscmp(pArgs[i], L"/midi-latency") && i + 1 < numArgs)
+      gMidiLatencyMs = unsigned(wcstoul(pArgs[++i], nullptr, 10));
+    else if(!wcscmp(pArgs[i], L"/midi2"))
+      gMidiProtocol = MidiOutput::Protocol::Midi2;
+    else if(!wcscmp(pArgs[i], L"/osc") && i + 1 < numArgs)
+      gOscPort = uint16_t(wcstoul(pArgs[++i], nullptr, 10));
+    else if(!wcscmp(pArgs[i], L"/osc-host") && i + 1 < numArgs)
+      gOscHost = pArgs[++i];
+    else if(!wcscmp(pArgs[i], L"/shared-ring") && i + 1 < numArgs)
+      gRingName = pArgs[++i];
+  }
+  ::LocalFree(pArgs);
+  if(gLayoutPath.empty() && ::GetFileAttributesW(L"Layout.bin") != INVALID_FILE_ATTRIBUTES)
+    gLayoutPath = L"Layout.bin";
+
   if(FAILED(CoInitializeEx(NULL, COINIT_APARTMENTTHREADED)))
   return 0;
 
@@ -42,15 +180,51 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR pCmdLine, int nCmdS
     return 0;
   }
 
-  if (!gMidiOutput.open(1)) {
-    printf("Failed to open MIDI output\n");
-    ::OutputDebugStringA("Failed to open MIDI output\n");
-  } else {
-    wprintf(L"Connected to MIDI device: %s\n", gMidiOutput.mDeviceName.c_str());
-    ::OutputDebugStringA("Connected to MIDI device: ");
-    ::OutputDebugStringW(gMidiOutput.mDeviceName.c_str());
-    ::OutputDebugStringA("\n");
+  const auto beginMidi = CStartupTimeline::Clock::now();
+  if(gMidiDevices.empty())
+    gMidiDevices.push_back(1);
+  auto isAnyMidiOpen = false;
+  for(const auto numDevice: gMidiDevices) {
+    const auto isMidiOpen = gMidiRouter.AddOutput(numDevice);
+    const auto& deviceName = gMidiRouter.Output(gMidiRouter.NumOutputs() - 1).mDeviceName;
+    if (!isMidiOpen) {
+      printf("Failed to open MIDI output %u\n", numDevice);
+      ::OutputDebugStringA("Failed to open MIDI output\n");
+    } else {
+      wprintf(L"Connected to MIDI device: %s\n", deviceName.c_str());
+      ::OutputDebugStringA("Connected to MIDI device: ");
+      ::OutputDebugStringW(deviceName.c_str());
+      ::OutputDebugStringA("\n");
+    }
+    isAnyMidiOpen |= isMidiOpen;
+  }
+  for(const auto numDevice: gMidiInputDevices) {
+    if(!gMidiRouter.AddInput(numDevice, ghWnd, WM_MIDI_INPUT)) {
+      printf("Failed to open MIDI input %u\n", numDevice);
+      ::OutputDebugStringA("Failed to open MIDI input\n");
+    } else {
+      ::OutputDebugStringA("Listening to MIDI device: ");
+      ::OutputDebugStringW(gMidiRouter.Input(gMidiRouter.NumInputs() - 1).DeviceName().c_str());
+      ::OutputDebugStringA("\n");
+    }
+  }
+  gMidiRouter.SetBuffering(gMidiFlushThresholdBytes);
+  gMidiRouter.SetProtocol(gMidiProtocol);
+  gMidiScheduler.SetLatency(gMidiLatencyMs * 1000);
+  gStartupTimeline.Record("MIDI output", beginMidi);
+
+  if(gOscPort && !gOscOutput.Open(gOscHost.c_str(), gOscPort)) {
+    printf("Failed to open OSC output\n");
+    ::OutputDebugStringA("Failed to open OSC output\n");
   }
+  if(!gRingName.empty() && !gControlRing.Open(gRingName.c_str())) {
+    printf("Failed to open the shared ring\n");
+    ::OutputDebugStringA("Failed to open the shared ring\n");
+  }
+
+  // The devices get the values that were restored right away
+  if(isAnyMidiOpen)
+    gpTouchDriver->ResyncMidi();
 
   MSG msg;
   while (GetMessage(&msg, NULL, 0, 0)) {
@@ -61,6 +235,151 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR pCmdLine, int nCmdS
   return 1;
 }
 
+// Returns the exit code
+int CompileLayoutCommand(const wchar_t* textPath, const wchar_t* binaryPath) {
+  // Report to the console that started us, if any
+  FILE* pConsole = nullptr;
+  if(::AttachConsole(ATTACH_PARENT_PROCESS))
+    freopen_s(&pConsole, "CONOUT$", "w", stdout);
+
+  std::string error;
+  const auto success = CompileLayoutFile(textPath, binaryPath, &error);
+  if(success)
+    wprintf(L"Compiled %s into %s\n", textPath, binaryPath);
+  else
+    wprintf(L"Failed to compile %s: %S\n", textPath, error.c_str());
+  ::OutputDebugStringA(success ? "Compiled the layout\n" : ("Failed to compile the layout: " + error + "\n").c_str());
+
+  if(pConsole)
+    fclose(pConsole);
+  return success ? 0 : 1;
+}
+
+// Returns the exit code
+int CompareRenderersCommand() {
+  FILE* pConsole = nullptr;
+  if(::AttachConsole(ATTACH_PARENT_PROCESS))
+    freopen_s(&pConsole, "CONOUT$", "w", stdout);
+
+  std::string report;
+  const auto success = CompareCpuRenderers(&report);
+  printf("%s%s\n", report.c_str(), success ? "The renderers match" : "The renderers differ");
+  ::OutputDebugStringA(report.c_str());
+
+  if(pConsole)
+    fclose(pConsole);
+  return success ? 0 : 1;
+}
+
+// Returns the exit code
+int CheckStateFileCommand() {
+  FILE* pConsole = nullptr;
+  if(::AttachConsole(ATTACH_PARENT_PROCESS))
+    freopen_s(&pConsole, "CONOUT$", "w", stdout);
+
+  std::string report;
+  const auto success = CheckControlStateFile(&report);
+  printf("%s%s\n", report.c_str(), success ? "The state file is intact" : "The state file is damaged");
+  ::OutputDebugStringA(report.c_str());
+
+  if(pConsole)
+    fclose(pConsole);
+  return success ? 0 : 1;
+}
+
+// Returns the exit code
+int CheckRingCommand() {
+  FILE* pConsole = nullptr;
+  if(::AttachConsole(ATTACH_PARENT_PROCESS))
+    freopen_s(&pConsole, "CONOUT$", "w", stdout);
+
+  std::string report;
+  const auto success = CheckControlRing(&report);
+  printf("%s%s\n", report.c_str(), success ? "The ring is consistent" : "The ring is inconsistent");
+  ::OutputDebugStringA(report.c_str());
+
+  if(pConsole)
+    fclose(pConsole);
+  return success ? 0 : 1;
+}
+
+// Returns the exit code if there is no ring, otherwise runs until it's killed, e.g. by Ctrl+C
+int ReadRingCommand(const wchar_t* name) {
+  FILE* pConsole = nullptr;
+  if(::AttachConsole(ATTACH_PARENT_PROCESS))
+    freopen_s(&pConsole, "CONOUT$", "w", stdout);
+
+  CControlRingReader reader;
+  if(!reader.Open(name)) {
+    wprintf(L"There's no ring named %s\n", name);
+    if(pConsole)
+      fclose(pConsole);
+    return 1;
+  }
+
+  // Each value with the time it took to get here
+  CControlRing::Value values[256];
+  uint64_t numLost = 0;
+  for(;;) {
+    const auto numRead = reader.Read(values, sizeof(values) / sizeof(values[0]));
+    LARGE_INTEGER now;
+    ::QueryPerformanceCounter(&now);
+    for(size_t i = 0; i < numRead; ++i)
+      printf("Control %u: %f, %d us ago\n", values[i].control, values[i].value,
+        int((now.QuadPart - values[i].ticks) * 1000000 / reader.TicksPerSecond()));
+    if(reader.NumLost() != numLost) {
+      printf("Lost %u values\n", unsigned(reader.NumLost() - numLost));
+      numLost = reader.NumLost();
+    }
+    fflush(stdout);
+    ::Sleep(10);
+  }
+}
+
+// Returns the exit code
+int SelfCheckCommand(const wchar_t* name) {
+  FILE* pConsole = nullptr;
+  if(::AttachConsole(ATTACH_PARENT_PROCESS))
+    freopen_s(&pConsole, "CONOUT$", "w", stdout);
+
+  std::vector<const SelfCheck*> checks;
+  if(name) {
+    // The names are ASCII
+    std::string narrowName;
+    for(auto* pChar = name; *pChar; ++pChar)
+      narrowName += char(*pChar);
+    if(const auto* pCheck = FindSelfCheck(narrowName.c_str()))
+      checks.push_back(pCheck);
+    for(size_t i = 0; i < gNumMidiBenchmarks; ++i)
+      if(narrowName == gMidiBenchmarks[i].pName)
+        checks.push_back(&gMidiBenchmarks[i]);
+    if(checks.empty()) {
+      printf("There's no self-check named %s. There are:\n", narrowName.c_str());
+      for(size_t i = 0; i < gNumSelfChecks; ++i)
+        printf("  %s: %s\n", gSelfChecks[i].pName, gSelfChecks[i].pDescription);
+      for(size_t i = 0; i < gNumMidiBenchmarks; ++i)
+        printf("  %s: %s\n", gMidiBenchmarks[i].pName, gMidiBenchmarks[i].pDescription);
+    }
+  } else {
+    for(size_t i = 0; i < gNumSelfChecks; ++i)
+      if(!gSelfChecks[i].isBenchmark)
+        checks.push_back(&gSelfChecks[i]);
+  }
+
+  auto success = !checks.empty();
+  for(const auto* pCheck: checks) {
+    std::string report;
+    const auto isPassed = pCheck->pRun(SelfCheckOptions(), &report);
+    printf("== %s\n%s%s\n", pCheck->pName, report.c_str(), isPassed ? "Passed" : "FAILED");
+    ::OutputDebugStringA(report.c_str());
+    success &= isPassed;
+  }
+
+  if(pConsole)
+    fclose(pConsole);
+  return success ? 0 : 1;
+}
+
 // Register Window Class
 ATOM MyRegisterClass(HINSTANCE hInst)
 {
@@ -84,8 +403,10 @@ BOOL InitInstance(HINSTANCE hInst, int nCmdShow, ATOM hClass)
 {
   BOOL success = TRUE;
 
+  const auto beginWindow = CStartupTimeline::Clock::now();
   ghWnd = CreateWindowEx(0, MAKEINTATOM(hClass), L"Win32 Touch Sliders", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
     CW_USEDEFAULT, CW_USEDEFAULT, NULL, NULL, hInst, 0);
+  gStartupTimeline.Record("Window creation", beginWindow);
 
 
   if(!ghWnd)
@@ -98,7 +419,7 @@ BOOL InitInstance(HINSTANCE hInst, int nCmdShow, ATOM hClass)
   if(success)
   {
     gpTouchDriver = std::make_unique<CComTouchDriver>(ghWnd);
-    success = gpTouchDriver->Initialize();
+    success = gpTouchDriver->Initialize(gLayoutPath.empty() ? nullptr : gLayoutPath.c_str(), gpStatePath);
   }
 
   if(success)
@@ -109,8 +430,11 @@ BOOL InitInstance(HINSTANCE hInst, int nCmdShow, ATOM hClass)
     // Ready for handling WM_TOUCH messages
     RegisterTouchWindow(ghWnd, 0);
 
+    // Includes recording the first frame
+    const auto beginShow = CStartupTimeline::Clock::now();
     ShowWindow(ghWnd, nCmdShow);
     UpdateWindow(ghWnd);
+    gStartupTimeline.Record("Showing the window", beginShow);
   }
   return success;
 }
@@ -132,7 +456,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     auto NumContacts = LOWORD(wParam);
     hInput = (HTOUCHINPUT)lParam;
 
-    pInputs = new TOUCHINPUT[NumContacts];
+    auto& arena = gpTouchDriver->InputArena();
+    pInputs = arena.AllocateArray<TOUCHINPUT>(NumContacts);
     if(::GetTouchInputInfo(hInput, NumContacts, pInputs, sizeof(TOUCHINPUT))) {
       for(int i = 0; i < NumContacts; i++) {
         POINT physicalPoint = {pInputs[i].x/100, pInputs[i].y/100};
@@ -144,8 +469,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
       gpTouchDriver->RunInertiaProcessorsAndRender();
     }
 
-    delete [] pInputs;
     CloseTouchInputHandle(hInput);
+    arena.Reset();
     break; }
 
   case WM_LBUTTONDOWN:
@@ -166,6 +491,14 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     gpTouchDriver->ProcessInputEvent(&tInput);
     break;
 
+  case WM_MOUSEWHEEL: {
+    // One notch zooms by 20%, around the mouse pointer
+    POINT physicalPoint = {GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam)};
+    ::ScreenToClient(ghWnd, &physicalPoint);
+    const auto notches = float(GET_WHEEL_DELTA_WPARAM(wParam)) / WHEEL_DELTA;
+    gpTouchDriver->ZoomCanvas(::powf(1.2f, notches), {physicalPoint.x, physicalPoint.y});
+    break; }
+
   case WM_DESTROY:
     PostQuitMessage(0);
     return 1;
@@ -177,21 +510,46 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
     break; }
 
   case WM_PAINT:
+    // The render thread draws into the window
     BeginPaint(ghWnd, &ps);
-    gpTouchDriver->RenderObjects();
     EndPaint(ghWnd, &ps);
+    gpTouchDriver->RepaintWindow();
     break;
 
   case WM_TIMER:
-    gpTouchDriver->RunInertiaProcessorsAndRender();
+    if (wParam == CComTouchDriver::sFrameTimerId)
+      gpTouchDriver->OnFrameTimer();
+    else
+      gpTouchDriver->RunInertiaProcessorsAndRender();
     break;
 
   case WM_KEYDOWN:
   case WM_KEYUP:
     if (wParam == 0x10)
       gShiftPressed = msg == WM_KEYDOWN;
+    else if (wParam == VK_F5 && msg == WM_KEYDOWN)
+      gUseGhostScaleStrip = !gUseGhostScaleStrip;
+    else if (wParam == VK_F6 && msg == WM_KEYDOWN)
+      gpTouchDriver->SimulateDeviceLoss();
+    else if (wParam == VK_F7 && msg == WM_KEYDOWN)
+      gpTouchDriver->CycleTargetFrameRate();
+    else if (wParam == VK_F8 && msg == WM_KEYDOWN)
+      gpTouchDriver->ResyncMidi();
+    else if (wParam == VK_PRIOR && msg == WM_KEYDOWN)
+      gpTouchDriver->SwitchBank(-1);
+    else if (wParam == VK_NEXT && msg == WM_KEYDOWN)
+      gpTouchDriver->SwitchBank(1);
+    else if (wParam == VK_HOME && msg == WM_KEYDOWN)
+      gpTouchDriver->ResetCanvas();
     break;
 
+  case WM_MIDI_INPUT: {
+    auto& input = gMidiRouter.Input(size_t(wParam));
+    input.AddReturnedBuffers();
+    gpTouchDriver->ReceiveMidi(input);
+    break;
+  }
+
   case WM_KILLFOCUS:
     gShiftPressed = false;
     break;
@@ -199,6 +557,10 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
   default:
     return DefWindowProc(hWnd, msg, wParam, lParam);
   }
+
+  // Controller changes of all contacts go out together
+  gMidiScheduler.Flush();
+  gOscOutput.Flush();
   return 0;
 }
 
@@ -0,0 +1,176 @@
+// Copyright (c) v1ne
+
+#include "WinMmMidiBackend.h"
+
+bool CWinMmMidiBackend::Open(unsigned int numDevice) {
+  const auto numDevices = ::midiOutGetNumDevs();
+  if(numDevice >= numDevices)
+    return false;
+
+  MIDIOUTCAPSW caps;
+  if(::midiOutGetDevCapsW(numDevice, &caps, sizeof(MIDIOUTCAPSW)) == MMSYSERR_NOERROR)
+    mDeviceName = std::wstring(caps.szPname);
+
+  mhDone = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+  if(!mhDone)
+    return false;
+
+  MMRESULT result;
+  if((result = ::midiOutOpen(&mhMidiOut, numDevice, DWORD_PTR(mhDone), 0, CALLBACK_EVENT)) != MMSYSERR_NOERROR) {
+    mhMidiOut = nullptr;
+    return false;
+  }
+
+  mThread = std::thread(&CWinMmMidiBackend::ThreadMain, this);
+  return true;
+}
+
+CWinMmMidiBackend::~CWinMmMidiBackend() {
+  if(mhMidiOut) {
+    // What was sent last is usually still queued
+    for(unsigned int waitedMs = 0; waitedMs < sCloseTimeoutMs; ++waitedMs) {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Recycle();
+        if(!NumQueued() && mPendingBytes.empty())
+          break;
+      }
+      ::Sleep(1);
+    }
+
+    mIsClosing = true;
+    ::SetEvent(mhDone);
+    mThread.join();
+
+    // Marks the buffers that are left as done
+    auto ret = ::midiOutReset(mhMidiOut);
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      Recycle();
+    }
+    auto ret2 = ::midiOutClose(mhMidiOut);
+
+    if(ret != MMSYSERR_NOERROR || ret2 != MMSYSERR_NOERROR)
+      ::DebugBreak();
+  }
+  if(mhDone)
+    ::CloseHandle(mhDone);
+}
+
+bool CWinMmMidiBackend::SendShortMessage(uint32_t message) {
+  if(!mhMidiOut)
+    return false;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Recycle();
+    if(NumQueued() || !mPendingBytes.empty()) {
+      // It mustn't overtake the buffers
+      const auto status = uint8_t(message);
+      const auto numBytes = (status & 0xE0) == 0xC0 ? 2 : 3;
+      for(int i = 0; i < numBytes; ++i)
+        mPendingBytes.push_back(uint8_t(message >> (8 * i)));
+      SendPending();
+      return true;
+    }
+  }
+
+  MMRESULT result;
+  while ((result = ::midiOutShortMsg(mhMidiOut, DWORD(message))) == MIDIERR_NOTREADY)
+    ::Sleep(10);
+
+  return result == MMSYSERR_NOERROR;
+}
+
+bool CWinMmMidiBackend::SendBytes(const uint8_t* pBytes, size_t size) {
+  if(!mhMidiOut || size == 0 || size > MAXDWORD)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  Recycle();
+  if(!mPendingBytes.empty() || NumQueued() == sNumBuffers) {
+    // Goes out after what's queued, once a buffer is done
+    mPendingBytes.insert(mPendingBytes.end(), pBytes, pBytes + size);
+    SendPending();
+    return true;
+  }
+
+  // Nothing is pending, but up to sNumBuffers - 1 buffers may still be in
+  // flight. If the driver doesn't take this one, the caller falls back to
+  // short messages, which stay in order only because SendShortMessage
+  // queues them behind the buffers in flight.
+  for(auto& buffer: mBuffers) {
+    if(buffer.isQueued)
+      continue;
+    buffer.bytes.assign(pBytes, pBytes + size);
+    return Queue(buffer);
+  }
+  return false;
+}
+
+void CWinMmMidiBackend::ThreadMain() {
+  while(!mIsClosing) {
+    ::WaitForSingleObject(mhDone, INFINITE);
+    if(mIsClosing)
+      break;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Recycle();
+    SendPending();
+  }
+}
+
+void CWinMmMidiBackend::Recycle() {
+  for(auto& buffer: mBuffers) {
+    if(!buffer.isQueued || !(buffer.header.dwFlags & MHDR_DONE))
+      continue;
+    ::midiOutUnprepareHeader(mhMidiOut, &buffer.header, sizeof(MIDIHDR));
+    buffer.isQueued = false;
+  }
+}
+
+size_t CWinMmMidiBackend::NumQueued() const {
+  size_t numQueued = 0;
+  for(const auto& buffer: mBuffers)
+    numQueued += buffer.isQueued;
+  return numQueued;
+}
+
+bool CWinMmMidiBackend::Queue(Buffer& buffer) {
+  buffer.header = {};
+  buffer.header.lpData = LPSTR(buffer.bytes.data());
+  buffer.header.dwBufferLength = DWORD(buffer.bytes.size());
+  buffer.header.dwBytesRecorded = DWORD(buffer.bytes.size());
+  if(::midiOutPrepareHeader(mhMidiOut, &buffer.header, sizeof(MIDIHDR)) != MMSYSERR_NOERROR)
+    return false;
+
+  MMRESULT result;
+  while ((result = ::midiOutLongMsg(mhMidiOut, &buffer.header, sizeof(MIDIHDR))) == MIDIERR_NOTREADY)
+    ::Sleep(10);
+  if(result != MMSYSERR_NOERROR) {
+    ::midiOutUnprepareHeader(mhMidiOut, &buffer.header, sizeof(MIDIHDR));
+    return false;
+  }
+
+  buffer.isQueued = true;
+  return true;
+}
+
+void CWinMmMidiBackend::SendPending() {
+  if(mPendingBytes.empty())
+    return;
+
+  for(auto& buffer: mBuffers) {
+    if(buffer.isQueued)
+      continue;
+
+    // The buffers keep their memory
+    buffer.bytes.swap(mPendingBytes);
+    mPendingBytes.clear();
+    if(!Queue(buffer)) {
+      ForEachShortMessage(buffer.bytes.data(), buffer.bytes.size(),
+        [&](uint32_t message) { return ::midiOutShortMsg(mhMidiOut, DWORD(message)) == MMSYSERR_NOERROR; });
+    }
+    return;
+  }
+}
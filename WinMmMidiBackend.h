@@ -0,0 +1,65 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include "MidiBackend.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// MIDI 1.0 devices through WinMM
+//
+// Byte streams are copied into one of a few buffers that are prepared for the
+// driver, so that the caller doesn't wait while they're sent. A worker thread
+// unprepares the buffers that the driver is done with and sends what
+// collected while all of them were busy. Short messages queue up behind the
+// buffers, so that everything arrives in order.
+class CWinMmMidiBackend : public CMidiBackend {
+public:
+  ~CWinMmMidiBackend() override;
+
+  bool Open(unsigned int numDevice);
+
+  const std::wstring& DeviceName() const override { return mDeviceName; }
+  bool SendShortMessage(uint32_t message) override;
+  bool SendBytes(const uint8_t* pBytes, size_t size) override;
+
+private:
+  static constexpr size_t sNumBuffers = 4;
+  // How long closing waits for the buffers that are still queued
+  static constexpr unsigned int sCloseTimeoutMs = 1000;
+
+  struct Buffer {
+    // Prepared while the buffer is queued
+    MIDIHDR header = {};
+    std::vector<uint8_t> bytes;
+    bool isQueued = false;
+  };
+
+  void ThreadMain();
+  // Expect mMutex to be held
+  void Recycle();
+  size_t NumQueued() const;
+  // Returns false if the driver didn't take the buffer. Its bytes are left in it.
+  bool Queue(Buffer& buffer);
+  // Queues the pending bytes if a buffer is free. If the driver doesn't take
+  // them, they go out as short messages.
+  void SendPending();
+
+  HMIDIOUT mhMidiOut = nullptr;
+  std::wstring mDeviceName;
+
+  // Set by the driver when it's done with a buffer
+  HANDLE mhDone = nullptr;
+  std::thread mThread;
+  std::atomic<bool> mIsClosing{false};
+
+  std::mutex mMutex;
+  Buffer mBuffers[sNumBuffers];
+  // Bytes that came in while all buffers were queued, in order
+  std::vector<uint8_t> mPendingBytes;
+};
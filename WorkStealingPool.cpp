@@ -0,0 +1,125 @@
+// Copyright (c) v1ne
+
+#include "WorkStealingPool.h"
+
+CWorkStealingPool::CWorkStealingPool(unsigned int numWorkers) {
+  if(!numWorkers)
+    numWorkers = 1;
+
+  for(unsigned int i = 0; i < numWorkers; ++i)
+    mQueues.emplace_back(new Queue);
+
+  for(unsigned int i = 1; i < numWorkers; ++i)
+    mThreads.emplace_back(&CWorkStealingPool::WorkerMain, this, i);
+}
+
+
+CWorkStealingPool::~CWorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIsShuttingDown = true;
+  }
+  mWakeUp.notify_all();
+
+  for(auto& thread: mThreads)
+    thread.join();
+}
+
+
+void CWorkStealingPool::Run(size_t numTasks, const TaskFn& fn) {
+  if(!numTasks)
+    return;
+
+  // Not worth waking up the workers
+  if(numTasks == 1) {
+    fn(0, 0);
+    return;
+  }
+
+  // Workers may still be looking for tasks of the previous batch, so this
+  // has to be set before the first task is queued
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mpFn = &fn;
+    mNumPendingTasks = numTasks;
+  }
+
+  // Deal the tasks out round-robin, so that neighbouring tasks, which tend to
+  // cost about the same, end up on different workers
+  for(size_t task = 0; task < numTasks; ++task) {
+    auto& queue = *mQueues[task % mQueues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mBatch;
+  }
+  mWakeUp.notify_all();
+
+  while(RunOneTask(0)) {}
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDone.wait(lock, [this] { return mNumPendingTasks == 0; });
+  mpFn = nullptr;
+}
+
+
+void CWorkStealingPool::WorkerMain(unsigned int worker) {
+  uint64_t lastBatch = 0;
+  for(;;) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeUp.wait(lock, [&] { return mIsShuttingDown || mBatch != lastBatch; });
+      if(mIsShuttingDown)
+        return;
+      lastBatch = mBatch;
+    }
+
+    while(RunOneTask(worker)) {}
+  }
+}
+
+
+bool CWorkStealingPool::RunOneTask(unsigned int worker) {
+  size_t task;
+  if(!PopTask(worker, &task))
+    return false;
+
+  // mpFn stays valid until the last task of the batch is done
+  (*mpFn)(task, worker);
+
+  bool isLastTask;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    isLastTask = --mNumPendingTasks == 0;
+  }
+  if(isLastTask)
+    mDone.notify_all();
+  return true;
+}
+
+
+bool CWorkStealingPool::PopTask(unsigned int worker, size_t* pTask) {
+  {
+    auto& queue = *mQueues[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(!queue.tasks.empty()) {
+      *pTask = queue.tasks.back();
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for(size_t i = 1; i < mQueues.size(); ++i) {
+    auto& victim = *mQueues[(worker + i) % mQueues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty()) {
+      *pTask = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
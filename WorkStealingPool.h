@@ -0,0 +1,53 @@
+// Copyright (c) v1ne
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs batches of tasks on a fixed set of threads. Each worker has its own
+// queue and takes tasks from its back; when it runs dry, it steals from the
+// front of the other queues. The thread that starts a batch works as worker 0.
+class CWorkStealingPool {
+public:
+  // Receives the task index and the index of the worker that runs it
+  using TaskFn = std::function<void(size_t task, unsigned int worker)>;
+
+  // numWorkers includes the calling thread
+  explicit CWorkStealingPool(unsigned int numWorkers);
+  ~CWorkStealingPool();
+
+  unsigned int NumWorkers() const { return unsigned(mQueues.size()); }
+
+  // Runs fn for all tasks in [0, numTasks) and returns once they're done.
+  // Not reentrant.
+  void Run(size_t numTasks, const TaskFn& fn);
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  void WorkerMain(unsigned int worker);
+  bool RunOneTask(unsigned int worker);
+  bool PopTask(unsigned int worker, size_t* pTask);
+
+  std::vector<std::unique_ptr<Queue>> mQueues;
+  std::vector<std::thread> mThreads;
+
+  std::mutex mMutex;
+  std::condition_variable mWakeUp;
+  std::condition_variable mDone;
+  const TaskFn* mpFn = nullptr;
+  size_t mNumPendingTasks = 0;
+  uint64_t mBatch = 0;
+  bool mIsShuttingDown = false;
+};